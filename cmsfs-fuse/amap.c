@@ -9,6 +9,7 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <endian.h>
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -38,6 +39,17 @@ struct amap_alloction_hint {
 
 static struct amap_alloction_hint amap_hint;
 
+/*
+ * Number of free bits per level 0 amap bitmap block, indexed by the
+ * amap block number. Entries are counted on first use and kept in sync
+ * by amap_block_set() and amap_block_clear() so that exhausted bitmap
+ * blocks are skipped without reading them.
+ */
+#define AMAP_FREE_UNKNOWN	-1
+
+static int *amap_free;
+static int amap_free_max;
+
 static void update_amap_hint(off_t amap_addr, off_t addr)
 {
 	amap_hint.amap_addr = amap_addr;
@@ -85,10 +97,54 @@ static off_t get_amap_addr(int level, off_t addr, off_t ptr)
 	return ptr;
 }
 
+/*
+ * Adjust the number of free bits of the bitmap block covering addr.
+ */
+static void amap_free_update(off_t addr, int delta)
+{
+	int nr = amap_blocknumber(addr);
+
+	if (nr >= amap_free_max || amap_free[nr] == AMAP_FREE_UNKNOWN)
+		return;
+	amap_free[nr] += delta;
+	BUG(amap_free[nr] < 0);
+}
+
+/*
+ * Return the number of free bits of level 0 bitmap block amap with
+ * block number nr.
+ */
+static int amap_free_count(off_t amap, int nr)
+{
+	uint64_t word;
+	int i, rc;
+
+	if (amap_free == NULL) {
+		amap_free_max = cmsfs.total_blocks / (cmsfs.blksize * 8) + 1;
+		amap_free = malloc(amap_free_max * sizeof(int));
+		if (amap_free == NULL)
+			DIE_PERROR("malloc failed");
+		for (i = 0; i < amap_free_max; i++)
+			amap_free[i] = AMAP_FREE_UNKNOWN;
+	}
+	if (nr >= amap_free_max)
+		return 0;
+	if (amap_free[nr] != AMAP_FREE_UNKNOWN)
+		return amap_free[nr];
+
+	amap_free[nr] = 0;
+	for (i = 0; i < cmsfs.blksize; i += sizeof(word)) {
+		rc = _read(&word, sizeof(word), amap + i);
+		BUG(rc < 0);
+		amap_free[nr] += 64 - __builtin_popcountll(word);
+	}
+	return amap_free[nr];
+}
+
 /*
  * Mark disk address as allocated in alloc map.
  */
-static void amap_block_set(off_t amap, int bit)
+static void amap_block_set(off_t amap, int bit, off_t addr)
 {
 	u8 entry;
 	int rc;
@@ -102,6 +158,7 @@ static void amap_block_set(off_t amap, int bit)
 	entry |= (1 << (7 - bit));
 	rc = _write(&entry, sizeof(entry), amap);
 	BUG(rc < 0);
+	amap_free_update(addr, -1);
 }
 
 /*
@@ -131,6 +188,7 @@ static void amap_block_clear(off_t addr)
 	entry &= ~(1 << (7 - bit));
 	rc = _write(&entry, sizeof(entry), amap + byte);
 	BUG(rc < 0);
+	amap_free_update(disk_addr, 1);
 
 	/*
 	 * If the freed addr is lower set the hint to it to ensure
@@ -143,16 +201,24 @@ static void amap_block_clear(off_t addr)
 }
 
 /*
- * Return the first free bit in one byte.
+ * Return the number of the first free bit in a level 0 bitmap block,
+ * starting the search at byte offset start. The bitmap is scanned
+ * 64 bits at a time. Return -1 if no bit is free.
  */
-static inline int find_first_empty_bit(u8 entry)
+static int find_first_empty_bit(off_t amap, int start)
 {
-	u8 i;
-
-	for (i = 0; i < 8; i++)
-		if (!(entry & 1 << (7 - i)))
-			return i;
-	/* unreachable */
+	uint64_t word;
+	int i, rc;
+
+	for (i = start & ~(sizeof(word) - 1); i < cmsfs.blksize;
+	     i += sizeof(word)) {
+		rc = _read(&word, sizeof(word), amap + i);
+		BUG(rc < 0);
+		if (word == ~0ULL)
+			continue;
+		/* the first block of a byte is the most significant bit */
+		return i * 8 + __builtin_clzll(~be64toh(word));
+	}
 	return -1;
 }
 
@@ -172,39 +238,35 @@ static off_t bytes_per_level(int level)
 	return mult;
 }
 
-static inline int get_amap_entry_bit(off_t amap)
+/*
+ * Allocate the first free block of level 0 bitmap block amap, starting
+ * the search at byte offset start. addr is the disk address of the first
+ * block covered by the bitmap block.
+ */
+static off_t alloc_amap_bit(off_t amap, int start, off_t addr)
 {
-	u8 entry;
-	int rc;
+	int nr;
 
-	rc = _read(&entry, sizeof(entry), amap);
-	BUG(rc < 0);
+	if (!amap_free_count(amap, amap_blocknumber(addr)))
+		return 0;
+	nr = find_first_empty_bit(amap, start);
+	if (nr == -1)
+		return 0;
+
+	/* Calculate the addr for the free block we've found. */
+	addr += (off_t) nr * cmsfs.blksize;
 
-	if (entry == 0xff)
-		return -1;
-	return find_first_empty_bit(entry);
+	amap_block_set(amap + nr / 8, nr % 8, addr);
+	update_amap_hint(amap + nr / 8, addr);
+	return addr;
 }
 
 static off_t __get_free_block_fast(void)
 {
-	off_t addr, amap = amap_hint.amap_addr & ~DATA_BLOCK_MASK;
-	int bit, i = amap_hint.amap_addr & DATA_BLOCK_MASK;
-
-	for (; i < cmsfs.blksize; i++) {
-		bit = get_amap_entry_bit(amap + i);
-		if (bit == -1)
-			continue;
+	off_t amap = amap_hint.amap_addr & ~DATA_BLOCK_MASK;
 
-		/* Calculate the addr for the free block we've found. */
-		addr = (off_t) amap_blocknumber(amap_hint.addr) * BYTES_PER_BLOCK;
-		addr += i * 8 * cmsfs.blksize;
-		addr += bit * cmsfs.blksize;
-
-		amap_block_set(amap + i, bit);
-		update_amap_hint(amap + i, addr);
-		return addr;
-	}
-	return 0;
+	return alloc_amap_bit(amap, amap_hint.amap_addr & DATA_BLOCK_MASK,
+		(off_t) amap_blocknumber(amap_hint.addr) * BYTES_PER_BLOCK);
 }
 
 /*
@@ -213,7 +275,7 @@ static off_t __get_free_block_fast(void)
 static off_t __get_free_block(int level, off_t amap, off_t addr)
 {
 	off_t ptr;
-	int bit, i;
+	int i;
 
 	if (level > 0) {
 		for (i = 0; i < PTRS_PER_BLOCK; i++) {
@@ -229,23 +291,12 @@ static off_t __get_free_block(int level, off_t amap, off_t addr)
 		return 0;
 	}
 
-	for (i = 0; i < cmsfs.blksize; i++) {
-		bit = get_amap_entry_bit(amap + i);
-		if (bit == -1)
-			continue;
-		amap_block_set(amap + i, bit);
-		/* add byte offset */
-		addr += i * 8 * cmsfs.blksize;
-		/* add bit offset */
-		addr += bit * cmsfs.blksize;
-		update_amap_hint(amap + i, addr);
-		return addr;
-	}
-	return 0;
+	return alloc_amap_bit(amap, 0, addr);
 }
 
 /*
  * Allocate a free block and increment label block counter.
+ * The caller must hold cmsfs_lock for writing in multi-threaded mode.
  */
 off_t get_free_block(void)
 {
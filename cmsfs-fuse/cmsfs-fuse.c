@@ -16,13 +16,13 @@
 #include <fcntl.h>
 #include <fuse.h>
 #include <fuse_opt.h>
-#include <iconv.h>
 #include <limits.h>
 #include <linux/fs.h>
 #ifdef HAVE_SETXATTR
 #include <linux/xattr.h>
 #endif
 #include <math.h>
+#include <pthread.h>
 #include <search.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -51,6 +51,18 @@ static struct util_list open_file_list;
 static struct util_list text_type_list;
 FILE *logfile;
 
+/*
+ * In multi-threaded mode read-only operations run concurrently while
+ * holding cmsfs_lock for reading. All operations that modify the file
+ * system, including block allocation and FST updates, hold it for writing.
+ */
+static pthread_rwlock_t cmsfs_lock =
+	PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+/* protects the fst address cache which is also updated by lookups */
+static pthread_mutex_t fcache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* serializes concurrent readers if the converter is not stateless */
+static pthread_mutex_t iconv_lock = PTHREAD_MUTEX_INITIALIZER;
+
 #define FSNAME_MAX_LEN	200
 #define MAX_FNAME	18
 
@@ -68,6 +80,8 @@ static const struct fuse_opt cmsfs_opts[] = {
 	CMSFS_OPT("--filetype",		mode, TYPE_MODE),
 	CMSFS_OPT("--from=%s",		codepage_from, 0),
 	CMSFS_OPT("--to=%s",		codepage_to, 0),
+	CMSFS_OPT("-m",			multithreaded, 1),
+	CMSFS_OPT("--multithreaded",	multithreaded, 1),
 
 	FUSE_OPT_KEY("-h",		KEY_HELP),
 	FUSE_OPT_KEY("--help",		KEY_HELP),
@@ -91,6 +105,7 @@ static void usage(const char *progname)
 "    -a   --ascii           Force ascii translation\n"
 "         --from=           Codepage used on the CMS disk\n"
 "         --to=             Codepage used for conversion to Linux\n"
+"    -m   --multithreaded   Process read requests in parallel\n"
 "\n", progname);
 }
 
@@ -236,6 +251,8 @@ struct file {
 	char		*wcache;
 	/* buffer for iconv */
 	char		*iconv_buf;
+	/* serializes concurrent readers of the file object */
+	pthread_mutex_t	read_lock;
 	/* used bytes in write cache */
 	int		wcache_used;
 	/* committed written bytes to FUSE */
@@ -311,10 +328,11 @@ static unsigned int hex_to_dec(unsigned int num)
 	return res & 0xffffffff;
 }
 
-static void setup_iconv(iconv_t *conv, const char *from, const char *to)
+static void setup_iconv(struct util_iconv **conv, const char *from,
+			const char *to)
 {
-	*conv = iconv_open(to, from);
-	if (*conv == ((iconv_t) -1))
+	*conv = util_iconv_open(to, from);
+	if (*conv == NULL)
 		DIE("Could not initialize conversion table %s->%s.\n",
 			from, to);
 }
@@ -1396,6 +1414,7 @@ static void cache_fst_addr(off_t addr, const char *file)
 
 	e.key = strdup(file);
 
+	pthread_mutex_lock(&fcache_lock);
 again:
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab) == 0) {
 		/* cache it */
@@ -1415,6 +1434,7 @@ again:
 			DIE("hsearch: hash table full\n");
 	} else
 		free(e.key);
+	pthread_mutex_unlock(&fcache_lock);
 }
 
 static void update_htab_entry(off_t addr, const char *file)
@@ -1424,10 +1444,10 @@ static void update_htab_entry(off_t addr, const char *file)
 
 	e.key = strdup(file);
 
+	pthread_mutex_lock(&fcache_lock);
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab) == 0) {
 		/* not yet cached, nothing to do */
 		free(e.key);
-		return;
 	} else {
 		/* update it */
 		fce = eptr->data;
@@ -1436,6 +1456,7 @@ static void update_htab_entry(off_t addr, const char *file)
 		if (hsearch_r(e, ENTER, &eptr, &cmsfs.htab) == 0)
 			DIE("%s: hash table full\n", __func__);
 	}
+	pthread_mutex_unlock(&fcache_lock);
 }
 
 static void invalidate_htab_entry(const char *name)
@@ -1445,10 +1466,11 @@ static void invalidate_htab_entry(const char *name)
 
 	e.key = strdup(name);
 
+	pthread_mutex_lock(&fcache_lock);
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab) == 0) {
 		/* nothing to do if not cached */
 		free(e.key);
-		return;
+		goto out;
 	}
 
 	fce = eptr->data;
@@ -1456,6 +1478,8 @@ static void invalidate_htab_entry(const char *name)
 	e.data = fce;
 	if (hsearch_r(e, ENTER, &eptr, &cmsfs.htab) == 0)
 		DIE("hsearch: hash table full\n");
+out:
+	pthread_mutex_unlock(&fcache_lock);
 }
 
 /*
@@ -1577,26 +1601,25 @@ static off_t lookup_file(const char *name, struct fst_entry *fst, int flag)
 	e.key = strdup(uc_name);
 
 	/* already cached ? */
+	pthread_mutex_lock(&fcache_lock);
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab)) {
 		fce = eptr->data;
+		/* may be zero for a stale entry */
+		faddr = fce->fst_addr;
+	}
+	pthread_mutex_unlock(&fcache_lock);
+	free(e.key);
 
-		/* check if fst is valid, may be zero for a stale entry */
-		if (!fce->fst_addr)
-			goto renew;
-
+	if (faddr) {
 		/* read in the fst entry */
-		rc = _read(fst, sizeof(*fst), fce->fst_addr);
+		rc = _read(fst, sizeof(*fst), faddr);
 		BUG(rc < 0);
 
 		if (!check_fst_valid(fst))
 			DIE("Invalid file format in file: %s\n", uc_name);
-
-		free(e.key);
-		return fce->fst_addr;
+		return faddr;
 	}
 
-renew:
-	free(e.key);
 	if (encode_edf_name(uc_name, fname, ftype))
 		return 0;
 	memset(&walk, 0, sizeof(walk));
@@ -2418,21 +2441,8 @@ static int rewrite_pointers(struct file *f)
 }
 
 /*
- * Guess position in record table.
+ * Check if offset points to the linefeed between records prev and next.
  */
-static int guess_record_number(struct file *f, off_t offset)
-{
-	int nr;
-
-	if (f->linefeed)
-		nr = (offset / (f->fst->record_len + 1));
-	else
-		nr = (offset / f->fst->record_len);
-	if (nr >= f->fst->nr_records)
-		nr = f->fst->nr_records - 1;
-	return nr;
-}
-
 static int offset_is_linefeed(off_t offset, struct record *prev,
 			      struct record *next)
 {
@@ -2442,6 +2452,29 @@ static int offset_is_linefeed(off_t offset, struct record *prev,
 	return 0;
 }
 
+/*
+ * The logical record start offsets in f->rlist are ascending since they are
+ * the running sum of the previous record lengths plus linefeeds. They are
+ * set by cache_file() and rebuilt by update_records() after writes.
+ *
+ * Returns the number of the last record that starts at or before offset,
+ * or -1 if there is none.
+ */
+static int search_record(struct file *f, off_t offset)
+{
+	int lo = 0, hi = f->fst->nr_records - 1, mid, nr = -1;
+
+	while (lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		if (f->rlist[mid].file_start <= offset) {
+			nr = mid;
+			lo = mid + 1;
+		} else
+			hi = mid - 1;
+	}
+	return nr;
+}
+
 static int offset_in_record(off_t offset, struct record *rec)
 {
 	if (offset >= rec->file_start &&
@@ -2469,8 +2502,8 @@ static void set_hint(struct file *f, int hint)
  */
 static struct record *find_record(struct file *f, off_t offset, int *nr)
 {
-	int i, start, step, max = f->fst->nr_records;
 	struct record *rec;
+	int i;
 
 	/*
 	 * next_record_hint is a guess which is optimal for sequential
@@ -2491,45 +2524,20 @@ static struct record *find_record(struct file *f, off_t offset, int *nr)
 		if (offset_is_linefeed(offset, &f->rlist[i - 1], rec))
 			return LINEFEED_OFFSET;
 
-	start = guess_record_number(f, offset);
-
-	/* because of potential linefeed we need to check the next record */
-	rec = &f->rlist[start];
-	if (offset < rec->file_start)
-		step = -1;
-	else
-		step = 1;
-
-	for (i = start; i >= 0 && i < max; i += step) {
-		rec = &f->rlist[i];
-		if (offset_in_record(offset, rec)) {
-			set_hint(f, i + 1);
-			*nr = i;
-			return rec;
-		}
-
-		/* last record reached, only one linefeed can follow */
-		if (i == max - 1) {
-			if (f->linefeed &&
-			    (offset == rec->file_start + rec->total_len))
-				return LINEFEED_OFFSET;
-			else
-				return NULL;
-		}
-
-		/* check for linefeed byte between two records */
-		if (step == 1) {
-			if (offset_is_linefeed(offset, rec, &f->rlist[i + 1]))
-				return LINEFEED_OFFSET;
-		} else
-			/*
-			 * No need to check if i > 0 since no linefeed before
-			 * record 0 possible.
-			 */
-			if (offset_is_linefeed(offset, &f->rlist[i - 1], rec))
-				return LINEFEED_OFFSET;
-
+	i = search_record(f, offset);
+	if (i < 0)
+		goto not_found;
+	rec = &f->rlist[i];
+	if (offset_in_record(offset, rec)) {
+		set_hint(f, i + 1);
+		*nr = i;
+		return rec;
 	}
+
+	/* only a linefeed can follow the last byte of a record */
+	if (f->linefeed && offset == rec->file_start + rec->total_len)
+		return LINEFEED_OFFSET;
+not_found:
 	DEBUG("find: record not found!\n");
 	return NULL;
 }
@@ -2570,14 +2578,15 @@ static void get_block_data_from_record(struct record *rec, off_t offset,
 	}
 }
 
-static int convert_text(iconv_t conv, char *in_buf, char *out_buf, int size)
+static int convert_text(struct util_iconv *conv, char *in_buf, char *out_buf,
+			int size)
 {
 	size_t out_count = size;
 	size_t in_count = size;
-	int rc;
+	size_t rc;
 
-	rc = iconv(conv, &in_buf, &in_count, &out_buf, &out_count);
-	if ((rc == -1) || (in_count != 0)) {
+	rc = util_iconv_conv(conv, &in_buf, &in_count, &out_buf, &out_count);
+	if ((rc == (size_t) -1) || (in_count != 0)) {
 		DEBUG("Code page translation EBCDIC-ASCII failed\n");
 		return -EIO;
 	}
@@ -2602,6 +2611,8 @@ static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
 	if (offset + size > len)
 		size = len - offset;
 
+	/* the record hint and the iconv buffer are per file object */
+	pthread_mutex_lock(&f->read_lock);
 	while (size > 0) {
 		rec = find_record(f, offset, &nr);
 		if (rec == NULL) {
@@ -2640,14 +2651,22 @@ static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
 		else if (f->translate) {
 			rc = _read(f->iconv_buf, chunk, addr);
 			if (rc < 0)
-				return rc;
-			rc = convert_text(cmsfs.iconv_from, f->iconv_buf, buf, chunk);
+				goto out_rc;
+			if (util_iconv_stateless(cmsfs.iconv_from)) {
+				rc = convert_text(cmsfs.iconv_from,
+						  f->iconv_buf, buf, chunk);
+			} else {
+				pthread_mutex_lock(&iconv_lock);
+				rc = convert_text(cmsfs.iconv_from,
+						  f->iconv_buf, buf, chunk);
+				pthread_mutex_unlock(&iconv_lock);
+			}
 			if (rc < 0)
-				return rc;
+				goto out_rc;
 		} else {
 			rc = _read(buf, chunk, addr);
 			if (rc < 0)
-				return rc;
+				goto out_rc;
 		}
 
 		copied += chunk;
@@ -2656,8 +2675,13 @@ static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
 		offset += chunk;
 	}
 out:
+	pthread_mutex_unlock(&f->read_lock);
 	DEBUG("%s: copied: %lu\n", __func__, copied);
 	return copied;
+
+out_rc:
+	pthread_mutex_unlock(&f->read_lock);
+	return rc;
 }
 
 static int cmsfs_statfs(const char *path, struct statvfs *buf)
@@ -4393,6 +4417,7 @@ static struct file *create_file_object(struct fst_entry *fst, int *rc)
 	if (f == NULL)
 		goto oom;
 	memset(f, 0, sizeof(*f));
+	pthread_mutex_init(&f->read_lock, NULL);
 
 	f->fst = malloc(sizeof(struct fst_entry));
 	if (f->fst == NULL)
@@ -4475,6 +4500,7 @@ static void destroy_file_object(struct file *f)
 	free(f->rlist);
 	free(f->blist);
 	free(f->fst);
+	pthread_mutex_destroy(&f->read_lock);
 	free(f);
 }
 
@@ -4492,24 +4518,197 @@ static struct file_operations fops_variable = {
 	.write_pointers = rewrite_pointer_block_variable,
 };
 
+/*
+ * Locking wrappers for the FUSE operations, see cmsfs_lock.
+ */
+static int locked_getattr(const char *path, struct stat *stbuf)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&cmsfs_lock);
+	rc = cmsfs_getattr(path, stbuf);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_statfs(const char *path, struct statvfs *buf)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&cmsfs_lock);
+	rc = cmsfs_statfs(path, buf);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_readdir(const char *path, void *buf,
+			  fuse_fill_dir_t filler, off_t offset,
+			  struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&cmsfs_lock);
+	rc = cmsfs_readdir(path, buf, filler, offset, fi);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_open(const char *path, struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_open(path, fi);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_release(const char *path, struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_release(path, fi);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_read(const char *path, char *buf, size_t size,
+		       off_t offset, struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&cmsfs_lock);
+	rc = cmsfs_read(path, buf, size, offset, fi);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_utimens(const char *path, const struct timespec ts[2])
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_utimens(path, ts);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_rename(const char *path, const char *new_path)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_rename(path, new_path);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_fsync(const char *path, int datasync,
+			struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_fsync(path, datasync, fi);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_truncate(const char *path, off_t size)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_truncate(path, size);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_create(const char *path, mode_t mode,
+			 struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_create(path, mode, fi);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_write(const char *path, const char *buf, size_t size,
+			off_t offset, struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_write(path, buf, size, offset, fi);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_unlink(const char *path)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_unlink(path);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+#ifdef HAVE_SETXATTR
+static int locked_listxattr(const char *path, char *list, size_t size)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&cmsfs_lock);
+	rc = cmsfs_listxattr(path, list, size);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_getxattr(const char *path, const char *name, char *value,
+			   size_t size)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&cmsfs_lock);
+	rc = cmsfs_getxattr(path, name, value, size);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+
+static int locked_setxattr(const char *path, const char *name,
+			   const char *value, size_t size, int flags)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&cmsfs_lock);
+	rc = cmsfs_setxattr(path, name, value, size, flags);
+	pthread_rwlock_unlock(&cmsfs_lock);
+	return rc;
+}
+#endif
+
 static struct fuse_operations cmsfs_oper = {
-	.getattr	= cmsfs_getattr,
-	.statfs		= cmsfs_statfs,
-	.readdir	= cmsfs_readdir,
-	.open		= cmsfs_open,
-	.release	= cmsfs_release,
-	.read		= cmsfs_read,
-	.utimens	= cmsfs_utimens,
-	.rename		= cmsfs_rename,
-	.fsync		= cmsfs_fsync,
-	.truncate	= cmsfs_truncate,
-	.create		= cmsfs_create,
-	.write		= cmsfs_write,
-	.unlink		= cmsfs_unlink,
+	.getattr	= locked_getattr,
+	.statfs		= locked_statfs,
+	.readdir	= locked_readdir,
+	.open		= locked_open,
+	.release	= locked_release,
+	.read		= locked_read,
+	.utimens	= locked_utimens,
+	.rename		= locked_rename,
+	.fsync		= locked_fsync,
+	.truncate	= locked_truncate,
+	.create		= locked_create,
+	.write		= locked_write,
+	.unlink		= locked_unlink,
 #ifdef HAVE_SETXATTR
-	.listxattr      = cmsfs_listxattr,
-	.getxattr       = cmsfs_getxattr,
-	.setxattr       = cmsfs_setxattr,
+	.listxattr      = locked_listxattr,
+	.getxattr       = locked_getxattr,
+	.setxattr       = locked_setxattr,
 	/* no removexattr since our xattrs are virtual */
 #endif
 };
@@ -4667,8 +4866,9 @@ int main(int argc, char *argv[])
 
 	if (cmsfs.readonly)
 		fuse_opt_add_arg(&args, "-oro");
-	/* force single threaded mode which requires no locking */
-	fuse_opt_add_arg(&args, "-s");
+	/* single threaded mode unless requested otherwise */
+	if (!cmsfs.multithreaded)
+		fuse_opt_add_arg(&args, "-s");
 	/* force immediate file removal */
 	fuse_opt_add_arg(&args, "-ohard_remove");
 
@@ -12,9 +12,9 @@
 #ifndef _CMSFS_H
 #define _CMSFS_H
 
-#include <iconv.h>
 #include <search.h>
 
+#include "lib/util_iconv.h"
 #include "lib/util_list.h"
 
 #define COMP "cmsfs-fuse: "
@@ -57,6 +57,8 @@ struct cmsfs {
 	int		readonly;
 	/* access permission for other users */
 	int		allow_other;
+	/* process requests in multiple threads */
+	int		multithreaded;
 	/* offset to label */
 	off_t		label;
 	/* offset to file directory root FST */
@@ -74,8 +76,8 @@ struct cmsfs {
 	/* iconv codepage options */
 	const char	*codepage_from;
 	const char	*codepage_to;
-	iconv_t		iconv_from;
-	iconv_t		iconv_to;
+	struct util_iconv *iconv_from;
+	struct util_iconv *iconv_to;
 
 	/* disk stats */
 	int		total_blocks;
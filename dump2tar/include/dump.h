@@ -38,9 +38,12 @@ struct dump_opts {
 	bool recursive;
 	bool threaded;
 	bool verbose;
+	const char *manifest_in;
+	const char *manifest_out;
 	const char *output_file;
 	int file_timeout;
 	int timeout;
+	long gzip_threads;
 	long jobs;
 	long jobs_per_cpu;
 	size_t file_max_size;
@@ -0,0 +1,49 @@
+/*
+ * dump2tar - tool to dump files and command output into a tar archive
+ *
+ * Manifests for incremental archives
+ *
+ * Copyright IBM Corp. 2016, 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Initial value for manifest_hash() */
+#define MANIFEST_HASH_INIT	0xcbf29ce484222325ULL
+
+/* A single archive entry recorded in a manifest */
+struct manifest_entry {
+	struct manifest_entry *next;
+	unsigned long long hash;	/* Content hash, 0 if not hashed */
+	size_t size;
+	time_t mtime;
+	bool seen;			/* Entry was found in current run */
+	char name[];
+};
+
+struct manifest;
+
+unsigned long long manifest_hash(unsigned long long hash, const void *addr,
+				 size_t len);
+
+struct manifest *manifest_read(const char *filename);
+struct manifest_entry *manifest_find(struct manifest *manifest,
+				     const char *name);
+char *manifest_get_unseen(struct manifest *manifest, size_t *len_ptr,
+			  unsigned long *num_ptr);
+void manifest_free(struct manifest *manifest);
+
+FILE *manifest_create(const char *filename);
+void manifest_add(FILE *fp, const char *name, unsigned long long hash,
+		  size_t size, time_t mtime);
+
+#endif /* MANIFEST_H */
@@ -0,0 +1,35 @@
+/*
+ * dump2tar - tool to dump files and command output into a tar archive
+ *
+ * Parallel gzip compression
+ *
+ * Copyright IBM Corp. 2016, 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef PGZIP_H
+#define PGZIP_H
+
+#include <stdlib.h>
+#include <time.h>
+
+/* Size of uncompressed data in a single gzip member (bytes) */
+#define PGZIP_BLOCK_SIZE	(1024 * 1024)
+
+struct pgzip;
+
+/* Compression statistics */
+struct pgzip_stats {
+	size_t bytes_in;	/* Number of uncompressed bytes */
+	size_t bytes_out;	/* Number of compressed bytes written */
+	struct timespec cpu_time; /* CPU time used by all compression threads */
+};
+
+struct pgzip *pgzip_open(int fd, long threads);
+int pgzip_write(struct pgzip *pgzip, const void *addr, size_t len);
+size_t pgzip_tell(struct pgzip *pgzip);
+int pgzip_close(struct pgzip *pgzip, struct pgzip_stats *stats);
+
+#endif /* PGZIP_H */
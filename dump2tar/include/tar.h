@@ -37,6 +37,7 @@ int tar_emit_file_from_buffer(char *filename, char *link, size_t len,
 			      struct stat *stat, char type,
 			      struct buffer *content, emit_cb_t emit_cb,
 			      void *data);
+int tar_emit_padding(emit_cb_t emit_cb, void *data, size_t len);
 int tar_emit_file_from_data(char *filename, char *link, size_t len,
 			    struct stat *stat, char type, void *addr,
 			    emit_cb_t emit_cb, void *data);
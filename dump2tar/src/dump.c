@@ -18,10 +18,14 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/vfs.h>
 #include <unistd.h>
 
+#include <linux/magic.h>
+
 #ifdef HAVE_ZLIB
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
@@ -31,13 +35,24 @@
 #include "dump.h"
 #include "global.h"
 #include "idcache.h"
+#include "manifest.h"
 #include "misc.h"
+#ifdef HAVE_ZLIB
+#include "pgzip.h"
+#endif /* HAVE_ZLIB */
 #include "tar.h"
 
 /* Default input file read size (bytes) */
 #define DEFAULT_READ_CHUNK_SIZE		(512 * 1024)
 #define DEFAULT_MAX_BUFFER_SIZE		(2 * 1024 * 1024)
 
+/* Name of archive entry listing entries deleted since the previous run */
+#define DELETED_LIST_NAME		".dump2tar-deleted"
+
+#ifndef TRACEFS_MAGIC
+#define TRACEFS_MAGIC			0x74726163
+#endif
+
 #define _SET_ABORTED(task)	_set_aborted((task), __func__, __LINE__)
 #define SET_ABORTED(task)	set_aborted((task), __func__, __LINE__)
 
@@ -65,6 +80,7 @@
 /* Jobs representing a file or command output to add */
 struct job {
 	struct job *next_job;
+	struct job *prev_job;
 	enum job_type {
 		JOB_INIT,	/* Initialization work */
 		JOB_FILE,	/* Add a regular file */
@@ -89,6 +105,12 @@ struct job {
 	struct dref *dref;
 	int cmd_status;
 	struct buffer *content;
+	int stream_fd;
+	size_t stream_len;
+	bool pseudo_fs;			/* File is on a pseudo file system */
+	unsigned long long hash;	/* Manifest content hash */
+	size_t size;			/* Manifest entry data size */
+	bool unchanged;			/* Unchanged since previous run */
 };
 
 /* Run-time statistics */
@@ -97,6 +119,20 @@ struct stats {
 	unsigned long num_excluded;
 	unsigned long num_failed;
 	unsigned long num_partial;
+	unsigned long num_steals;
+	unsigned long num_unchanged;
+	unsigned long num_deleted;
+};
+
+/* Double-ended job queue. The owning thread adds and removes jobs at the
+ * head, other threads steal jobs from the tail. */
+struct job_queue {
+	/* mutex serializes access to the queue */
+	pthread_mutex_t mutex;
+	struct job *head;
+	struct job *tail;
+	/* Time spent waiting for mutex (protected by mutex) */
+	unsigned long long lock_wait_ns;
 };
 
 /* Information specific to a single dump task */
@@ -110,19 +146,34 @@ struct task {
 	pthread_mutex_t mutex;
 	pthread_cond_t worker_cond;
 	pthread_cond_t cond;
-	unsigned long num_jobs_active;
-	struct job *jobs_head;
-	struct job *jobs_tail;
+	unsigned long long lock_wait_ns;
 	bool aborted;
 
+	/* Queue for jobs not added by a worker thread */
+	struct job_queue queue;
+	/* Per-thread data for stealing jobs */
+	struct per_thread *threads;
+	long num_threads;
+
+	/* Only accessed using atomic operations */
+	long num_jobs_active;	/* Number of queued and running jobs */
+	long num_jobs_queued;	/* Number of queued jobs */
+	long num_idle;		/* Number of workers waiting for jobs */
+
 	/* output_mutex serializes access to output file */
 	pthread_mutex_t output_mutex;
 	int output_fd;
 	size_t output_written;
 #ifdef HAVE_ZLIB
 	gzFile output_gzfd;
+	struct pgzip *output_pgzip;
+	struct pgzip_stats pgzip_stats;
 #endif /* HAVE_ZLIB */
 	unsigned long output_num_files;
+	FILE *manifest_fp;
+
+	/* Manifest of previous run (only seen flags are modified) */
+	struct manifest *manifest;
 
 	/* No protection needed (only accessed in single-threaded mode) */
 	struct stats stats;
@@ -137,6 +188,7 @@ struct per_thread {
 	bool timed_out;
 	struct stats stats;
 	struct job *job;
+	struct job_queue queue;
 	struct buffer buffer;
 	struct task *task;
 };
@@ -154,13 +206,31 @@ static const struct {
 	{ S_IFSOCK, 's' },
 };
 
+/* Lock @mutex. If the mutex is contended, add the time spent waiting for it
+ * to @wait_ns. */
+static void lock_timed(pthread_mutex_t *mutex, unsigned long long *wait_ns)
+{
+	struct timespec start, end;
+
+	if (pthread_mutex_trylock(mutex) == 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_lock(mutex);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	/* @wait_ns is protected by @mutex */
+	*wait_ns += (end.tv_sec - start.tv_sec) * NSEC_PER_SEC +
+		    (end.tv_nsec - start.tv_nsec);
+}
+
 /* Lock main mutex */
 static void main_lock(struct task *task)
 {
 	if (!global_threaded)
 		return;
 	DBG("main lock");
-	pthread_mutex_lock(&task->mutex);
+	lock_timed(&task->mutex, &task->lock_wait_ns);
 }
 
 /* Unlock main mutex */
@@ -188,6 +258,21 @@ static void output_unlock(struct task *task)
 	pthread_mutex_unlock(&task->output_mutex);
 }
 
+/* Lock main mutex if the main thread needs access to per-thread job
+ * information for handling per-file timeouts */
+static void job_lock(struct task *task)
+{
+	if (task->opts->file_timeout > 0)
+		main_lock(task);
+}
+
+/* Unlock main mutex locked by job_lock() */
+static void job_unlock(struct task *task)
+{
+	if (task->opts->file_timeout > 0)
+		main_unlock(task);
+}
+
 /* Wake up all waiting workers */
 static void _worker_wakeup_all(struct task *task)
 {
@@ -274,7 +359,7 @@ static void cancel_disable(void)
 static void _set_aborted(struct task *task, const char *func, unsigned int line)
 {
 	DBG("set aborted at %s:%u", func, line);
-	task->aborted = true;
+	__atomic_store_n(&task->aborted, true, __ATOMIC_SEQ_CST);
 	_worker_wakeup_all(task);
 	_main_wakeup(task);
 }
@@ -290,13 +375,7 @@ static void set_aborted(struct task *task, const char *func, unsigned int line)
 /* Check if abort processing has been initiated */
 static bool is_aborted(struct task *task)
 {
-	bool result;
-
-	main_lock(task);
-	result = task->aborted;
-	main_unlock(task);
-
-	return result;
+	return __atomic_load_n(&task->aborted, __ATOMIC_SEQ_CST);
 }
 
 /* Release resources associated with @job */
@@ -305,6 +384,8 @@ static void free_job(struct task *task, struct job *job)
 	DBG("free job %p (%s)", job, job->inname);
 	if (!job)
 		return;
+	if (job->stream_fd >= 0)
+		close(job->stream_fd);
 	free(job->inname);
 	free(job->outname);
 	free(job->relname);
@@ -412,6 +493,7 @@ static struct job *create_job(struct task *task, const char *inname,
 	    inname, outname, is_cmd, relname, dref);
 
 	job->status = JOB_QUEUED;
+	job->stream_fd = -1;
 
 	if (!inname) {
 		job->type = JOB_INIT;
@@ -486,12 +568,16 @@ void job_print(struct job *job)
 	printf("DEBUG:   dref=%p\n", job->dref);
 	printf("DEBUG:   cmd_status=%d\n", job->cmd_status);
 	printf("DEBUG:   content=%p\n", job->content);
+	printf("DEBUG:   stream_fd=%d\n", job->stream_fd);
+	printf("DEBUG:   stream_len=%zu\n", job->stream_len);
 }
 
 /* Return the number of bytes written to the output file */
 static size_t get_output_size(struct task *task)
 {
 #ifdef HAVE_ZLIB
+	if (task->output_pgzip)
+		return pgzip_tell(task->output_pgzip);
 	if (task->opts->gzip) {
 		gzflush(task->output_gzfd, Z_SYNC_FLUSH);
 		return gztell(task->output_gzfd);
@@ -507,6 +593,13 @@ static int write_output(struct task *task, const char *ptr, size_t len)
 	ssize_t w;
 
 #ifdef HAVE_ZLIB
+	if (task->output_pgzip) {
+		if (pgzip_write(task->output_pgzip, ptr, len))
+			goto err_write;
+		task->output_written += len;
+
+		return EXIT_OK;
+	}
 	if (task->opts->gzip) {
 		if (gzwrite(task->output_gzfd, ptr, len) == 0)
 			goto err_write;
@@ -584,24 +677,139 @@ static int write_job_status_file(struct task *task, struct job *job)
 	return rc;
 }
 
-/* Write tar entry for data in @job to output. Must be called with output_lock
+/* Write @len zero bytes to the output file */
+static int write_zeroes(struct task *task, size_t len)
+{
+	char zeroes[TAR_BLOCKSIZE];
+	size_t c;
+
+	memset(zeroes, 0, sizeof(zeroes));
+	while (len > 0) {
+		c = len < sizeof(zeroes) ? len : sizeof(zeroes);
+		if (write_output(task, zeroes, c))
+			return EXIT_RUNTIME;
+		len -= c;
+	}
+
+	return EXIT_OK;
+}
+
+/* Copy @len bytes from @fd to the output file using an intermediate memory
+ * @buffer. Return the number of bytes copied or %-1 on read error. */
+static ssize_t copy_fd_buffered(struct task *task, int fd, size_t len,
+				struct buffer *buffer)
+{
+	size_t done = 0;
+	ssize_t r, c;
+
+	c = buffer_make_room(buffer, task->opts->read_chunk_size, false,
+			     task->opts->max_buffer_size);
+	if (c <= 0)
+		return -1;
+
+	while (done < len) {
+		if ((size_t) c > len - done)
+			c = len - done;
+		r = misc_read_data(fd, buffer->addr + buffer->off, c);
+		if (r <= 0)
+			return r < 0 ? -1 : (ssize_t) done;
+		if (write_output(task, buffer->addr + buffer->off, r))
+			return -1;
+		done += r;
+	}
+
+	return done;
+}
+
+/* Copy @len bytes from @fd to the output file without copying data to user
+ * space. Fall back to a buffered copy if the kernel does not support this for
+ * the given file descriptors. Return the number of bytes copied or %-1 on
+ * read error. */
+static ssize_t copy_fd(struct task *task, int fd, size_t len,
+		       struct buffer *buffer)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = sendfile(task->output_fd, fd, NULL, len - done);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			if (done == 0 && (errno == EINVAL || errno == ENOSYS))
+				return copy_fd_buffered(task, fd, len, buffer);
+			return -1;
+		}
+		if (r == 0)
+			break;
+		task->output_written += r;
+		done += r;
+	}
+
+	return done;
+}
+
+/* Write tar entry for a regular file for which the data is read directly from
+ * the open file descriptor @job->stream_fd. Must be called with output_lock
  * held. */
-static void _write_job_data(struct task *task, struct job *job)
+static void _write_job_stream(struct task *task, struct job *job)
 {
-	struct buffer *buffer = job->content;
+	size_t len = job->stream_len;
+	ssize_t done;
+
+	if (tar_emit_file_from_data(job->outname, NULL, len, &job->stat,
+				    TYPE_REGULAR, NULL, _write_job_data_cb,
+				    task))
+		return;
+
+	done = copy_fd(task, job->stream_fd, len, job->content);
+	if (done < 0) {
+		read_error(task, job->inname, "Cannot read file");
+		done = 0;
+	} else if ((size_t) done < len) {
+		mwarnx("%s: Warning: File shrank by %zu bytes - padding with "
+		       "zeroes", job->inname, len - done);
+	}
+
+	/* Size in tar header is fixed - fill up missing data */
+	if (write_zeroes(task, len - done))
+		return;
+	tar_emit_padding(_write_job_data_cb, task, len);
+}
+
+/* Check if a tar entry is written for @job */
+static bool job_has_entry(struct task *task, struct job *job)
+{
+	if (job->type == JOB_INIT)
+		return false;
 
 	switch (job->status) {
 	case JOB_DONE:
 	case JOB_PARTIAL:
-		break;
+		return true;
 	case JOB_FAILED:
 		/* Create empty entries for failed reads */
-		if (task->opts->ignore_failed_read)
-			break;
-		return;
+		return task->opts->ignore_failed_read;
 	default:
+		return false;
+	}
+}
+
+/* Write tar entry for data in @job to output. Must be called with output_lock
+ * held. */
+static void _write_job_data(struct task *task, struct job *job)
+{
+	struct buffer *buffer = job->content;
+
+	if (!job_has_entry(task, job))
 		return;
+
+	if (task->manifest_fp) {
+		manifest_add(task->manifest_fp, job->outname, job->hash,
+			     job->size, job->stat.st_mtime);
 	}
+	if (job->unchanged)
+		return;
 
 	switch (job->type) {
 	case JOB_CMD:
@@ -615,6 +823,11 @@ static void _write_job_data(struct task *task, struct job *job)
 		}
 		break;
 	case JOB_FILE:
+		if (job->stream_fd >= 0) {
+			_write_job_stream(task, job);
+			task->output_num_files++;
+			break;
+		}
 		tar_emit_file_from_buffer(job->outname, NULL, buffer->total,
 					  &job->stat, TYPE_REGULAR, buffer,
 					  _write_job_data_cb, task);
@@ -749,13 +962,35 @@ static int read_fd(struct task *task, const char *name, int fd,
 	return EXIT_OK;
 }
 
+/* Check if the file system of file @fd reports unreliable file sizes */
+static bool is_pseudo_fs(int fd)
+{
+	struct statfs sfs;
+
+	if (fstatfs(fd, &sfs))
+		return true;
+
+	switch (sfs.f_type) {
+	case PROC_SUPER_MAGIC:
+	case SYSFS_MAGIC:
+	case DEBUGFS_MAGIC:
+	case TRACEFS_MAGIC:
+	case SECURITYFS_MAGIC:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* Read data from the file at @filename until an end-of-file condition is
  * encountered. On success, @buffer contains the data read and the return
  * value is %EXIT_OK. If @relname is non-null it points to the name of the
  * file relative to its parent directory for which @dirfd is an open file
- * handle. */
+ * handle. If @pseudo_fs is non-null it is set to indicate whether the file
+ * resides on a pseudo file system. */
 static int read_regular(struct task *task, const char *filename,
-			const char *relname, int dirfd, struct buffer *buffer)
+			const char *relname, int dirfd, struct buffer *buffer,
+			bool *pseudo_fs)
 {
 	int fd, rc = EXIT_OK;
 	bool need_close = true;
@@ -777,6 +1012,8 @@ static int read_regular(struct task *task, const char *filename,
 		return EXIT_RUNTIME;
 	}
 
+	if (pseudo_fs)
+		*pseudo_fs = is_pseudo_fs(fd);
 	rc = read_fd(task, filename, fd, buffer);
 	if (rc) {
 		if (is_aborted(task))
@@ -791,6 +1028,66 @@ static int read_regular(struct task *task, const char *filename,
 	return rc;
 }
 
+/* Check if the contents of the regular file for @job can be copied directly
+ * to the output file when writing the tar entry instead of reading it to
+ * memory first. This requires an uncompressed output file and a file size
+ * that reliably reflects the amount of data in the file. */
+static bool is_streamable(struct task *task, struct job *job)
+{
+	if (task->opts->gzip)
+		return false;
+	if (!S_ISREG(job->stat.st_mode))
+		return false;
+	/* Small files are more efficiently handled by the buffered path */
+	if ((size_t) job->stat.st_size < task->opts->max_buffer_size)
+		return false;
+
+	return true;
+}
+
+/* Open the regular file for @job for copying its contents directly to the
+ * output file. Return %EXIT_OK on success, %EXIT_RUNTIME on error. If the
+ * file is not suitable for streaming, return %EXIT_OK without setting
+ * @job->stream_fd. If @relname is non-null it points to the name of the file
+ * relative to its parent directory for which @dirfd is an open file handle. */
+static int open_stream(struct task *task, struct job *job, const char *relname,
+		       int dirfd)
+{
+	struct stat st;
+	size_t len;
+	int fd;
+
+	cancel_enable();
+	if (relname)
+		fd = openat(dirfd, relname, O_RDONLY);
+	else
+		fd = open(job->inname, O_RDONLY);
+	cancel_disable();
+
+	if (fd < 0) {
+		read_error(task, job->inname, "Cannot open file");
+		return EXIT_RUNTIME;
+	}
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || is_pseudo_fs(fd)) {
+		close(fd);
+		return EXIT_OK;
+	}
+
+	len = st.st_size;
+	if (task->opts->file_max_size > 0 && len > task->opts->file_max_size) {
+		len = task->opts->file_max_size;
+		mwarnx("%s: Warning: Data exceeds maximum size of %ld "
+		       "bytes - truncating", job->inname,
+		       task->opts->file_max_size);
+	}
+
+	job->stream_fd = fd;
+	job->stream_len = len;
+
+	return EXIT_OK;
+}
+
 /* Read the output of command @cmd until an end-of-file condition is
  * encountered. On success, @buffer contain the output and the return value
  * is %EXIT_OK. When not %NULL, use @status_ptr to store the resulting process
@@ -836,66 +1133,174 @@ static const char *get_exclude_match(struct task *task, const char *filename)
 	return NULL;
 }
 
-/* Add the specified @job to the start of the job queue */
-static void _queue_job_head(struct task *task, struct job *job)
+static void job_queue_init(struct job_queue *queue)
 {
-	DBG("queue job type=%d inname=%s at head", job->type, job->inname);
-	job->next_job = task->jobs_head;
-	task->jobs_head = job;
-	if (!task->jobs_tail)
-		task->jobs_tail = job;
+	pthread_mutex_init(&queue->mutex, NULL);
 }
 
-/* Add the specified @job to the end of the job queue */
-static void _queue_job_tail(struct task *task, struct job *job)
+static void job_queue_lock(struct job_queue *queue)
 {
-	DBG("queue job type=%d inname=%s at tail", job->type, job->inname);
-	if (task->jobs_tail)
-		task->jobs_tail->next_job = job;
+	if (!global_threaded)
+		return;
+	lock_timed(&queue->mutex, &queue->lock_wait_ns);
+}
+
+static void job_queue_unlock(struct job_queue *queue)
+{
+	if (!global_threaded)
+		return;
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+/* Add the list of jobs starting with @first up to @last to the start of
+ * @queue */
+static void _job_queue_add_head(struct job_queue *queue, struct job *first,
+				struct job *last)
+{
+	last->next_job = queue->head;
+	if (queue->head)
+		queue->head->prev_job = last;
+	else
+		queue->tail = last;
+	first->prev_job = NULL;
+	queue->head = first;
+}
+
+/* Add the specified @job to the end of @queue */
+static void _job_queue_add_tail(struct job_queue *queue, struct job *job)
+{
+	job->next_job = NULL;
+	job->prev_job = queue->tail;
+	if (queue->tail)
+		queue->tail->next_job = job;
+	else
+		queue->head = job;
+	queue->tail = job;
+}
+
+/* Remove @job from @queue */
+static void _job_queue_del(struct job_queue *queue, struct job *job)
+{
+	if (job->prev_job)
+		job->prev_job->next_job = job->next_job;
+	else
+		queue->head = job->next_job;
+	if (job->next_job)
+		job->next_job->prev_job = job->prev_job;
 	else
-		task->jobs_head = job;
-	task->jobs_tail = job;
+		queue->tail = job->prev_job;
+	job->next_job = NULL;
+	job->prev_job = NULL;
+}
+
+/* Remove a job from the head of @queue if @head is %true, or from the tail
+ * otherwise, and return it to the caller. Return %NULL if @queue is empty. */
+static struct job *job_queue_get(struct job_queue *queue, bool head)
+{
+	struct job *job;
+
+	/* Racy check to prevent locking when stealing from empty queues */
+	if (!__atomic_load_n(&queue->head, __ATOMIC_RELAXED))
+		return NULL;
+
+	job_queue_lock(queue);
+	job = head ? queue->head : queue->tail;
+	if (job)
+		_job_queue_del(queue, job);
+	job_queue_unlock(queue);
+
+	return job;
 }
 
-/* Add the specified @job to the job queue and trigger processing.
- * If @head is %true, the new job is inserted at the start of the job queue,
- * otherwise at the end. */
-static void queue_job(struct task *task, struct job *job, bool head)
+/* Wake up waiting workers if any. If @all is %true, wake up all workers,
+ * otherwise only one. */
+static void worker_wakeup_idle(struct task *task, bool all)
 {
+	if (!global_threaded ||
+	    __atomic_load_n(&task->num_idle, __ATOMIC_SEQ_CST) == 0)
+		return;
+
 	main_lock(task);
-	task->num_jobs_active++;
-	if (head)
-		_queue_job_head(task, job);
+	if (all)
+		_worker_wakeup_all(task);
 	else
-		_queue_job_tail(task, job);
-	_worker_wakeup_one(task);
+		_worker_wakeup_one(task);
 	main_unlock(task);
 }
 
+/* Add the specified @job to @queue and trigger processing. If @head is
+ * %true, the new job is inserted at the start of the job queue, otherwise at
+ * the end. */
+static void queue_job(struct task *task, struct job_queue *queue,
+		      struct job *job, bool head)
+{
+	DBG("queue job type=%d inname=%s at %s", job->type, job->inname,
+	    head ? "head" : "tail");
+	__atomic_add_fetch(&task->num_jobs_active, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&task->num_jobs_queued, 1, __ATOMIC_SEQ_CST);
+
+	job_queue_lock(queue);
+	if (head)
+		_job_queue_add_head(queue, job, job);
+	else
+		_job_queue_add_tail(queue, job);
+	job_queue_unlock(queue);
+
+	worker_wakeup_idle(task, false);
+}
+
 /* Add the specified list of jobs starting with @first up to @last to the start
- * of the job queue and trigger processing */
-static void queue_jobs(struct task *task, struct job *first, struct job *last,
-		       int num)
+ * of @queue and trigger processing */
+static void queue_jobs(struct task *task, struct job_queue *queue,
+		       struct job *first, struct job *last, int num)
 {
-	main_lock(task);
-	last->next_job = task->jobs_head;
-	task->jobs_head = first;
-	task->num_jobs_active += num;
-	_worker_wakeup_all(task);
-	main_unlock(task);
+	__atomic_add_fetch(&task->num_jobs_active, num, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&task->num_jobs_queued, num, __ATOMIC_SEQ_CST);
+
+	job_queue_lock(queue);
+	_job_queue_add_head(queue, first, last);
+	job_queue_unlock(queue);
+
+	worker_wakeup_idle(task, true);
 }
 
-/* Remove the head of the job queue and return it to the caller */
-static struct job *_dequeue_job(struct task *task)
+/* Steal a job from the tail of the job queue of another thread. Return the
+ * job or %NULL if no job could be found. */
+static struct job *steal_job(struct per_thread *thread)
 {
-	struct job *job = NULL;
+	struct task *task = thread->task;
+	struct job *job;
+	long i, num;
+
+	for (i = 1; i < task->num_threads; i++) {
+		num = (thread->num + i) % task->num_threads;
+		job = job_queue_get(&task->threads[num].queue, false);
+		if (job) {
+			DBG("stole job from worker %ld", num);
+			thread->stats.num_steals++;
+			return job;
+		}
+	}
+
+	return NULL;
+}
+
+/* Remove the next job for @thread from its own job queue, the global job queue
+ * or from the job queue of another thread, and return it to the caller.
+ * Return %NULL if no job is queued. */
+static struct job *dequeue_job(struct per_thread *thread)
+{
+	struct task *task = thread->task;
+	struct job *job;
 
-	if (task->jobs_head) {
-		job = task->jobs_head;
-		task->jobs_head = job->next_job;
-		job->next_job = NULL;
-		if (job == task->jobs_tail)
-			task->jobs_tail = NULL;
+	job = job_queue_get(&thread->queue, true);
+	if (!job)
+		job = job_queue_get(&task->queue, true);
+	if (!job)
+		job = steal_job(thread);
+
+	if (job) {
+		__atomic_sub_fetch(&task->num_jobs_queued, 1, __ATOMIC_SEQ_CST);
 		DBG("dequeueing job type=%d inname=%s", job->type, job->inname);
 		job->status = JOB_IN_PROGRESS;
 	} else {
@@ -906,8 +1311,8 @@ static struct job *_dequeue_job(struct task *task)
 }
 
 /* Create and queue job for file at @filename */
-static void queue_file(struct task *task, const char *inname,
-		       const char *outname, bool is_cmd,
+static void queue_file(struct task *task, struct job_queue *queue,
+		       const char *inname, const char *outname, bool is_cmd,
 		       const char *relname, struct dref *dref,
 		       struct stats *stats, bool head)
 {
@@ -915,19 +1320,21 @@ static void queue_file(struct task *task, const char *inname,
 
 	job = create_job(task, inname, outname, is_cmd, relname, dref, stats);
 	if (job)
-		queue_job(task, job, head);
+		queue_job(task, queue, job, head);
 }
 
 /* Queue initial job */
 static void init_queue(struct task *task)
 {
-	queue_file(task, NULL, NULL, false, NULL, NULL, NULL, true);
+	queue_file(task, &task->queue, NULL, NULL, false, NULL, NULL, NULL,
+		   true);
 }
 
 /* Create and queue jobs for all files found in @dirname */
-static void queue_dir(struct task *task, const char *dirname,
-		      const char *outname, struct stats *stats)
+static void queue_dir(struct per_thread *thread, const char *dirname,
+		      const char *outname)
 {
+	struct task *task = thread->task;
 	struct dirent *de;
 	char *inpath, *outpath;
 	struct dref *dref;
@@ -951,10 +1358,11 @@ static void queue_dir(struct task *task, const char *dirname,
 		inpath = masprintf("%s%s", dirname, de->d_name);
 		outpath = masprintf("%s%s", outname, de->d_name);
 		job = create_job(task, inpath, outpath, false, de->d_name, dref,
-				 stats);
+				 &thread->stats);
 		if (job) {
 			if (last) {
 				last->next_job = job;
+				job->prev_job = last;
 				last = job;
 			} else {
 				first = job;
@@ -967,21 +1375,23 @@ static void queue_dir(struct task *task, const char *dirname,
 	}
 
 	if (first)
-		queue_jobs(task, first, last, num);
+		queue_jobs(task, &thread->queue, first, last, num);
 
 	dref_put(dref);
 }
 
 /* Create and queue jobs for all files specified on the command line */
-static void queue_jobs_from_opts(struct task *task, struct stats *stats)
+static void queue_jobs_from_opts(struct per_thread *thread)
 {
+	struct task *task = thread->task;
 	struct dump_opts *opts = task->opts;
 	unsigned int i;
 
 	/* Queue directly specified entries */
 	for (i = 0; i < opts->num_specs && !is_aborted(task); i++) {
-		queue_file(task, opts->specs[i].inname, opts->specs[i].outname,
-			   opts->specs[i].is_cmd, NULL, NULL, stats, false);
+		queue_file(task, &thread->queue, opts->specs[i].inname,
+			   opts->specs[i].outname, opts->specs[i].is_cmd, NULL,
+			   NULL, &thread->stats, false);
 	}
 }
 
@@ -1000,7 +1410,7 @@ static int open_output(struct task *task)
 
 	cancel_enable();
 #ifdef HAVE_ZLIB
-	if (task->opts->gzip) {
+	if (task->opts->gzip && task->opts->gzip_threads == 0) {
 		if (to_stdout) {
 			task->output_gzfd =
 				gzdopen(STDOUT_FILENO,
@@ -1036,6 +1446,13 @@ static int open_output(struct task *task)
 	}
 
 #ifdef HAVE_ZLIB
+	if (rc == EXIT_OK && task->opts->gzip) {
+		/* Compress output in parallel using independent gzip members */
+		task->output_pgzip = pgzip_open(task->output_fd,
+						task->opts->gzip_threads);
+		if (!task->output_pgzip)
+			rc = EXIT_RUNTIME;
+	}
 out:
 #endif /* HAVE_ZLIB */
 	cancel_disable();
@@ -1089,7 +1506,7 @@ static void process_job(struct per_thread *thread, struct job *job)
 			status = JOB_FAILED;
 			goto out;
 		}
-		queue_jobs_from_opts(task, &thread->stats);
+		queue_jobs_from_opts(thread);
 		break;
 	case JOB_CMD: /* Capture command output */
 		tverb("Dumping command output '%s'\n", job->inname);
@@ -1111,14 +1528,23 @@ static void process_job(struct per_thread *thread, struct job *job)
 		tverb("Dumping directory '%s'\n", job->inname);
 
 		if (task->opts->recursive) {
-			queue_dir(task, job->inname, job->outname,
-				  &thread->stats);
+			queue_dir(thread, job->inname, job->outname);
 		}
 		break;
 	case JOB_FILE: /* Read file contents */
 		tverb("Dumping file '%s'\n", job->inname);
 
-		if (read_regular(task, job->inname, relname, dirfd, buffer))
+		if (is_streamable(task, job)) {
+			if (open_stream(task, job, relname, dirfd)) {
+				status = JOB_FAILED;
+				break;
+			}
+			/* Data is copied when writing the tar entry */
+			if (job->stream_fd >= 0)
+				break;
+		}
+		if (read_regular(task, job->inname, relname, dirfd, buffer,
+				 &job->pseudo_fs))
 			status = JOB_FAILED;
 
 		break;
@@ -1140,6 +1566,11 @@ static void account_stats(struct task *task, struct stats *stats,
 	if (job->type == JOB_INIT)
 		return;
 
+	if (job->unchanged) {
+		stats->num_unchanged++;
+		return;
+	}
+
 	switch (job->status) {
 	case JOB_DONE:
 		stats->num_done++;
@@ -1170,6 +1601,9 @@ static void add_stats(struct stats *to, struct stats *from)
 	to->num_partial += from->num_partial;
 	to->num_excluded += from->num_excluded;
 	to->num_failed += from->num_failed;
+	to->num_steals += from->num_steals;
+	to->num_unchanged += from->num_unchanged;
+	to->num_deleted += from->num_deleted;
 }
 
 /* Release resources allocated to @thread */
@@ -1205,25 +1639,37 @@ static void stop_thread_job(struct per_thread *thread, struct job *job)
 	buffer_reset(&thread->buffer);
 }
 
-/* Wait until a job is available in the job queue. When a job becomes
+/* Wait until a job is available in any job queue. When a job becomes
  * available, dequeue and return it. Return %NULL if no more jobs are
- * available, or if processing was aborted. Must be called with task->mutex
- * locked. */
-static struct job *_get_next_job(struct task *task)
+ * available, or if processing was aborted. */
+static struct job *get_next_job(struct per_thread *thread)
 {
+	struct task *task = thread->task;
 	struct job *job = NULL;
+	int rc = 0;
 
-	do {
+	while (rc == 0) {
 		DBG("checking for jobs");
-		if (task->aborted)
+		if (is_aborted(task))
 			break;
-		job = _dequeue_job(task);
+		job = dequeue_job(thread);
 		if (job)
 			break;
-		if (task->num_jobs_active == 0)
+		if (__atomic_load_n(&task->num_jobs_active, __ATOMIC_SEQ_CST) == 0)
 			break;
-		DBG("found no jobs (%d active)", task->num_jobs_active);
-	} while (_worker_wait(task) == 0);
+
+		/* Wait for new jobs to be queued */
+		main_lock(task);
+		__atomic_add_fetch(&task->num_idle, 1, __ATOMIC_SEQ_CST);
+		if (!task->aborted &&
+		    __atomic_load_n(&task->num_jobs_queued, __ATOMIC_SEQ_CST) == 0 &&
+		    __atomic_load_n(&task->num_jobs_active, __ATOMIC_SEQ_CST) > 0) {
+			DBG("found no jobs (%ld active)", task->num_jobs_active);
+			rc = _worker_wait(task);
+		}
+		__atomic_sub_fetch(&task->num_idle, 1, __ATOMIC_SEQ_CST);
+		main_unlock(task);
+	}
 
 	return job;
 }
@@ -1251,6 +1697,105 @@ static void write_job_data(struct task *task, struct job *job)
 	output_unlock(task);
 }
 
+/* Callback for hashing chunks of job data */
+static int _hash_job_data_cb(void *data, void *addr, size_t len)
+{
+	unsigned long long *hash = data;
+
+	*hash = manifest_hash(*hash, addr, len);
+
+	return 0;
+}
+
+/* Compute the content hash of the first @len bytes of the file at @fd
+ * without changing the file offset. Return %EXIT_OK on success,
+ * %EXIT_RUNTIME otherwise. */
+static int hash_fd(struct task *task, int fd, size_t len,
+		   unsigned long long *hash)
+{
+	size_t chunk = task->opts->read_chunk_size;
+	off_t off = 0;
+	ssize_t r;
+	char *buf;
+
+	buf = mmalloc(chunk);
+	*hash = MANIFEST_HASH_INIT;
+	while ((size_t) off < len) {
+		if (chunk > len - off)
+			chunk = len - off;
+		r = pread(fd, buf, chunk, off);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			break;
+		*hash = manifest_hash(*hash, buf, r);
+		off += r;
+	}
+	free(buf);
+
+	return (size_t) off == len ? EXIT_OK : EXIT_RUNTIME;
+}
+
+/* Determine manifest data for @job and check if the corresponding entry
+ * is unchanged since the previous run */
+static void check_manifest(struct task *task, struct job *job)
+{
+	struct manifest_entry *entry = NULL;
+	struct buffer *buffer = job->content;
+
+	if (!task->manifest && !task->manifest_fp)
+		return;
+
+	if (task->manifest && job->type != JOB_INIT) {
+		entry = manifest_find(task->manifest, job->outname);
+		/* Prevent entries which could not be read from being reported
+		 * as deleted */
+		if (entry)
+			entry->seen = true;
+	}
+	if (!job_has_entry(task, job))
+		return;
+
+	/* Entries without hash are identified by size and modification time */
+	job->hash = 0;
+	switch (job->type) {
+	case JOB_FILE:
+		/* Hash streamed files separately so that the same comparison
+		 * is used whether or not a file was streamed. Reading such a
+		 * file twice is needed only if it has changed. */
+		if (job->stream_fd >= 0) {
+			job->size = job->stream_len;
+			if (hash_fd(task, job->stream_fd, job->stream_len,
+				    &job->hash))
+				return;
+			break;
+		}
+		/* fall through */
+	case JOB_CMD:
+		job->size = buffer->total;
+		job->hash = MANIFEST_HASH_INIT;
+		buffer_iterate(buffer, _hash_job_data_cb, &job->hash);
+		break;
+	case JOB_LINK:
+		job->size = 0;
+		job->hash = manifest_hash(MANIFEST_HASH_INIT, buffer->addr,
+					  strlen(buffer->addr));
+		break;
+	default:
+		job->size = 0;
+		break;
+	}
+
+	if (!entry || entry->size != job->size || entry->hash != job->hash)
+		return;
+	/* Modification times of files on pseudo file systems are not related
+	 * to content changes */
+	if ((job->hash == 0 || (job->type == JOB_FILE && !job->pseudo_fs)) &&
+	    entry->mtime != job->stat.st_mtime)
+		return;
+	job->unchanged = true;
+}
+
 /* Perform second part of job processing for @job at @thread by writing the
  * resulting tar file entry */
 static void postprocess_job(struct per_thread *thread, struct job *job,
@@ -1258,6 +1803,7 @@ static void postprocess_job(struct per_thread *thread, struct job *job,
 {
 	struct task *task = thread->task;
 
+	check_manifest(task, job);
 	account_stats(task, &thread->stats, job);
 	if (cancelable)
 		write_job_data(task, job);
@@ -1266,14 +1812,18 @@ static void postprocess_job(struct per_thread *thread, struct job *job,
 }
 
 /* Mark @job as complete by releasing all associated resources. If this was
- * the last active job inform main thread. Must be called with main_lock
- * mutex held. */
-static void _complete_job(struct task *task, struct job *job)
+ * the last active job inform main thread and idle workers. */
+static void complete_job(struct task *task, struct job *job)
 {
-	task->num_jobs_active--;
-	if (task->num_jobs_active == 0)
-		_main_wakeup(task);
 	free_job(task, job);
+	if (__atomic_sub_fetch(&task->num_jobs_active, 1,
+			       __ATOMIC_SEQ_CST) > 0)
+		return;
+
+	main_lock(task);
+	_main_wakeup(task);
+	_worker_wakeup_all(task);
+	main_unlock(task);
 }
 
 static void init_thread(struct per_thread *thread, struct task *task, long num)
@@ -1281,6 +1831,31 @@ static void init_thread(struct per_thread *thread, struct task *task, long num)
 	memset(thread, 0, sizeof(struct per_thread));
 	thread->task = task;
 	thread->num = num;
+	job_queue_init(&thread->queue);
+}
+
+/* Abort all jobs remaining on @queue and account to @stats */
+static void abort_queue(struct task *task, struct job_queue *queue)
+{
+	struct job *job;
+
+	while ((job = job_queue_get(queue, true))) {
+		DBG("aborting job %s", job->inname);
+		task->stats.num_failed++;
+		job->status = JOB_FAILED;
+		__atomic_sub_fetch(&task->num_jobs_queued, 1, __ATOMIC_SEQ_CST);
+		complete_job(task, job);
+	}
+}
+
+/* Abort any remaining queued jobs and account to @stats */
+static void abort_queued_jobs(struct task *task)
+{
+	long i;
+
+	abort_queue(task, &task->queue);
+	for (i = 0; i < task->num_threads; i++)
+		abort_queue(task, &task->threads[i].queue);
 }
 
 /* Dequeue and process all jobs on the job queue */
@@ -1290,16 +1865,21 @@ static int process_queue(struct task *task)
 	struct per_thread thread;
 
 	init_thread(&thread, task, 0);
+	task->threads = &thread;
+	task->num_threads = 1;
 
-	while ((job = _dequeue_job(task)) && !is_aborted(task)) {
+	while (!is_aborted(task) && (job = dequeue_job(&thread))) {
 		start_thread_job(&thread, job);
 		process_job(&thread, job);
 		postprocess_job(&thread, job, false);
 		stop_thread_job(&thread, job);
-		_complete_job(task, job);
+		complete_job(task, job);
 	}
 
 	task->stats = thread.stats;
+	abort_queued_jobs(task);
+	task->threads = NULL;
+	task->num_threads = 0;
 	cleanup_thread(&thread);
 
 	return EXIT_OK;
@@ -1344,26 +1924,29 @@ static void *worker_thread_main(void *d)
 		if (thread->timed_out)
 			goto out;
 		stop_thread_job(thread, job);
-		_complete_job(task, job);
 		main_unlock(task);
+		complete_job(task, job);
 	}
 
 	DBG("enter worker loop");
 
-	main_lock(task);
-	while ((job = _get_next_job(task))) {
+	while ((job = get_next_job(thread))) {
+		job_lock(task);
 		start_thread_job(thread, job);
-		main_unlock(task);
+		job_unlock(task);
 
 		process_job(thread, job);
 		postprocess_job(thread, job, true);
 
-		main_lock(task);
+		job_lock(task);
+		/* Only set by per-file timeout handling with main lock held */
 		if (thread->timed_out)
 			goto out;
 		stop_thread_job(thread, job);
-		_complete_job(task, job);
+		job_unlock(task);
+		complete_job(task, job);
 	}
+	main_lock(task);
 
 out:
 	thread->running = false;
@@ -1483,7 +2066,8 @@ static int wait_for_completion(struct task *task, struct per_thread *threads)
 	inc_timespec(&tool_deadline_ts, task->opts->timeout, 0);
 
 	main_lock(task);
-	while (!task->aborted && task->num_jobs_active > 0) {
+	while (!task->aborted &&
+	       __atomic_load_n(&task->num_jobs_active, __ATOMIC_SEQ_CST) > 0) {
 		/* Calculate nearest timeout */
 		earliest_timeout = 0;
 		earliest_ts = NULL;
@@ -1495,11 +2079,13 @@ static int wait_for_completion(struct task *task, struct per_thread *threads)
 		}
 
 		for (i = 0; i < task->opts->jobs; i++) {
+			/* Per-thread job information is only protected by the
+			 * main lock when per-file timeouts are active */
+			if (task->opts->file_timeout == 0)
+				break;
 			job = threads[i].job;
 			if (!job || !job->timed)
 				continue;
-			if (task->opts->file_timeout == 0)
-				continue;
 			if (!earliest_ts ||
 			    ts_before(&job->deadline, earliest_ts)) {
 				earliest_timeout = task->opts->file_timeout;
@@ -1565,7 +2151,11 @@ static int wait_for_completion(struct task *task, struct per_thread *threads)
 static void close_output(struct task *task)
 {
 #ifdef HAVE_ZLIB
-	if (task->opts->gzip) {
+	if (task->output_pgzip) {
+		if (pgzip_close(task->output_pgzip, &task->pgzip_stats))
+			write_error(task, "Cannot write output");
+		task->output_pgzip = NULL;
+	} else if (task->opts->gzip) {
 		gzclose(task->output_gzfd);
 		return;
 	}
@@ -1575,6 +2165,62 @@ static void close_output(struct task *task)
 		close(task->output_fd);
 }
 
+/* Write an archive entry listing the names of all entries of the previous
+ * run's manifest that were not found in this run */
+static void write_deleted_list(struct task *task)
+{
+	unsigned long num;
+	struct stat st;
+	size_t len;
+	char *list;
+
+	list = manifest_get_unseen(task->manifest, &len, &num);
+	if (num > 0) {
+		set_dummy_stat(&st);
+		tar_emit_file_from_data(DELETED_LIST_NAME, NULL, len, &st,
+					TYPE_REGULAR, list, _write_job_data_cb,
+					task);
+		task->output_num_files++;
+		task->stats.num_deleted = num;
+	}
+	free(list);
+}
+
+/* Open manifest files specified in @task->opts */
+static int open_manifests(struct task *task)
+{
+	if (task->opts->manifest_in) {
+		task->manifest = manifest_read(task->opts->manifest_in);
+		if (!task->manifest)
+			return EXIT_RUNTIME;
+	}
+	if (task->opts->manifest_out) {
+		task->manifest_fp = manifest_create(task->opts->manifest_out);
+		if (!task->manifest_fp)
+			return EXIT_RUNTIME;
+	}
+
+	return EXIT_OK;
+}
+
+/* Release resources associated with manifest files */
+static int close_manifests(struct task *task)
+{
+	int rc = EXIT_OK;
+
+	manifest_free(task->manifest);
+	task->manifest = NULL;
+	if (task->manifest_fp) {
+		if (fclose(task->manifest_fp)) {
+			mwarn("%s: Cannot write file", task->opts->manifest_out);
+			rc = EXIT_RUNTIME;
+		}
+		task->manifest_fp = NULL;
+	}
+
+	return rc;
+}
+
 /* Start multi-threaded processing of job queue */
 static int process_queue_threaded(struct task *task)
 {
@@ -1585,9 +2231,14 @@ static int process_queue_threaded(struct task *task)
 	tverb("Using %ld threads\n", task->opts->jobs);
 	threads = mcalloc(sizeof(struct per_thread), task->opts->jobs);
 
+	/* Job queues must be initialized before any thread starts stealing */
+	for (i = 0; i < task->opts->jobs; i++)
+		init_thread(&threads[i], task, i);
+	task->threads = threads;
+	task->num_threads = task->opts->jobs;
+
 	rc = 0;
 	for (i = 0; i < task->opts->jobs; i++) {
-		init_thread(&threads[i], task, i);
 		rc = start_worker_thread(&threads[i]);
 		if (rc)
 			break;
@@ -1605,28 +2256,23 @@ static int process_queue_threaded(struct task *task)
 		}
 		DBG("join %p", thread->thread);
 		pthread_join(thread->thread, NULL);
+	}
+
+	abort_queued_jobs(task);
+	for (i = 0; i < task->opts->jobs; i++) {
+		thread = &threads[i];
 		add_stats(&task->stats, &thread->stats);
+		task->lock_wait_ns += thread->queue.lock_wait_ns;
 		cleanup_thread(thread);
 	}
+	task->threads = NULL;
+	task->num_threads = 0;
 
 	free(threads);
 
 	return rc;
 }
 
-/* Abort any remaining queued jobs and account to @stats */
-static void abort_queued_jobs(struct task *task)
-{
-	struct job *job;
-
-	while ((job = _dequeue_job(task))) {
-		DBG("aborting job %s", job->inname);
-		task->stats.num_failed++;
-		job->status = JOB_FAILED;
-		_complete_job(task, job);
-	}
-}
-
 /* Print a summary line */
 static void print_summary(struct task *task)
 {
@@ -1646,6 +2292,8 @@ static void print_summary(struct task *task)
 	num_special += stats->num_partial > 0	? 1 : 0;
 	num_special += stats->num_excluded > 0	? 1 : 0;
 	num_special += stats->num_failed > 0	? 1 : 0;
+	num_special += stats->num_unchanged > 0	? 1 : 0;
+	num_special += stats->num_deleted > 0	? 1 : 0;
 
 	num_added = stats->num_done;
 	if (task->opts->ignore_failed_read)
@@ -1680,6 +2328,24 @@ static void print_summary(struct task *task)
 			rc = snprintf(&msg[off], MSG_LEN - off, "%lu failed",
 				      stats->num_failed);
 			HANDLE_RC(rc, MSG_LEN, off, out);
+			if (--num_special > 0) {
+				rc = snprintf(&msg[off], MSG_LEN - off, ", ");
+				HANDLE_RC(rc, MSG_LEN, off, out);
+			}
+		}
+		if (stats->num_unchanged > 0) {
+			rc = snprintf(&msg[off], MSG_LEN - off, "%lu unchanged",
+				      stats->num_unchanged);
+			HANDLE_RC(rc, MSG_LEN, off, out);
+			if (--num_special > 0) {
+				rc = snprintf(&msg[off], MSG_LEN - off, ", ");
+				HANDLE_RC(rc, MSG_LEN, off, out);
+			}
+		}
+		if (stats->num_deleted > 0) {
+			rc = snprintf(&msg[off], MSG_LEN - off, "%lu deleted",
+				      stats->num_deleted);
+			HANDLE_RC(rc, MSG_LEN, off, out);
 		}
 		rc = snprintf(&msg[off], MSG_LEN - off, ") ");
 		HANDLE_RC(rc, MSG_LEN, off, out);
@@ -1693,6 +2359,44 @@ out:
 	info("%s\n", msg);
 }
 
+/* Print a summary line for job queue statistics */
+static void print_queue_summary(struct task *task)
+{
+	struct timespec zero_ts = { 0, 0 }, wait_ts;
+	unsigned long long wait_ns;
+	char duration[MSG_LEN];
+
+	if (!task->opts->verbose || task->opts->jobs == 0)
+		return;
+
+	wait_ns = task->lock_wait_ns + task->queue.lock_wait_ns;
+	wait_ts.tv_sec = wait_ns / NSEC_PER_SEC;
+	wait_ts.tv_nsec = wait_ns % NSEC_PER_SEC;
+	snprintf_duration(duration, sizeof(duration), &zero_ts, &wait_ts);
+	info("Stole %lu jobs from other threads, waited %s for locks\n",
+	     task->stats.num_steals, duration);
+}
+
+/* Print a summary line for parallel compression */
+static void print_compress_summary(struct task *task)
+{
+#ifdef HAVE_ZLIB
+	struct pgzip_stats *stats = &task->pgzip_stats;
+	struct timespec zero_ts = { 0, 0 };
+	char duration[MSG_LEN];
+
+	if (task->opts->quiet || task->opts->gzip_threads == 0)
+		return;
+
+	snprintf_duration(duration, sizeof(duration), &zero_ts,
+			  &stats->cpu_time);
+	info("Compressed %zu bytes to %zu bytes using %ld thread%s "
+	     "(compression CPU time %s)\n",
+	     stats->bytes_in, stats->bytes_out, task->opts->gzip_threads,
+	     task->opts->gzip_threads > 1 ? "s" : "", duration);
+#endif /* HAVE_ZLIB */
+}
+
 static int init_task(struct task *task, struct dump_opts *opts)
 {
 	pthread_condattr_t attr;
@@ -1703,6 +2407,7 @@ static int init_task(struct task *task, struct dump_opts *opts)
 	pthread_mutex_init(&task->mutex, NULL);
 	pthread_mutex_init(&task->output_mutex, NULL);
 	pthread_cond_init(&task->worker_cond, NULL);
+	job_queue_init(&task->queue);
 
 	pthread_condattr_init(&attr);
 	if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) ||
@@ -1755,12 +2460,15 @@ void dump_opts_print(struct dump_opts *opts)
 		printf("DEBUG:  exclude_type[%d]=%d\n", i,
 		       opts->exclude_type[i]);
 	printf("DEBUG:  gzip=%d\n", opts->gzip);
+	printf("DEBUG:  gzip_threads=%ld\n", opts->gzip_threads);
 	printf("DEBUG:  ignore_failed_read=%d\n", opts->ignore_failed_read);
 	printf("DEBUG:  no_eof=%d\n", opts->no_eof);
 	printf("DEBUG:  quiet=%d\n", opts->quiet);
 	printf("DEBUG:  recursive=%d\n", opts->recursive);
 	printf("DEBUG:  threaded=%d\n", opts->threaded);
 	printf("DEBUG:  verbose=%d\n", opts->verbose);
+	printf("DEBUG:  manifest_in=%s\n", opts->manifest_in);
+	printf("DEBUG:  manifest_out=%s\n", opts->manifest_out);
 	printf("DEBUG:  output_file=%s\n", opts->output_file);
 	printf("DEBUG:  file_timeout=%d\n", opts->file_timeout);
 	printf("DEBUG:  timeout=%d\n", opts->timeout);
@@ -1835,6 +2543,12 @@ int dump_to_tar(struct dump_opts *opts)
 	if (rc)
 		return rc;
 
+	rc = open_manifests(&task);
+	if (rc) {
+		close_manifests(&task);
+		return rc;
+	}
+
 	/* Queue initial job */
 	init_queue(&task);
 
@@ -1845,12 +2559,20 @@ int dump_to_tar(struct dump_opts *opts)
 		rc = process_queue(&task);
 	abort_queued_jobs(&task);
 
+	/* Deleted entries can only be determined after a complete run */
+	if (task.manifest && !task.aborted)
+		write_deleted_list(&task);
+
 	if (task.output_num_files > 0 && !opts->no_eof)
 		write_eof(&task);
 
-	print_summary(&task);
-
 	close_output(&task);
+	if (close_manifests(&task))
+		task.aborted = true;
+
+	print_summary(&task);
+	print_queue_summary(&task);
+	print_compress_summary(&task);
 
 	if (rc == 0 && task.aborted)
 		rc = EXIT_RUNTIME;
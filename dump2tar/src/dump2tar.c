@@ -33,6 +33,9 @@
 #define	OPT_DEREFERENCE		(OPT_NOSHORT_BASE + 0)
 #define OPT_NORECURSION		(OPT_NOSHORT_BASE + 1)
 #define OPT_EXCLUDETYPE		(OPT_NOSHORT_BASE + 2)
+#define OPT_GZIPTHREADS		(OPT_NOSHORT_BASE + 3)
+#define OPT_MANIFESTIN		(OPT_NOSHORT_BASE + 4)
+#define OPT_MANIFESTOUT		(OPT_NOSHORT_BASE + 5)
 
 /* Program description */
 static const struct util_prg dump2tar_prg = {
@@ -65,6 +68,13 @@ static struct util_opt dump2tar_opts[] = {
 		.option = { "gzip", no_argument, NULL, 'z' },
 		.desc = "Write a gzip compressed archive",
 	},
+	{
+		.option = { "gzip-threads", required_argument, NULL,
+			    OPT_GZIPTHREADS },
+		.argument = "N",
+		.desc = "Compress archive in parallel using N threads",
+		.flags = UTIL_OPT_FLAG_NOSHORT,
+	},
 #endif /* HAVE_ZLIB */
 	{
 		.option = { "max-size", required_argument, NULL, 'm' },
@@ -91,6 +101,20 @@ static struct util_opt dump2tar_opts[] = {
 		.desc = "Append output to end of file",
 		.flags = UTIL_OPT_FLAG_NOSHORT,
 	},
+	{
+		.option = { "manifest-out", required_argument, NULL,
+			    OPT_MANIFESTOUT },
+		.argument = "FILE",
+		.desc = "Write manifest of archive entries to FILE",
+		.flags = UTIL_OPT_FLAG_NOSHORT,
+	},
+	{
+		.option = { "manifest-in", required_argument, NULL,
+			    OPT_MANIFESTIN },
+		.argument = "FILE",
+		.desc = "Only add entries changed since manifest FILE",
+		.flags = UTIL_OPT_FLAG_NOSHORT,
+	},
 
 	UTIL_OPT_SECTION("INPUT OPTIONS"),
 	{
@@ -404,6 +428,12 @@ int main(int argc, char *argv[])
 		case 133: /* --append */
 			opts->append = true;
 			break;
+		case OPT_MANIFESTOUT: /* --manifest-out FILE */
+			opts->manifest_out = optarg;
+			break;
+		case OPT_MANIFESTIN: /* --manifest-in FILE */
+			opts->manifest_in = optarg;
+			break;
 		case 't': /* --timeout VALUE */
 			opts->timeout = atoi(optarg);
 			if (opts->timeout < 1) {
@@ -435,6 +465,14 @@ int main(int argc, char *argv[])
 		case 'z': /* --gzip */
 			opts->gzip = true;
 			break;
+		case OPT_GZIPTHREADS: /* --gzip-threads N */
+			opts->gzip_threads = atoi(optarg);
+			if (opts->gzip_threads < 1) {
+				mwarnx("Invalid number of threads: %s", optarg);
+				goto out;
+			}
+			opts->gzip = true;
+			break;
 		case 1: /* Filename specification or unrecognized option */
 			if (optarg[0] == '-') {
 				mwarnx("Invalid option '%s'", optarg);
@@ -0,0 +1,250 @@
+/*
+ * dump2tar - tool to dump files and command output into a tar archive
+ *
+ * Manifests for incremental archives
+ *
+ * A manifest is a text file that contains one line for each archive entry:
+ *
+ *   <hash> <size> <mtime> <name>
+ *
+ * <hash> is the hexadecimal 64 bit FNV-1a hash of the entry data or 0 if
+ * the entry was identified by size and modification time only. <size> is
+ * the size of the entry data in bytes, <mtime> the modification time in
+ * seconds since the epoch and <name> the name of the entry in the archive.
+ *
+ * Copyright IBM Corp. 2016, 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "manifest.h"
+#include "misc.h"
+
+#define MANIFEST_HEADER		"# dump2tar manifest v1"
+#define FNV_PRIME		0x100000001b3ULL
+
+struct manifest {
+	struct manifest_entry **hash_table;
+	unsigned long hash_size;	/* Number of hash buckets (power of 2) */
+	unsigned long num;		/* Number of entries */
+};
+
+/* Update the 64 bit FNV-1a @hash with @len bytes at @addr and return the
+ * result. Use %MANIFEST_HASH_INIT as initial value. */
+unsigned long long manifest_hash(unsigned long long hash, const void *addr,
+				 size_t len)
+{
+	const unsigned char *ptr = addr;
+
+	while (len-- > 0) {
+		hash ^= *ptr++;
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/* Return the hash bucket for entry @name */
+static unsigned long get_bucket(struct manifest *manifest, const char *name)
+{
+	return manifest_hash(MANIFEST_HASH_INIT, name, strlen(name)) &
+	       (manifest->hash_size - 1);
+}
+
+/* Parse manifest @line and return the resulting entry or %NULL if @line
+ * is not a valid manifest line */
+static struct manifest_entry *parse_line(char *line)
+{
+	struct manifest_entry *entry;
+	unsigned long long hash, size;
+	long long mtime;
+	char *name;
+	int off = -1;
+
+	if (sscanf(line, "%llx %llu %lld%n", &hash, &size, &mtime, &off) < 3 ||
+	    off < 0 || line[off] != ' ' || !line[off + 1])
+		return NULL;
+	name = &line[off + 1];
+
+	entry = mmalloc(sizeof(struct manifest_entry) + strlen(name) + 1);
+	entry->hash = hash;
+	entry->size = size;
+	entry->mtime = mtime;
+	strcpy(entry->name, name);
+
+	return entry;
+}
+
+/* Read manifest from file @filename. Return the resulting manifest on
+ * success, %NULL otherwise. */
+struct manifest *manifest_read(const char *filename)
+{
+	struct manifest_entry *list = NULL, *entry, *next;
+	struct manifest *manifest;
+	unsigned long lineno = 0, bucket;
+	size_t line_size;
+	char *line = NULL;
+	FILE *fd;
+
+	fd = fopen(filename, "r");
+	if (!fd) {
+		mwarn("%s: Cannot open file", filename);
+		return NULL;
+	}
+
+	manifest = mmalloc(sizeof(struct manifest));
+	while (getline(&line, &line_size, fd) != -1) {
+		lineno++;
+		chomp(line, "\n");
+		if (lineno == 1 && strcmp(line, MANIFEST_HEADER) != 0) {
+			mwarnx("%s: Not a dump2tar manifest", filename);
+			goto err;
+		}
+		if (line[0] == '#' || line[0] == 0)
+			continue;
+		entry = parse_line(line);
+		if (!entry) {
+			mwarnx("%s:%lu: Invalid manifest entry", filename,
+			       lineno);
+			goto err;
+		}
+		entry->next = list;
+		list = entry;
+		manifest->num++;
+	}
+	if (ferror(fd)) {
+		mwarn("%s: Cannot read file", filename);
+		goto err;
+	}
+	free(line);
+	fclose(fd);
+
+	/* Use one hash bucket per entry on average */
+	manifest->hash_size = 1;
+	while (manifest->hash_size < manifest->num)
+		manifest->hash_size <<= 1;
+	manifest->hash_table = mcalloc(manifest->hash_size,
+				       sizeof(struct manifest_entry *));
+	for (entry = list; entry; entry = next) {
+		next = entry->next;
+		bucket = get_bucket(manifest, entry->name);
+		entry->next = manifest->hash_table[bucket];
+		manifest->hash_table[bucket] = entry;
+	}
+
+	return manifest;
+
+err:
+	for (entry = list; entry; entry = next) {
+		next = entry->next;
+		free(entry);
+	}
+	free(manifest);
+	free(line);
+	fclose(fd);
+
+	return NULL;
+}
+
+/* Return the entry for archive entry @name in @manifest or %NULL if there is
+ * no such entry */
+struct manifest_entry *manifest_find(struct manifest *manifest,
+				     const char *name)
+{
+	struct manifest_entry *entry;
+
+	entry = manifest->hash_table[get_bucket(manifest, name)];
+	for (; entry; entry = entry->next) {
+		if (strcmp(entry->name, name) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* Return a newline-separated list of the names of all entries in @manifest
+ * that have not been marked as seen. Store the length of the list in
+ * @len_ptr and the number of entries in @num_ptr. */
+char *manifest_get_unseen(struct manifest *manifest, size_t *len_ptr,
+			  unsigned long *num_ptr)
+{
+	struct manifest_entry *entry;
+	size_t len = 0, off = 0;
+	unsigned long i, num = 0;
+	char *list;
+
+	for (i = 0; i < manifest->hash_size; i++) {
+		for (entry = manifest->hash_table[i]; entry;
+		     entry = entry->next) {
+			if (!entry->seen)
+				len += strlen(entry->name) + 1;
+		}
+	}
+
+	list = mmalloc(len + 1);
+	for (i = 0; i < manifest->hash_size; i++) {
+		for (entry = manifest->hash_table[i]; entry;
+		     entry = entry->next) {
+			if (entry->seen)
+				continue;
+			off += sprintf(&list[off], "%s\n", entry->name);
+			num++;
+		}
+	}
+
+	*len_ptr = len;
+	*num_ptr = num;
+
+	return list;
+}
+
+/* Release all resources associated with @manifest */
+void manifest_free(struct manifest *manifest)
+{
+	struct manifest_entry *entry, *next;
+	unsigned long i;
+
+	if (!manifest)
+		return;
+
+	for (i = 0; i < manifest->hash_size; i++) {
+		for (entry = manifest->hash_table[i]; entry; entry = next) {
+			next = entry->next;
+			free(entry);
+		}
+	}
+	free(manifest->hash_table);
+	free(manifest);
+}
+
+/* Create a new manifest file at @filename. Return a file pointer for use
+ * with manifest_add() on success, %NULL otherwise. */
+FILE *manifest_create(const char *filename)
+{
+	FILE *fp;
+
+	fp = fopen(filename, "w");
+	if (!fp) {
+		mwarn("%s: Cannot create file", filename);
+		return NULL;
+	}
+	fprintf(fp, "%s\n", MANIFEST_HEADER);
+
+	return fp;
+}
+
+/* Add a line for archive entry @name to the manifest file @fp */
+void manifest_add(FILE *fp, const char *name, unsigned long long hash,
+		  size_t size, time_t mtime)
+{
+	/* Names containing newlines cannot be represented */
+	if (strchr(name, '\n'))
+		return;
+	fprintf(fp, "%016llx %zu %lld %s\n", hash, size, (long long) mtime,
+		name);
+}
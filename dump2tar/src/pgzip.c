@@ -0,0 +1,371 @@
+/*
+ * dump2tar - tool to dump files and command output into a tar archive
+ *
+ * Parallel gzip compression
+ *
+ * The uncompressed byte stream is split into blocks of PGZIP_BLOCK_SIZE
+ * bytes. Each block is compressed into an independent gzip member by one
+ * of a pool of compression threads. Members are written to the output file
+ * in the order in which the corresponding blocks were submitted. The
+ * concatenation of gzip members forms a valid gzip file.
+ *
+ * Copyright IBM Corp. 2016, 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "misc.h"
+#include "pgzip.h"
+
+/* A single block of data to compress */
+struct pgzip_block {
+	struct pgzip_block *next_todo;	/* Next block waiting for compression */
+	struct pgzip_block *next_out;	/* Next block in output order */
+	char *in;			/* Uncompressed data */
+	size_t in_len;
+	char *out;			/* Compressed gzip member */
+	size_t out_len;
+	bool done;			/* Compression is complete */
+};
+
+struct pgzip {
+	int fd;
+	long num_threads;
+	pthread_t *threads;
+
+	/* mutex serializes access to all fields below */
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;	/* Block queued or shutdown requested */
+	pthread_cond_t room_cond;	/* Block written */
+	struct pgzip_block *todo_head;
+	struct pgzip_block *todo_tail;
+	struct pgzip_block *out_head;
+	struct pgzip_block *out_tail;
+	unsigned long num_inflight;
+	size_t bytes_pending;		/* Submitted but not yet written */
+	bool writing;
+	bool shutdown;
+	int error;
+	struct pgzip_stats stats;
+
+	/* Only accessed by the caller of pgzip_write() */
+	struct pgzip_block *current;
+};
+
+/* Add the time between @start and @end to @ts */
+static void add_duration(struct timespec *ts, struct timespec *start,
+			 struct timespec *end)
+{
+	ts->tv_sec += end->tv_sec - start->tv_sec;
+	ts->tv_nsec += end->tv_nsec - start->tv_nsec;
+	if (ts->tv_nsec < 0) {
+		ts->tv_nsec += NSEC_PER_SEC;
+		ts->tv_sec--;
+	} else if (ts->tv_nsec >= NSEC_PER_SEC) {
+		ts->tv_nsec -= NSEC_PER_SEC;
+		ts->tv_sec++;
+	}
+}
+
+static struct pgzip_block *block_alloc(void)
+{
+	struct pgzip_block *block = mmalloc(sizeof(struct pgzip_block));
+
+	block->in = mmalloc(PGZIP_BLOCK_SIZE);
+
+	return block;
+}
+
+static void block_free(struct pgzip_block *block)
+{
+	free(block->in);
+	free(block->out);
+	free(block);
+}
+
+/* Compress data of @block into a complete gzip member. Return %EXIT_OK on
+ * success, %EXIT_RUNTIME otherwise. */
+static int block_compress(struct pgzip_block *block)
+{
+	z_stream strm;
+	int rc;
+
+	memset(&strm, 0, sizeof(strm));
+	/* windowBits + 16 selects gzip header and trailer */
+	if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+			 Z_DEFAULT_STRATEGY) != Z_OK)
+		return EXIT_RUNTIME;
+
+	block->out_len = deflateBound(&strm, block->in_len);
+	block->out = mmalloc(block->out_len);
+
+	strm.next_in = (Bytef *) block->in;
+	strm.avail_in = block->in_len;
+	strm.next_out = (Bytef *) block->out;
+	strm.avail_out = block->out_len;
+	rc = deflate(&strm, Z_FINISH);
+	block->out_len -= strm.avail_out;
+	deflateEnd(&strm);
+
+	/* Uncompressed data is no longer needed */
+	free(block->in);
+	block->in = NULL;
+
+	return rc == Z_STREAM_END ? EXIT_OK : EXIT_RUNTIME;
+}
+
+/* Write all completed blocks at the start of the output list in order. Must
+ * be called with pgzip->mutex held. */
+static void _write_completed(struct pgzip *pgzip)
+{
+	struct pgzip_block *block;
+	int rc;
+
+	if (pgzip->writing)
+		return;
+	pgzip->writing = true;
+
+	while ((block = pgzip->out_head) && block->done) {
+		pgzip->out_head = block->next_out;
+		if (!pgzip->out_head)
+			pgzip->out_tail = NULL;
+
+		rc = EXIT_OK;
+		if (!pgzip->error) {
+			pthread_mutex_unlock(&pgzip->mutex);
+			rc = misc_write_data(pgzip->fd, block->out,
+					     block->out_len);
+			pthread_mutex_lock(&pgzip->mutex);
+			if (rc && !pgzip->error)
+				pgzip->error = errno ? errno : EIO;
+		}
+		if (!rc)
+			pgzip->stats.bytes_out += block->out_len;
+		pgzip->bytes_pending -= block->in_len;
+
+		block_free(block);
+		pgzip->num_inflight--;
+		pthread_cond_broadcast(&pgzip->room_cond);
+	}
+
+	pgzip->writing = false;
+}
+
+/* Compression thread: compress queued blocks until shutdown is requested and
+ * no more blocks are queued */
+static void *pgzip_thread_main(void *data)
+{
+	struct pgzip *pgzip = data;
+	struct pgzip_block *block;
+	struct timespec start, end;
+	int rc;
+
+	set_threadname("pgzip");
+
+	pthread_mutex_lock(&pgzip->mutex);
+	while (true) {
+		block = pgzip->todo_head;
+		if (!block) {
+			if (pgzip->shutdown)
+				break;
+			pthread_cond_wait(&pgzip->work_cond, &pgzip->mutex);
+			continue;
+		}
+		pgzip->todo_head = block->next_todo;
+		if (!pgzip->todo_head)
+			pgzip->todo_tail = NULL;
+		pthread_mutex_unlock(&pgzip->mutex);
+
+		/* Threads compress in parallel, so measure CPU time */
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+		rc = block_compress(block);
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+
+		pthread_mutex_lock(&pgzip->mutex);
+		add_duration(&pgzip->stats.cpu_time, &start, &end);
+		if (rc && !pgzip->error)
+			pgzip->error = EIO;
+		block->done = true;
+		_write_completed(pgzip);
+	}
+	pthread_mutex_unlock(&pgzip->mutex);
+	clear_threadname();
+
+	return NULL;
+}
+
+/* Unlock the mutex specified by @data */
+static void cleanup_unlock(void *data)
+{
+	pthread_mutex_unlock(data);
+}
+
+/* Hand the current block over to the compression threads. Wait if too many
+ * blocks are already in flight. Return %EXIT_OK on success, %EXIT_RUNTIME
+ * if an error occurred. */
+static int submit_current(struct pgzip *pgzip)
+{
+	struct pgzip_block *block = pgzip->current;
+	int rc;
+
+	if (!block || block->in_len == 0)
+		return EXIT_OK;
+	pgzip->current = NULL;
+
+	pthread_mutex_lock(&pgzip->mutex);
+
+	/* Limit memory usage to two blocks per thread. Waiting is a
+	 * cancellation point. */
+	pthread_cleanup_push(cleanup_unlock, &pgzip->mutex);
+	while (!pgzip->error &&
+	       pgzip->num_inflight >= (unsigned long) pgzip->num_threads * 2)
+		pthread_cond_wait(&pgzip->room_cond, &pgzip->mutex);
+	pthread_cleanup_pop(0);
+
+	if (pgzip->error) {
+		block_free(block);
+		errno = pgzip->error;
+		rc = EXIT_RUNTIME;
+	} else {
+		pgzip->stats.bytes_in += block->in_len;
+		pgzip->bytes_pending += block->in_len;
+		if (pgzip->todo_tail)
+			pgzip->todo_tail->next_todo = block;
+		else
+			pgzip->todo_head = block;
+		pgzip->todo_tail = block;
+		if (pgzip->out_tail)
+			pgzip->out_tail->next_out = block;
+		else
+			pgzip->out_head = block;
+		pgzip->out_tail = block;
+		pgzip->num_inflight++;
+		pthread_cond_signal(&pgzip->work_cond);
+		rc = EXIT_OK;
+	}
+	pthread_mutex_unlock(&pgzip->mutex);
+
+	return rc;
+}
+
+/* Start @threads compression threads writing to file descriptor @fd. Return
+ * a handle for use with the other pgzip functions on success, %NULL
+ * otherwise. */
+struct pgzip *pgzip_open(int fd, long threads)
+{
+	struct pgzip *pgzip = mmalloc(sizeof(struct pgzip));
+	long i;
+	int rc;
+
+	pgzip->fd = fd;
+	pgzip->threads = mcalloc(threads, sizeof(pthread_t));
+	pthread_mutex_init(&pgzip->mutex, NULL);
+	pthread_cond_init(&pgzip->work_cond, NULL);
+	pthread_cond_init(&pgzip->room_cond, NULL);
+
+	for (i = 0; i < threads; i++) {
+		rc = pthread_create(&pgzip->threads[i], NULL,
+				    &pgzip_thread_main, pgzip);
+		if (rc) {
+			mwarnx("Cannot start compression thread: %s",
+			       strerror(rc));
+			pgzip_close(pgzip, NULL);
+			return NULL;
+		}
+		pgzip->num_threads++;
+	}
+
+	return pgzip;
+}
+
+/* Add @len bytes at @addr to the compressed output stream. Must not be called
+ * concurrently for the same @pgzip. Return %EXIT_OK on success,
+ * %EXIT_RUNTIME otherwise. */
+int pgzip_write(struct pgzip *pgzip, const void *addr, size_t len)
+{
+	struct pgzip_block *block;
+	const char *ptr = addr;
+	size_t c;
+
+	while (len > 0) {
+		if (!pgzip->current)
+			pgzip->current = block_alloc();
+		block = pgzip->current;
+
+		c = PGZIP_BLOCK_SIZE - block->in_len;
+		if (c > len)
+			c = len;
+		memcpy(block->in + block->in_len, ptr, c);
+		block->in_len += c;
+		ptr += c;
+		len -= c;
+
+		if (block->in_len == PGZIP_BLOCK_SIZE && submit_current(pgzip))
+			return EXIT_RUNTIME;
+	}
+
+	return EXIT_OK;
+}
+
+/* Return the number of compressed bytes written to the output file so far
+ * plus the uncompressed size of all data that has not been written yet. The
+ * result is an upper bound for the size of the output file if no more data
+ * is added. Must not be called concurrently with pgzip_write(). */
+size_t pgzip_tell(struct pgzip *pgzip)
+{
+	size_t result;
+
+	pthread_mutex_lock(&pgzip->mutex);
+	result = pgzip->stats.bytes_out + pgzip->bytes_pending;
+	pthread_mutex_unlock(&pgzip->mutex);
+	if (pgzip->current)
+		result += pgzip->current->in_len;
+
+	return result;
+}
+
+/* Compress and write all remaining data, stop compression threads and
+ * release all resources associated with @pgzip. If @stats is specified,
+ * store compression statistics there. Return %EXIT_OK on success,
+ * %EXIT_RUNTIME otherwise. */
+int pgzip_close(struct pgzip *pgzip, struct pgzip_stats *stats)
+{
+	long i;
+	int rc;
+
+	if (!pgzip)
+		return EXIT_OK;
+
+	rc = submit_current(pgzip);
+	if (pgzip->current)
+		block_free(pgzip->current);
+
+	pthread_mutex_lock(&pgzip->mutex);
+	pgzip->shutdown = true;
+	pthread_cond_broadcast(&pgzip->work_cond);
+	pthread_mutex_unlock(&pgzip->mutex);
+
+	for (i = 0; i < pgzip->num_threads; i++)
+		pthread_join(pgzip->threads[i], NULL);
+
+	if (pgzip->error) {
+		errno = pgzip->error;
+		rc = EXIT_RUNTIME;
+	}
+	if (stats)
+		*stats = pgzip->stats;
+
+	pthread_cond_destroy(&pgzip->room_cond);
+	pthread_cond_destroy(&pgzip->work_cond);
+	pthread_mutex_destroy(&pgzip->mutex);
+	free(pgzip->threads);
+	free(pgzip);
+
+	return rc;
+}
@@ -124,7 +124,7 @@ static void init_header(struct tar_header *header, const char *filename,
 }
 
 /* Emit zero bytes via @emit_cb to pad @len to a multiple of BLOCKSIZE */
-static int emit_padding(emit_cb_t emit_cb, void *data, size_t len)
+int tar_emit_padding(emit_cb_t emit_cb, void *data, size_t len)
 {
 	size_t pad = BLOCKSIZE - len % BLOCKSIZE;
 	char zeroes[BLOCKSIZE];
@@ -149,7 +149,7 @@ static int emit_data(emit_cb_t emit_cb, void *data, void *addr, size_t len)
 	rc = emit_cb(data, addr, len);
 	if (rc)
 		return rc;
-	return emit_padding(emit_cb, data, len);
+	return tar_emit_padding(emit_cb, data, len);
 }
 
 /* Emit a tar header via @emit_cb */
@@ -229,7 +229,7 @@ static int emit_content(emit_cb_t emit_cb, void *data, struct buffer *buffer,
 	if (cb_data.rc)
 		return cb_data.rc;
 
-	return emit_padding(emit_cb, data, buffer->total);
+	return tar_emit_padding(emit_cb, data, buffer->total);
 }
 
 /* Convert file meta data and content specified as @content into a
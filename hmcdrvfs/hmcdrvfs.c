@@ -27,6 +27,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "lib/util_base.h"
 #include "lib/util_libc.h"
 #include "lib/zt_common.h"
 
@@ -43,13 +44,23 @@
  */
 #define HMCDRV_FUSE_CACHE_TMOFS 30
 
-/* size of file name/attributes cache (should be a prime number)
+/* initial number of hash table lines of file name/attributes cache (must be
+ * a power of two, the table is doubled if it holds two entries per line)
  */
-#define HMCDRV_FUSE_CACHE_SIZE	2053
+#define HMCDRV_FUSE_CACHE_SIZE	1024
 
-/* number of hash table lines inspected in a single garbage loop
+/* number of locks protecting the hash table lines of the file name/attributes
+ * cache (must be a power of two not larger than HMCDRV_FUSE_CACHE_SIZE)
  */
-#define HMCDRV_FUSE_GARBAGE_MAX 128
+#define HMCDRV_FUSE_CACHE_LOCKS	64
+
+/* min. number of hash table lines inspected in a single garbage loop
+ */
+#define HMCDRV_FUSE_GARBAGE_MAX 128U
+
+/* name of extended attribute on the mount point which reports cache statistics
+ */
+#define HMCDRV_FUSE_XATTR_STATS	"user.hmcdrvfs.cache_stats"
 
 /* max. size of FTP 'dir <path>' output chunk size
  */
@@ -60,6 +71,22 @@
 #define HMCDRV_FUSE_DIRBUF_LEN	(HMCDRV_FUSE_DIRBUF_SIZE - 1)
 
 
+/* size of a block in the file data cache (multiple of DVD sector size)
+ */
+#define HMCDRV_FUSE_BLKSIZE	(1024 * 1024)
+
+/* size of file data cache hash table (should be a prime number)
+ */
+#define HMCDRV_FUSE_BLKHASH	251
+
+/* default size of file data cache in MiB (option "-o cachesize=MB")
+ */
+#define HMCDRV_FUSE_CACHEMB	32
+
+/* default number of blocks to read ahead (option "-o readahead=N")
+ */
+#define HMCDRV_FUSE_READAHEAD	4
+
 /* pointer to path (token) in FTP command string associated with file 'fp'
  */
 #define HMCDRV_FUSE_PATH(fp)	((fp)->ftpcmd + HMCDRV_FUSE_OFSPATH)
@@ -126,6 +153,8 @@ struct hmcdrv_fuse_opt {
 
 	char *hmctz; /* HMC timezone option "-o hmctz=TZ" */
 	char *hmclang; /* HMC locale option "-o hmclang=LANG" */
+	unsigned int cachesize; /* option "-o cachesize=MB" */
+	unsigned int readahead; /* option "-o readahead=N" */
 };
 
 
@@ -140,6 +169,7 @@ struct hmcdrv_fuse_context {
 	time_t ctmo; /* cache timeout (derived from entry/attr_timeout) */
 	pthread_t tid; /* cache aging thread ID */
 	pthread_mutex_t mutex; /* cache access mutex */
+	pthread_mutex_t devmutex; /* FTP device access mutex */
 	pid_t pid; /* PID of main() */
 	char *abmon[12]; /* abbreviated month name of HMC locale */
 	int ablen[12]; /* length of each abbreviated month name */
@@ -159,6 +189,77 @@ struct hmcdrv_fuse_file {
 };
 
 
+/*
+ * file name/attributes cache
+ *
+ * Note: Lookups take the 'rwlock' for reading plus the lock of the hash table
+ *       line. All modifications of entries are made with the context mutex
+ *       held in addition, so entries can be used with this mutex held. A
+ *       resize of the hash table takes 'rwlock' for writing.
+ */
+struct hmcdrv_fuse_cache {
+	pthread_rwlock_t rwlock; /* hash table resize lock */
+	pthread_mutex_t lock[HMCDRV_FUSE_CACHE_LOCKS]; /* hash table line locks */
+	struct hmcdrv_fuse_file **hash; /* hash table */
+	unsigned int size; /* number of hash table lines (power of two) */
+	unsigned int count; /* number of entries */
+	unsigned int index; /* next hash table line to check for expiry */
+	unsigned long hits; /* number of lookups found in cache */
+	unsigned long misses; /* number of lookups not found in cache */
+	unsigned long expired; /* number of entries removed due to aging */
+};
+
+
+/*
+ * state of a block in the file data cache
+ */
+enum hmcdrv_fuse_blkstate {
+	HMCDRV_FUSE_BLK_FREE, /* not hashed, can be reused */
+	HMCDRV_FUSE_BLK_PENDING, /* transfer from HMC drive in progress */
+	HMCDRV_FUSE_BLK_VALID /* data is valid */
+};
+
+
+/*
+ * block of file data cache
+ */
+struct hmcdrv_fuse_block {
+	struct hmcdrv_fuse_block *next; /* collision list (equal hash) */
+	struct hmcdrv_fuse_block *prev_lru; /* more recently used block */
+	struct hmcdrv_fuse_block *next_lru; /* less recently used block */
+	enum hmcdrv_fuse_blkstate state; /* block state */
+	char ftpcmd[HMCDRV_FUSE_MAXCMDLEN]; /* FTP 'get' command + path */
+	time_t mtime; /* modification time of file */
+	off_t blkno; /* block number in file */
+	size_t len; /* valid bytes (less than block size at end of file) */
+	char data[0]; /* file data (HMCDRV_FUSE_BLKSIZE bytes) */
+};
+
+
+/*
+ * file data cache with read-ahead
+ */
+struct hmcdrv_fuse_bcache {
+	pthread_mutex_t mutex; /* block cache access mutex */
+	pthread_cond_t cond; /* block state changed or read-ahead requested */
+	struct hmcdrv_fuse_block *hash[HMCDRV_FUSE_BLKHASH]; /* hash table */
+	struct hmcdrv_fuse_block *head_lru; /* most recently used block */
+	struct hmcdrv_fuse_block *tail_lru; /* least recently used block */
+	unsigned int count; /* number of allocated blocks */
+	unsigned int max; /* max. number of allocated blocks */
+	char seqcmd[HMCDRV_FUSE_MAXCMDLEN]; /* command of last read */
+	off_t seqofs; /* file offset after last read */
+	char racmd[HMCDRV_FUSE_MAXCMDLEN]; /* command for read-ahead */
+	size_t racmdlen; /* length of read-ahead command */
+	time_t ramtime; /* modification time of read-ahead file */
+	off_t rablkno; /* next block to read ahead */
+	unsigned int racount; /* number of blocks left to read ahead */
+	pthread_t tid; /* read-ahead thread ID */
+	int running; /* read-ahead thread was started */
+	int stop; /* read-ahead thread shall exit */
+};
+
+
 /*
  * all file attributes accumulated from interpreting tokens/fields of 'dir'
  * command listing
@@ -195,7 +296,9 @@ static const char *const hmcdrv_fuse_logsevname[] = {
 /*
  * file attributes cache
  */
-static struct hmcdrv_fuse_file *hmcdrv_fuse_cache[HMCDRV_FUSE_CACHE_SIZE];
+static struct hmcdrv_fuse_cache hmcdrv_fuse_cache = {
+	.rwlock = PTHREAD_RWLOCK_INITIALIZER,
+};
 
 
 /*
@@ -205,6 +308,16 @@ static struct hmcdrv_fuse_context hmcdrv_ctx = {
 	.fd = -1,
 	.ctmo = 1 + HMCDRV_FUSE_CACHE_TMOFS,
 	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.devmutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+
+/*
+ * file data cache
+ */
+static struct hmcdrv_fuse_bcache hmcdrv_bcache = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
 };
 
 
@@ -234,25 +347,49 @@ static void hmcdrv_fuse_log(int sev, const char *fmt, ...)
 
 
 /*
- * calculate a hash value from a file path
+ * calculate a hash value from a file path (32 bit FNV-1a)
  */
 static unsigned int hmcdrv_hash_path(const char *path)
 {
-	unsigned int hash = ~0;
-	int len = strlen(path);
+	unsigned int hash = 2166136261U;
 
-	while (len > 0) {
-		hash += (unsigned) *path;
+	while (*path != '\0') {
+		hash ^= (unsigned char) *path;
+		hash *= 16777619U;
 
 		++path;
-		--len;
 	}
 
-	hash %= HMCDRV_FUSE_CACHE_SIZE;
 	return hash;
 }
 
 
+/*
+ * lock the hash table line for file 'path' and return its index
+ *
+ * Note: The caller must hold the hash table rwlock.
+ */
+static unsigned int hmcdrv_cache_lock(const char *path)
+{
+	unsigned int index;
+
+	index = hmcdrv_hash_path(path) & (hmcdrv_fuse_cache.size - 1);
+	pthread_mutex_lock(&hmcdrv_fuse_cache.lock[
+				   index & (HMCDRV_FUSE_CACHE_LOCKS - 1)]);
+	return index;
+}
+
+
+/*
+ * unlock the hash table line at 'index'
+ */
+static void hmcdrv_cache_unlock(unsigned int index)
+{
+	pthread_mutex_unlock(&hmcdrv_fuse_cache.lock[
+				     index & (HMCDRV_FUSE_CACHE_LOCKS - 1)]);
+}
+
+
 /*
  * restart of cache entry aging time
  */
@@ -284,6 +421,50 @@ static void hmcdrv_cache_symlink(struct hmcdrv_fuse_file *fp,
 }
 
 
+/*
+ * double the number of hash table lines of the file attributes cache
+ *
+ * Note: If there is not enough memory then the old hash table is kept.
+ */
+static void hmcdrv_cache_resize(void)
+{
+	struct hmcdrv_fuse_file **hash, *fp, *next;
+	unsigned int i, size, index;
+
+	pthread_rwlock_wrlock(&hmcdrv_fuse_cache.rwlock);
+
+	if (hmcdrv_fuse_cache.count <= 2 * hmcdrv_fuse_cache.size)
+		goto out; /* resized by another thread */
+
+	size = 2 * hmcdrv_fuse_cache.size;
+	hash = calloc(size, sizeof(*hash));
+
+	if (hash == NULL)
+		goto out;
+
+	for (i = 0; i < hmcdrv_fuse_cache.size; ++i) {
+		fp = hmcdrv_fuse_cache.hash[i];
+
+		while (fp != NULL) {
+			next = fp->next;
+			index = hmcdrv_hash_path(HMCDRV_FUSE_PATH(fp)) &
+				(size - 1);
+			fp->next = hash[index];
+			hash[index] = fp;
+			fp = next;
+		}
+	}
+
+	HMCDRV_FUSE_DBGLOG("resizing cache from %u to %u lines (%u entries)",
+			   hmcdrv_fuse_cache.size, size,
+			   hmcdrv_fuse_cache.count);
+	free(hmcdrv_fuse_cache.hash);
+	hmcdrv_fuse_cache.hash = hash;
+	hmcdrv_fuse_cache.size = size;
+out:
+	pthread_rwlock_unlock(&hmcdrv_fuse_cache.rwlock);
+}
+
 
 /*
  * refresh the attributes of file/directory 'path'
@@ -295,6 +476,7 @@ static void hmcdrv_cache_refresh(const char *path, const struct stat *st,
 	struct hmcdrv_fuse_file **pbase; /* storage location of fp */
 	struct hmcdrv_fuse_file *fp;
 	unsigned int index;
+	int resize = 0;
 
 	int pathlen = strlen(path);
 
@@ -304,8 +486,9 @@ static void hmcdrv_cache_refresh(const char *path, const struct stat *st,
 		return;
 	}
 
-	index = hmcdrv_hash_path(path);
-	pbase = &hmcdrv_fuse_cache[index];
+	pthread_rwlock_rdlock(&hmcdrv_fuse_cache.rwlock);
+	index = hmcdrv_cache_lock(path);
+	pbase = &hmcdrv_fuse_cache.hash[index];
 	fp = *pbase;
 
 	while (fp != NULL) {
@@ -313,7 +496,7 @@ static void hmcdrv_cache_refresh(const char *path, const struct stat *st,
 			fp->st = *st;		   /* update file info */
 			hmcdrv_cache_symlink(fp, symlink);
 			hmcdrv_cache_trestart(fp); /* restart aging */
-			return;
+			goto out;
 		}
 
 		pbase = &fp->next;
@@ -330,7 +513,6 @@ static void hmcdrv_cache_refresh(const char *path, const struct stat *st,
 				(offsetof(struct hmcdrv_fuse_file, ftpcmd) +
 				 HMCDRV_FUSE_OFSPATH + 1) + pathlen);
 	} else {
-		*pbase = fp;
 		fp->cmdlen = pathlen + HMCDRV_FUSE_OFSPATH;
 		fp->st = *st;
 		memcpy(HMCDRV_FUSE_PATH(fp), path, pathlen + 1);
@@ -338,40 +520,106 @@ static void hmcdrv_cache_refresh(const char *path, const struct stat *st,
 		hmcdrv_cache_symlink(fp, symlink);
 		hmcdrv_cache_trestart(fp);
 		fp->next = NULL;
+		*pbase = fp;
+
+		/* entries are added with the context mutex held only
+		 */
+		resize = (++hmcdrv_fuse_cache.count >
+			  2 * hmcdrv_fuse_cache.size);
 	}
+
+out:
+	hmcdrv_cache_unlock(index);
+	pthread_rwlock_unlock(&hmcdrv_fuse_cache.rwlock);
+
+	if (resize)
+		hmcdrv_cache_resize();
 }
 
 
 /*
  * search for a file/directory path in cache
+ *
+ * Note: The caller must hold the context mutex, which protects the returned
+ *       entry from being modified or freed.
  */
 static struct hmcdrv_fuse_file *hmcdrv_cache_find(const char *path)
 {
-	unsigned index = hmcdrv_hash_path(path);
-	struct hmcdrv_fuse_file *fp = hmcdrv_fuse_cache[index];
+	struct hmcdrv_fuse_file *fp;
+	unsigned int index;
+
+	pthread_rwlock_rdlock(&hmcdrv_fuse_cache.rwlock);
+	index = hmcdrv_cache_lock(path);
+	fp = hmcdrv_fuse_cache.hash[index];
 
 	while (fp != NULL) {
 		if (strcmp(HMCDRV_FUSE_PATH(fp), path) == 0) {
 			hmcdrv_cache_trestart(fp);
-			return fp;
+			break;
 		}
 
 		fp = fp->next;
 	}
 
-	return NULL;
+	hmcdrv_cache_unlock(index);
+	pthread_rwlock_unlock(&hmcdrv_fuse_cache.rwlock);
+	return fp;
 }
 
 
 /*
- * check for aging timeout of cache entry at index
+ * copy the attributes of a file/directory path from cache into 'st'
+ *
+ * Note: Does not require the context mutex, so that lookups of cached files
+ *       do not wait for directory scans.
+ *
+ * Return: 0 if found in cache, else -ENOENT
  */
-static void hmcdrv_cache_expire(unsigned index, time_t now)
+static int hmcdrv_cache_stat(const char *path, struct stat *st)
+{
+	struct hmcdrv_fuse_file *fp;
+	unsigned int index;
+
+	pthread_rwlock_rdlock(&hmcdrv_fuse_cache.rwlock);
+	index = hmcdrv_cache_lock(path);
+	fp = hmcdrv_fuse_cache.hash[index];
+
+	while (fp != NULL) {
+		if (strcmp(HMCDRV_FUSE_PATH(fp), path) == 0) {
+			hmcdrv_cache_trestart(fp);
+			*st = fp->st;
+			break;
+		}
+
+		fp = fp->next;
+	}
+
+	hmcdrv_cache_unlock(index);
+	pthread_rwlock_unlock(&hmcdrv_fuse_cache.rwlock);
+
+	if (fp == NULL) {
+		__sync_fetch_and_add(&hmcdrv_fuse_cache.misses, 1);
+		return -ENOENT;
+	}
+
+	__sync_fetch_and_add(&hmcdrv_fuse_cache.hits, 1);
+	return 0;
+}
+
+
+/*
+ * check for aging timeout of cache entries at index
+ *
+ * Note: The caller must hold the context mutex and the hash table rwlock.
+ */
+static void hmcdrv_cache_expire(unsigned int index, time_t now)
 {
 	struct hmcdrv_fuse_file **pbase; /* storage location of fp */
 	struct hmcdrv_fuse_file *fp, *next;
 
-	pbase = &hmcdrv_fuse_cache[index];
+	pthread_mutex_lock(&hmcdrv_fuse_cache.lock[
+				   index & (HMCDRV_FUSE_CACHE_LOCKS - 1)]);
+	pbase = &hmcdrv_fuse_cache.hash[index];
 	fp = *pbase;
 
 	/* iterate the collision list */
@@ -383,12 +631,16 @@ static void hmcdrv_cache_expire(unsigned index, time_t now)
 			hmcdrv_cache_symlink(fp, NULL);
 			*pbase = next;
 			free(fp);
+			--hmcdrv_fuse_cache.count;
+			++hmcdrv_fuse_cache.expired;
 		} else {
 			pbase = &fp->next;
 		}
 
 		fp = next;
 	}
+
+	hmcdrv_cache_unlock(index);
 }
 
 
@@ -397,27 +649,30 @@ static void hmcdrv_cache_expire(unsigned index, time_t now)
  */
 static void *hmcdrv_cache_aging(void *UNUSED(arg))
 {
-	unsigned int cnt;
+	unsigned int cnt, max;
 	time_t now;
 
-	unsigned index = 0;
-
 	while (1) {
 		sleep(1);
 
 		pthread_mutex_lock(&hmcdrv_ctx.mutex);
+		pthread_rwlock_rdlock(&hmcdrv_fuse_cache.rwlock);
 		now = time(NULL);
 
-		/* each second scan a number of cache entries
+		/* each second scan so many hash table lines that the whole
+		 * table is inspected within the cache timeout
 		 */
-		for (cnt = 0; cnt < HMCDRV_FUSE_GARBAGE_MAX; ++cnt) {
-
-			hmcdrv_cache_expire(index, now);
-
-			if (++index == HMCDRV_FUSE_CACHE_SIZE)
-				index = 0;
+		max = hmcdrv_fuse_cache.size / (unsigned int) hmcdrv_ctx.ctmo;
+		max = MIN(MAX(max, HMCDRV_FUSE_GARBAGE_MAX),
+			  hmcdrv_fuse_cache.size);
+
+		for (cnt = 0; cnt < max; ++cnt) {
+			hmcdrv_fuse_cache.index &= hmcdrv_fuse_cache.size - 1;
+			hmcdrv_cache_expire(hmcdrv_fuse_cache.index, now);
+			++hmcdrv_fuse_cache.index;
 		}
 
+		pthread_rwlock_unlock(&hmcdrv_fuse_cache.rwlock);
 		pthread_mutex_unlock(&hmcdrv_ctx.mutex);
 	}
 
@@ -425,6 +680,60 @@ static void *hmcdrv_cache_aging(void *UNUSED(arg))
 }
 
 
+/*
+ * allocate the file attributes cache
+ *
+ * Return: 0 on success, else -1 (errno set)
+ */
+static int hmcdrv_cache_init(void)
+{
+	int i;
+
+	for (i = 0; i < HMCDRV_FUSE_CACHE_LOCKS; ++i)
+		pthread_mutex_init(&hmcdrv_fuse_cache.lock[i], NULL);
+
+	hmcdrv_fuse_cache.size = HMCDRV_FUSE_CACHE_SIZE;
+	hmcdrv_fuse_cache.hash = calloc(hmcdrv_fuse_cache.size,
+					sizeof(*hmcdrv_fuse_cache.hash));
+
+	if (hmcdrv_fuse_cache.hash == NULL)
+		return -1;
+
+	return 0;
+}
+
+
+/*
+ * free all entries of the file attributes cache
+ */
+static void hmcdrv_cache_exit(void)
+{
+	struct hmcdrv_fuse_file *fp, *next;
+	unsigned int i;
+
+	if (hmcdrv_fuse_cache.hash == NULL)
+		return;
+
+	for (i = 0; i < hmcdrv_fuse_cache.size; ++i) {
+		fp = hmcdrv_fuse_cache.hash[i];
+
+		while (fp != NULL) {
+			next = fp->next;
+			hmcdrv_cache_symlink(fp, NULL);
+			free(fp);
+			fp = next;
+		}
+	}
+
+	free(hmcdrv_fuse_cache.hash);
+	hmcdrv_fuse_cache.hash = NULL;
+	hmcdrv_fuse_cache.count = 0;
+
+	for (i = 0; i < HMCDRV_FUSE_CACHE_LOCKS; ++i)
+		pthread_mutex_destroy(&hmcdrv_fuse_cache.lock[i]);
+}
+
+
 /*
  * convert a FTP command ID into a string
  *
@@ -451,26 +760,29 @@ static void hmcdrv_ftp_str(enum hmcdrv_fuse_cmdid cmd, char *ftp)
 /*
  * FTP command execution via kernel device
  */
-static ssize_t hmcdrv_ftp_transfer(struct hmcdrv_fuse_file *fp, char *buf,
-				   size_t len, off_t offset)
+static ssize_t hmcdrv_ftp_transfer(const char *ftpcmd, size_t cmdlen,
+				   char *buf, size_t len, off_t offset)
 {
 	static off_t current_offset;
 	static char last_ftpcmd[HMCDRV_FUSE_MAXCMDLEN];
 
 	ssize_t retlen;
 
+	pthread_mutex_lock(&hmcdrv_ctx.devmutex);
+
 	/*
 	 * First check if this is a sequential read from the same file.	 If
 	 * so skip repositioning the files seek pointer and emitting a new
 	 * command.
 	 */
 	if ((offset != current_offset) ||
-	    (strncmp(fp->ftpcmd, last_ftpcmd, HMCDRV_FUSE_MAXCMDLEN) != 0)) {
+	    (strncmp(ftpcmd, last_ftpcmd, HMCDRV_FUSE_MAXCMDLEN) != 0)) {
 
 		if ((lseek(hmcdrv_ctx.fd, offset, SEEK_END) < 0) ||
-		    (write(hmcdrv_ctx.fd, fp->ftpcmd, fp->cmdlen) < 0)) {
+		    (write(hmcdrv_ctx.fd, ftpcmd, cmdlen) < 0)) {
 			last_ftpcmd[0] = '\0';
-			return -errno;
+			retlen = -errno;
+			goto out;
 		}
 
 		current_offset = offset;
@@ -480,11 +792,14 @@ static ssize_t hmcdrv_ftp_transfer(struct hmcdrv_fuse_file *fp, char *buf,
 
 	if (retlen < 0) {
 		last_ftpcmd[0] = '\0';
-		return -errno;
+		retlen = -errno;
+		goto out;
 	}
 
 	current_offset += retlen;
-	util_strlcpy(last_ftpcmd, fp->ftpcmd, HMCDRV_FUSE_MAXCMDLEN);
+	util_strlcpy(last_ftpcmd, ftpcmd, HMCDRV_FUSE_MAXCMDLEN);
+out:
+	pthread_mutex_unlock(&hmcdrv_ctx.devmutex);
 	return retlen;
 }
 
@@ -500,7 +815,404 @@ static ssize_t hmcdrv_ftp_cmd(struct hmcdrv_fuse_file *fp,
 		return -EBADF;
 
 	hmcdrv_ftp_str(cmd, fp->ftpcmd);
-	return hmcdrv_ftp_transfer(fp, buf, len, offset);
+	return hmcdrv_ftp_transfer(fp->ftpcmd, fp->cmdlen, buf, len, offset);
+}
+
+
+/*
+ * calculate a hash value for a block of file data cache
+ */
+static unsigned int hmcdrv_hash_block(const char *ftpcmd, off_t blkno)
+{
+	unsigned int hash = (unsigned int) blkno;
+
+	while (*ftpcmd != '\0') {
+		hash = hash * 31 + (unsigned char) *ftpcmd;
+		++ftpcmd;
+	}
+
+	return hash % HMCDRV_FUSE_BLKHASH;
+}
+
+
+/*
+ * remove a block from the LRU list of file data cache
+ */
+static void hmcdrv_block_lru_del(struct hmcdrv_fuse_block *blk)
+{
+	if (blk->prev_lru != NULL)
+		blk->prev_lru->next_lru = blk->next_lru;
+	else
+		hmcdrv_bcache.head_lru = blk->next_lru;
+
+	if (blk->next_lru != NULL)
+		blk->next_lru->prev_lru = blk->prev_lru;
+	else
+		hmcdrv_bcache.tail_lru = blk->prev_lru;
+}
+
+
+/*
+ * add a block as most recently used to the LRU list of file data cache
+ */
+static void hmcdrv_block_lru_add(struct hmcdrv_fuse_block *blk)
+{
+	blk->prev_lru = NULL;
+	blk->next_lru = hmcdrv_bcache.head_lru;
+
+	if (hmcdrv_bcache.head_lru != NULL)
+		hmcdrv_bcache.head_lru->prev_lru = blk;
+	else
+		hmcdrv_bcache.tail_lru = blk;
+
+	hmcdrv_bcache.head_lru = blk;
+}
+
+
+/*
+ * remove a block from the hash table of file data cache and mark it free
+ */
+static void hmcdrv_block_unhash(struct hmcdrv_fuse_block *blk)
+{
+	struct hmcdrv_fuse_block **pp;
+
+	pp = &hmcdrv_bcache.hash[hmcdrv_hash_block(blk->ftpcmd, blk->blkno)];
+
+	while (*pp != NULL) {
+		if (*pp == blk) {
+			*pp = blk->next;
+			break;
+		}
+
+		pp = &(*pp)->next;
+	}
+
+	blk->state = HMCDRV_FUSE_BLK_FREE;
+}
+
+
+/*
+ * lookup a block in file data cache
+ *
+ * Note: must be called with hmcdrv_bcache.mutex held
+ */
+static struct hmcdrv_fuse_block *hmcdrv_block_find(const char *ftpcmd,
+						   time_t mtime, off_t blkno)
+{
+	struct hmcdrv_fuse_block *blk;
+
+	blk = hmcdrv_bcache.hash[hmcdrv_hash_block(ftpcmd, blkno)];
+
+	while (blk != NULL) {
+		if ((blk->blkno == blkno) && (blk->mtime == mtime) &&
+		    (strcmp(blk->ftpcmd, ftpcmd) == 0))
+			return blk;
+
+		blk = blk->next;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * allocate a block in file data cache, evicting the least recently used
+ * block if the cache is full
+ *
+ * Note: must be called with hmcdrv_bcache.mutex held
+ *
+ * Return: pointer to block in state HMCDRV_FUSE_BLK_PENDING or NULL if all
+ *         blocks are pending
+ */
+static struct hmcdrv_fuse_block *hmcdrv_block_alloc(const char *ftpcmd,
+						    time_t mtime, off_t blkno)
+{
+	struct hmcdrv_fuse_block *blk = NULL;
+	unsigned int hash;
+
+	if (hmcdrv_bcache.count < hmcdrv_bcache.max) {
+		blk = malloc(sizeof(*blk) + HMCDRV_FUSE_BLKSIZE);
+
+		if (blk != NULL) {
+			++hmcdrv_bcache.count;
+			hmcdrv_block_lru_add(blk);
+		}
+	}
+
+	if (blk == NULL) {
+		blk = hmcdrv_bcache.tail_lru;
+
+		while ((blk != NULL) && (blk->state == HMCDRV_FUSE_BLK_PENDING))
+			blk = blk->prev_lru;
+
+		if (blk == NULL)
+			return NULL;
+
+		if (blk->state == HMCDRV_FUSE_BLK_VALID)
+			hmcdrv_block_unhash(blk);
+	}
+
+	util_strlcpy(blk->ftpcmd, ftpcmd, HMCDRV_FUSE_MAXCMDLEN);
+	blk->mtime = mtime;
+	blk->blkno = blkno;
+	blk->len = 0;
+	blk->state = HMCDRV_FUSE_BLK_PENDING;
+
+	hash = hmcdrv_hash_block(ftpcmd, blkno);
+	blk->next = hmcdrv_bcache.hash[hash];
+	hmcdrv_bcache.hash[hash] = blk;
+
+	hmcdrv_block_lru_del(blk);
+	hmcdrv_block_lru_add(blk);
+	return blk;
+}
+
+
+/*
+ * transfer a pending block of file data from HMC drive
+ *
+ * Note: must be called with hmcdrv_bcache.mutex held, which is released
+ *       while the transfer is in progress
+ *
+ * Return: 0 on success, a negative errno value on error
+ */
+static int hmcdrv_block_fill(struct hmcdrv_fuse_block *blk, size_t cmdlen)
+{
+	ssize_t len;
+	size_t total = 0;
+	off_t offset = blk->blkno * HMCDRV_FUSE_BLKSIZE;
+
+	pthread_mutex_unlock(&hmcdrv_bcache.mutex);
+
+	do {
+		len = hmcdrv_ftp_transfer(blk->ftpcmd, cmdlen,
+					  blk->data + total,
+					  HMCDRV_FUSE_BLKSIZE - total,
+					  offset + total);
+		if (len > 0)
+			total += len;
+	} while ((len > 0) && (total < HMCDRV_FUSE_BLKSIZE));
+
+	pthread_mutex_lock(&hmcdrv_bcache.mutex);
+
+	if (len < 0) {
+		hmcdrv_block_unhash(blk);
+		hmcdrv_block_lru_del(blk); /* reuse first */
+		blk->next_lru = NULL;
+		blk->prev_lru = hmcdrv_bcache.tail_lru;
+
+		if (hmcdrv_bcache.tail_lru != NULL)
+			hmcdrv_bcache.tail_lru->next_lru = blk;
+		else
+			hmcdrv_bcache.head_lru = blk;
+
+		hmcdrv_bcache.tail_lru = blk;
+	} else {
+		blk->len = total;
+		blk->state = HMCDRV_FUSE_BLK_VALID;
+	}
+
+	pthread_cond_broadcast(&hmcdrv_bcache.cond);
+	return (len < 0) ? len : 0;
+}
+
+
+/*
+ * get a valid block from file data cache, transfer it from HMC drive if
+ * it is not cached
+ *
+ * Note: must be called with hmcdrv_bcache.mutex held
+ *
+ * Return: 0 on success, a negative errno value on error
+ */
+static int hmcdrv_block_get(const char *ftpcmd, size_t cmdlen, time_t mtime,
+			    off_t blkno, struct hmcdrv_fuse_block **pblk)
+{
+	struct hmcdrv_fuse_block *blk;
+	int rc;
+
+	for (;;) {
+		blk = hmcdrv_block_find(ftpcmd, mtime, blkno);
+
+		if (blk == NULL) {
+			blk = hmcdrv_block_alloc(ftpcmd, mtime, blkno);
+
+			if (blk == NULL) { /* all blocks pending */
+				pthread_cond_wait(&hmcdrv_bcache.cond,
+						  &hmcdrv_bcache.mutex);
+				continue;
+			}
+
+			rc = hmcdrv_block_fill(blk, cmdlen);
+
+			if (rc < 0)
+				return rc;
+		} else if (blk->state == HMCDRV_FUSE_BLK_PENDING) {
+			pthread_cond_wait(&hmcdrv_bcache.cond,
+					  &hmcdrv_bcache.mutex);
+			continue;
+		} else {
+			hmcdrv_block_lru_del(blk);
+			hmcdrv_block_lru_add(blk);
+		}
+
+		*pblk = blk;
+		return 0;
+	}
+}
+
+
+/*
+ * read-ahead thread: transfers the blocks requested by sequential reads
+ * into file data cache
+ */
+static void *hmcdrv_block_readahead(void *UNUSED(arg))
+{
+	struct hmcdrv_fuse_block *blk;
+	off_t blkno;
+
+	pthread_mutex_lock(&hmcdrv_bcache.mutex);
+
+	while (!hmcdrv_bcache.stop) {
+		if (hmcdrv_bcache.racount == 0) {
+			pthread_cond_wait(&hmcdrv_bcache.cond,
+					  &hmcdrv_bcache.mutex);
+			continue;
+		}
+
+		blkno = hmcdrv_bcache.rablkno++;
+		--hmcdrv_bcache.racount;
+
+		if (hmcdrv_block_find(hmcdrv_bcache.racmd,
+				      hmcdrv_bcache.ramtime, blkno) != NULL)
+			continue;
+
+		blk = hmcdrv_block_alloc(hmcdrv_bcache.racmd,
+					 hmcdrv_bcache.ramtime, blkno);
+
+		if (blk == NULL) { /* cache is busy, drop read-ahead */
+			hmcdrv_bcache.racount = 0;
+			continue;
+		}
+
+		if ((hmcdrv_block_fill(blk, hmcdrv_bcache.racmdlen) < 0) ||
+		    (blk->len < HMCDRV_FUSE_BLKSIZE)) /* end of file */
+			hmcdrv_bcache.racount = 0;
+	}
+
+	pthread_mutex_unlock(&hmcdrv_bcache.mutex);
+	return NULL;
+}
+
+
+/*
+ * read from a file via file data cache and request read-ahead on
+ * sequential reads
+ *
+ * Return: number of bytes read or a negative errno value on error
+ */
+static int hmcdrv_block_read(const char *ftpcmd, size_t cmdlen, time_t mtime,
+			     char *buf, size_t size, off_t offset)
+{
+	struct hmcdrv_fuse_block *blk;
+	size_t copied = 0, blkofs, len;
+	off_t blkno = 0;
+	int rc = 0;
+
+	pthread_mutex_lock(&hmcdrv_bcache.mutex);
+
+	while (size > 0) {
+		blkno = (offset + copied) / HMCDRV_FUSE_BLKSIZE;
+		rc = hmcdrv_block_get(ftpcmd, cmdlen, mtime, blkno, &blk);
+
+		if (rc < 0)
+			break;
+
+		blkofs = (offset + copied) % HMCDRV_FUSE_BLKSIZE;
+
+		if (blkofs >= blk->len) /* end of file */
+			break;
+
+		len = MIN(size, blk->len - blkofs);
+		memcpy(buf + copied, blk->data + blkofs, len);
+		copied += len;
+		size -= len;
+
+		if (blk->len < HMCDRV_FUSE_BLKSIZE) /* last block of file */
+			break;
+	}
+
+	/* request read-ahead if the previous read ended at this offset */
+	if ((rc == 0) && (hmcdrv_bcache.seqofs == offset) &&
+	    (strcmp(hmcdrv_bcache.seqcmd, ftpcmd) == 0) &&
+	    (hmcdrv_ctx.opt.readahead > 0)) {
+		util_strlcpy(hmcdrv_bcache.racmd, ftpcmd,
+			     HMCDRV_FUSE_MAXCMDLEN);
+		hmcdrv_bcache.racmdlen = cmdlen;
+		hmcdrv_bcache.ramtime = mtime;
+		hmcdrv_bcache.rablkno = blkno + 1;
+		hmcdrv_bcache.racount = hmcdrv_ctx.opt.readahead;
+		pthread_cond_broadcast(&hmcdrv_bcache.cond);
+	}
+
+	util_strlcpy(hmcdrv_bcache.seqcmd, ftpcmd, HMCDRV_FUSE_MAXCMDLEN);
+	hmcdrv_bcache.seqofs = offset + copied;
+
+	pthread_mutex_unlock(&hmcdrv_bcache.mutex);
+	return (copied > 0) ? (int) copied : rc;
+}
+
+
+/*
+ * start file data cache and read-ahead thread
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int hmcdrv_bcache_init(void)
+{
+	hmcdrv_bcache.max = hmcdrv_ctx.opt.cachesize *
+		(1024U * 1024U / HMCDRV_FUSE_BLKSIZE);
+
+	/* do not let read-ahead evict the block that has been requested */
+	hmcdrv_ctx.opt.readahead = MIN(hmcdrv_ctx.opt.readahead,
+				       hmcdrv_bcache.max / 2);
+
+	if ((hmcdrv_bcache.max == 0) || (hmcdrv_ctx.opt.readahead == 0))
+		return 0;
+
+	if (pthread_create(&hmcdrv_bcache.tid, NULL,
+			   hmcdrv_block_readahead, NULL) != 0)
+		return -1;
+
+	hmcdrv_bcache.running = 1;
+	return 0;
+}
+
+
+/*
+ * stop read-ahead thread and release file data cache
+ */
+static void hmcdrv_bcache_exit(void)
+{
+	struct hmcdrv_fuse_block *blk, *next;
+
+	if (hmcdrv_bcache.running) {
+		pthread_mutex_lock(&hmcdrv_bcache.mutex);
+		hmcdrv_bcache.stop = 1;
+		pthread_cond_broadcast(&hmcdrv_bcache.cond);
+		pthread_mutex_unlock(&hmcdrv_bcache.mutex);
+		pthread_join(hmcdrv_bcache.tid, NULL);
+		hmcdrv_bcache.running = 0;
+	}
+
+	for (blk = hmcdrv_bcache.head_lru; blk != NULL; blk = next) {
+		next = blk->next_lru;
+		free(blk);
+	}
+
+	memset(hmcdrv_bcache.hash, 0, sizeof(hmcdrv_bcache.hash));
+	hmcdrv_bcache.head_lru = hmcdrv_bcache.tail_lru = NULL;
+	hmcdrv_bcache.count = 0;
 }
 
 
@@ -1114,6 +1826,9 @@ static int hmcdrv_fuse_getattr(const char *path, struct stat *stbuf)
 	struct hmcdrv_fuse_file *fp;
 	int rc = 0;
 
+	if (hmcdrv_cache_stat(path, stbuf) == 0)
+		return 0;
+
 	pthread_mutex_lock(&hmcdrv_ctx.mutex);
 	fp = hmcdrv_file_get(path);
 
@@ -1207,20 +1922,94 @@ static int hmcdrv_fuse_open(const char *UNUSED(path), struct fuse_file_info *fi)
 static int hmcdrv_fuse_read(const char *path, char *buf, size_t size,
 			    off_t offset, struct fuse_file_info *UNUSED(fi))
 {
+	char ftpcmd[HMCDRV_FUSE_MAXCMDLEN];
 	struct hmcdrv_fuse_file *fp;
+	size_t cmdlen;
+	time_t mtime;
 	int rc;
 
 	pthread_mutex_lock(&hmcdrv_ctx.mutex);
 	fp = hmcdrv_file_get(path);
 
-	if (fp == NULL)
-		rc = -ENOENT;
-	else
+	if (fp == NULL) {
+		pthread_mutex_unlock(&hmcdrv_ctx.mutex);
+		return -ENOENT;
+	}
+
+	if (hmcdrv_bcache.max == 0) { /* no file data cache */
 		rc = hmcdrv_ftp_cmd(fp, HMCDRV_FUSE_CMDID_GET,
 				    buf, size, offset);
+		pthread_mutex_unlock(&hmcdrv_ctx.mutex);
+		return rc;
+	}
 
+	hmcdrv_ftp_str(HMCDRV_FUSE_CMDID_GET, fp->ftpcmd);
+	util_strlcpy(ftpcmd, fp->ftpcmd, HMCDRV_FUSE_MAXCMDLEN);
+	cmdlen = fp->cmdlen;
+	mtime = fp->st.st_mtime;
 	pthread_mutex_unlock(&hmcdrv_ctx.mutex);
-	return rc;
+
+	return hmcdrv_block_read(ftpcmd, cmdlen, mtime, buf, size, offset);
+}
+
+
+/*
+ * copy a string value of an extended attribute into 'buf'
+ */
+static int hmcdrv_fuse_xattr_value(const char *value, size_t len,
+				   char *buf, size_t size)
+{
+	if (size == 0) /* caller asks for the size only */
+		return len;
+
+	if (size < len)
+		return -ERANGE;
+
+	memcpy(buf, value, len);
+	return len;
+}
+
+
+/*
+ * get an extended attribute
+ *
+ * Note: Only the mount point has extended attribute HMCDRV_FUSE_XATTR_STATS,
+ *       which reports the file name/attributes cache statistics.
+ */
+static int hmcdrv_fuse_getxattr(const char *path, const char *name,
+				char *value, size_t size)
+{
+	char stats[256];
+	int len;
+
+	if ((strcmp(path, "/") != 0) ||
+	    (strcmp(name, HMCDRV_FUSE_XATTR_STATS) != 0))
+		return -ENODATA;
+
+	pthread_rwlock_rdlock(&hmcdrv_fuse_cache.rwlock);
+	len = snprintf(stats, sizeof(stats),
+		       "entries %u\nlines %u\nhits %lu\nmisses %lu\n"
+		       "expired %lu\n",
+		       hmcdrv_fuse_cache.count, hmcdrv_fuse_cache.size,
+		       hmcdrv_fuse_cache.hits, hmcdrv_fuse_cache.misses,
+		       hmcdrv_fuse_cache.expired);
+	pthread_rwlock_unlock(&hmcdrv_fuse_cache.rwlock);
+
+	return hmcdrv_fuse_xattr_value(stats, len, value, size);
+}
+
+
+/*
+ * list extended attributes
+ */
+static int hmcdrv_fuse_listxattr(const char *path, char *list, size_t size)
+{
+	if (strcmp(path, "/") != 0)
+		return 0;
+
+	return hmcdrv_fuse_xattr_value(HMCDRV_FUSE_XATTR_STATS,
+				       sizeof(HMCDRV_FUSE_XATTR_STATS),
+				       list, size);
 }
 
 
@@ -1236,7 +2025,6 @@ static void *hmcdrv_fuse_init(struct fuse_conn_info *UNUSED(conn))
 {
 	pthread_mutexattr_t attr;
 
-	memset(hmcdrv_fuse_cache, 0, sizeof(hmcdrv_fuse_cache));
 	openlog(HMCDRV_FUSE_LOGNAME, LOG_PID, LOG_DAEMON);
 
 	if (pthread_mutexattr_init(&attr) != 0)
@@ -1251,8 +2039,14 @@ static void *hmcdrv_fuse_init(struct fuse_conn_info *UNUSED(conn))
 	if (pthread_mutex_init(&hmcdrv_ctx.mutex, &attr) != 0)
 		goto err_mutex;
 
+	if (hmcdrv_cache_init() != 0)
+		goto err_cache;
+
 	hmcdrv_cache_refresh("/", &hmcdrv_ctx.st, NULL); /* never expires */
 
+	if (hmcdrv_bcache_init() != 0)
+		goto err_cache;
+
 	if (pthread_create(&hmcdrv_ctx.tid, NULL,
 			   hmcdrv_cache_aging, NULL) == 0) {
 
@@ -1260,6 +2054,9 @@ static void *hmcdrv_fuse_init(struct fuse_conn_info *UNUSED(conn))
 		return &hmcdrv_ctx.tid;
 	}
 
+	hmcdrv_bcache_exit();
+err_cache:
+	hmcdrv_cache_exit();
 err_mutex:
 	close(hmcdrv_ctx.fd);
 err_dev:
@@ -1278,26 +2075,12 @@ err_out:
  */
 static void hmcdrv_fuse_exit(void *arg)
 {
-	struct hmcdrv_fuse_file *fp, *next;
-	int i;
-
 	if (arg != NULL)
 		pthread_cancel(*(pthread_t *) arg);
 
+	hmcdrv_bcache_exit();
 	pthread_mutex_lock(&hmcdrv_ctx.mutex);
-
-	for (i = 0; i < HMCDRV_FUSE_CACHE_SIZE; ++i) {
-		fp = hmcdrv_fuse_cache[i];
-
-		while (fp != NULL) {
-			next = fp->next;
-			hmcdrv_cache_symlink(fp, NULL);
-			free(fp);
-			fp = next;
-		}
-	}
-
-	memset(hmcdrv_fuse_cache, 0, sizeof(hmcdrv_fuse_cache));
+	hmcdrv_cache_exit();
 	pthread_mutex_destroy(&hmcdrv_ctx.mutex);
 	closelog();
 
@@ -1319,7 +2102,9 @@ static int hmcdrv_fuse_main(struct fuse_args *args)
 		.readdir = hmcdrv_fuse_readdir,
 		.open = hmcdrv_fuse_open,
 		.read = hmcdrv_fuse_read,
-		.readlink = hmcdrv_fuse_readlink
+		.readlink = hmcdrv_fuse_readlink,
+		.getxattr = hmcdrv_fuse_getxattr,
+		.listxattr = hmcdrv_fuse_listxattr
 	};
 
 
@@ -1348,6 +2133,9 @@ static void hmcdrv_fuse_usage(const char *progname)
 		"Specific options:\n"
 		"    -o hmclang=LANG        HMC speaks language LANG (see locale(1))\n"
 		"    -o hmctz=TZ            HMC is in timezone TZ (see tzset(3))\n"
+		"    -o cachesize=MB        Cache MB MiB of file data (default %u)\n"
+		"    -o readahead=N         Read N MiB ahead on sequential reads\n"
+		"                           (default %u)\n"
 		"\n"
 		"Attention:\n"
 		"    The following general and FUSE specific mount options will\n"
@@ -1356,7 +2144,8 @@ static void hmcdrv_fuse_usage(const char *progname)
 		"    -o atomic_o_trunc, -o hard_remove, -o negative_timeout=T,\n"
 		"    -o use_ino, -o readdir_ino, -o subdir=DIR\n"
 		"\n",
-		progname, progname);
+		progname, progname, HMCDRV_FUSE_CACHEMB,
+		HMCDRV_FUSE_READAHEAD);
 }
 
 
@@ -1513,6 +2302,8 @@ int main(int argc, char *argv[])
 
 		HMCDRV_FUSE_OPT("hmctz=%s", hmctz, 0),
 		HMCDRV_FUSE_OPT("hmclang=%s", hmclang, 0),
+		HMCDRV_FUSE_OPT("cachesize=%u", cachesize, 0),
+		HMCDRV_FUSE_OPT("readahead=%u", readahead, 0),
 
 		FUSE_OPT_KEY("ro", HMCDRV_FUSE_OPTKEY_RO),
 		FUSE_OPT_KEY("-r", HMCDRV_FUSE_OPTKEY_RO),
@@ -1551,6 +2342,8 @@ int main(int argc, char *argv[])
 	struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
 
 	memset(&hmcdrv_ctx.opt, 0, sizeof(hmcdrv_ctx.opt));
+	hmcdrv_ctx.opt.cachesize = HMCDRV_FUSE_CACHEMB;
+	hmcdrv_ctx.opt.readahead = HMCDRV_FUSE_READAHEAD;
 	hmcdrv_ctx.pid = getpid();
 
 	fuse_opt_parse(&args, &hmcdrv_ctx.opt, lookup_opt,
@@ -9,13 +9,16 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <endian.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "dg_debugfs.h"
+#include "dg_record.h"
 #include "helper.h"
 #include "hyptop.h"
 
@@ -50,13 +53,21 @@ int dg_debugfs_init(int exit_on_err)
 {
 	int rc;
 
-	l_debugfs_dir = ht_mount_point_get("debugfs");
-	if (!l_debugfs_dir) {
-		if (!exit_on_err)
-			return -ENODEV;
-		ERR_EXIT("Debugfs is not mounted, try \"mount none -t debugfs "
-				 "/sys/kernel/debug\"\n");
+	if (g.o.replay_file) {
+		dg_replay_open(g.o.replay_file);
+	} else {
+		l_debugfs_dir = ht_mount_point_get("debugfs");
+		if (!l_debugfs_dir) {
+			if (!exit_on_err)
+				return -ENODEV;
+			ERR_EXIT("Debugfs is not mounted, try \"mount none -t "
+				 "debugfs /sys/kernel/debug\"\n");
+		}
 	}
+	if (dg_replay_active() && !dg_replay_has_file(DG_DEBUGFS_FILE_204) &&
+	    !dg_replay_has_file(DG_DEBUGFS_FILE_2FC))
+		ERR_EXIT("Recording \"%s\" contains no hypervisor data\n",
+			 g.o.replay_file);
 	rc = dg_debugfs_vm_init();
 	if (rc == 0)
 		return 0;
@@ -91,3 +102,86 @@ int dg_debugfs_open(const char *file)
 	else
 		return fh;
 }
+
+/*
+ * Check if a debugfs file can be opened
+ */
+int dg_debugfs_check(const char *file)
+{
+	int fh;
+
+	if (dg_replay_active())
+		return dg_replay_has_file(file) ? 0 : -ENOENT;
+	fh = dg_debugfs_open(file);
+	if (fh < 0)
+		return fh;
+	close(fh);
+	return 0;
+}
+
+/*
+ * Read a debugfs file that starts with a header of size "hdr_size"
+ *
+ * All hypfs debugfs files start with the length of the data following
+ * the header. The buffer size "buf_size" is increased until the complete
+ * file fits into the buffer. The returned buffer must be freed with
+ * ht_free().
+ *
+ * On replay the recorded big-endian file content is converted to host
+ * byte order with "to_host_fn", which fails if the content does not fit
+ * into the recorded length.
+ */
+void *dg_debugfs_read(const char *file, long *buf_size, size_t hdr_size,
+		      int (*to_host_fn)(void *buf, size_t len))
+{
+	long real_buf_size;
+	size_t len;
+	ssize_t rc;
+	void *buf;
+	int fh;
+
+	if (dg_replay_active()) {
+		buf = dg_replay_read(file, &len);
+		if (len < hdr_size || len != be64toh(*(u64 *) buf) + hdr_size ||
+		    to_host_fn(buf, len))
+			ERR_EXIT("Recording \"%s\" is invalid\n",
+				 g.o.replay_file);
+		goto out;
+	}
+	do {
+		fh = dg_debugfs_open(file);
+		if (fh < 0)
+			ERR_EXIT_ERRNO("Could not open file: %s", file);
+		buf = ht_alloc(*buf_size);
+		rc = read(fh, buf, *buf_size);
+		if (rc == -1)
+			ERR_EXIT_ERRNO("Reading hypervisor data failed");
+		close(fh);
+		real_buf_size = *(u64 *) buf + hdr_size;
+		if (rc == real_buf_size)
+			break;
+		*buf_size = real_buf_size;
+		ht_free(buf);
+	} while (1);
+	len = rc;
+out:
+	if (dg_record_active())
+		dg_record_write(file, buf, len);
+	return buf;
+}
+
+/*
+ * Convert recorded extended TOD clock value to host byte order
+ *
+ * The value is converted as two u64 values like ht_ext_tod_2_us()
+ * reads it.
+ */
+void dg_debugfs_tod_ext_to_host(char *tod_ext)
+{
+	u64 tod[2];
+
+	memcpy(tod, tod_ext, sizeof(tod));
+	tod[0] = be64toh(tod[0]);
+	tod[1] = be64toh(tod[1]);
+	memcpy(tod_ext, tod, sizeof(tod));
+}
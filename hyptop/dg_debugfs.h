@@ -16,10 +16,19 @@
 
 #define DBFS_WAIT_TIME_US 10000
 
+#define DG_DEBUGFS_FILE_204	"diag_204"
+#define DG_DEBUGFS_FILE_2FC	"diag_2fc"
+#define DG_DEBUGFS_FILE_0C	"diag_0c"
+
 extern int dg_debugfs_init(int exit_on_err);
 extern int dg_debugfs_vm_init(void);
 extern int dg_debugfs_lpar_init(void);
 extern int dg_debugfs_open(const char *file);
+extern int dg_debugfs_check(const char *file);
+extern void *dg_debugfs_read(const char *file, long *buf_size,
+			     size_t hdr_size,
+			     int (*to_host_fn)(void *buf, size_t len));
+extern void dg_debugfs_tod_ext_to_host(char *tod_ext);
 
 /*
  * z/VM diag 0C prototypes
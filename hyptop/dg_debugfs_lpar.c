@@ -9,12 +9,14 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <endian.h>
 #include <errno.h>
 #include <iconv.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "dg_debugfs.h"
+#include "dg_record.h"
 #include "helper.h"
 #include "hyptop.h"
 #include "sd.h"
@@ -24,7 +26,7 @@
 #define TMP_SIZE	64
 #define LPAR_PHYS_FLG	0x80
 #define CPU_TYPE_LEN	16
-#define DEBUGFS_FILE	"diag_204"
+#define DEBUGFS_FILE	DG_DEBUGFS_FILE_204
 
 static u64 l_update_time_us;
 static long l_204_buf_size;
@@ -208,31 +210,69 @@ struct l_debugfs_d204 {
 	char				buf[];
 } __attribute__ ((packed));
 
+/*
+ * Convert recorded debugfs file to host byte order
+ */
+static int l_d204_to_host(void *buf, size_t len)
+{
+	struct l_debugfs_d204_hdr *hdr = buf;
+	struct l_x_info_blk_hdr *time_hdr;
+	struct l_x_cpu_info *cpu_info;
+	struct l_x_phys_cpu *phys_cpu;
+	struct l_x_phys_hdr *phys_hdr;
+	struct l_x_sys_hdr *sys_hdr;
+	void *end = buf + len;
+	int i, j;
+
+	hdr->len = be64toh(hdr->len);
+	hdr->version = be16toh(hdr->version);
+	time_hdr = (void *) (hdr + 1);
+	if ((void *) (time_hdr + 1) > end)
+		return -1;
+	time_hdr->curtod1 = be64toh(time_hdr->curtod1);
+	time_hdr->curtod2 = be64toh(time_hdr->curtod2);
+	sys_hdr = (void *) (time_hdr + 1);
+	for (i = 0; i < time_hdr->npar; i++) {
+		cpu_info = (void *) (sys_hdr + 1);
+		if ((void *) cpu_info > end ||
+		    (void *) (cpu_info + sys_hdr->rcpus) > end)
+			return -1;
+		for (j = 0; j < sys_hdr->rcpus; j++) {
+			cpu_info->cpu_addr = be16toh(cpu_info->cpu_addr);
+			cpu_info->acc_time = be64toh(cpu_info->acc_time);
+			cpu_info->lp_time = be64toh(cpu_info->lp_time);
+			cpu_info->online_time = be64toh(cpu_info->online_time);
+			cpu_info->mt_idle_time =
+				be64toh(cpu_info->mt_idle_time);
+			cpu_info++;
+		}
+		sys_hdr = (void *) cpu_info;
+	}
+	if (!(time_hdr->flags & LPAR_PHYS_FLG))
+		return 0;
+	phys_hdr = (void *) sys_hdr;
+	phys_cpu = (void *) (phys_hdr + 1);
+	if ((void *) phys_cpu > end ||
+	    (void *) (phys_cpu + phys_hdr->cpus) > end)
+		return -1;
+	for (i = 0; i < phys_hdr->cpus; i++) {
+		phys_cpu->cpu_addr = be16toh(phys_cpu->cpu_addr);
+		phys_cpu->mgm_time = be64toh(phys_cpu->mgm_time);
+		phys_cpu++;
+	}
+	return 0;
+}
+
 /*
  * Read debugfs file
  */
 static void l_read_debugfs(struct l_debugfs_d204_hdr **hdr,
 			   struct l_x_info_blk_hdr **data)
 {
-	long real_buf_size;
-	ssize_t rc;
-	void *buf;
-	int fh;
-
-	do {
-		fh = dg_debugfs_open(DEBUGFS_FILE);
-		*hdr = buf = ht_alloc(l_204_buf_size);
-		rc = read(fh, buf, l_204_buf_size);
-		if (rc == -1)
-			ERR_EXIT_ERRNO("Reading hypervisor data failed");
-		close(fh);
-		real_buf_size = (*hdr)->len + sizeof(struct l_debugfs_d204_hdr);
-		if (rc == real_buf_size)
-			break;
-		l_204_buf_size = real_buf_size;
-		ht_free(buf);
-	} while (1);
-	*data = buf + sizeof(struct l_debugfs_d204_hdr);
+	*hdr = dg_debugfs_read(DEBUGFS_FILE, &l_204_buf_size,
+			       sizeof(struct l_debugfs_d204_hdr),
+			       l_d204_to_host);
+	*data = ((void *) *hdr) + sizeof(struct l_debugfs_d204_hdr);
 }
 
 /*
@@ -370,14 +410,14 @@ static struct sd_dg l_sd_dg = {
  */
 int dg_debugfs_lpar_init(void)
 {
-	int fh;
+	int rc;
 
 	l_204_buf_size = sizeof(struct l_debugfs_d204_hdr);
-	fh = dg_debugfs_open(DEBUGFS_FILE);
-	if (fh < 0)
-		return fh;
-	else
-		close(fh);
+	rc = dg_debugfs_check(DEBUGFS_FILE);
+	if (rc < 0)
+		return rc;
+	if (g.o.record_file)
+		dg_record_open(g.o.record_file);
 	sd_dg_register(&l_sd_dg, 1);
 	return 0;
 }
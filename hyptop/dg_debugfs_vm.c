@@ -9,11 +9,13 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <endian.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <unistd.h>
 
 #include "dg_debugfs.h"
+#include "dg_record.h"
 #include "helper.h"
 #include "hyptop.h"
 #include "sd.h"
@@ -21,9 +23,10 @@
 #define VM_CPU_TYPE	"UN"
 #define VM_CPU_ID	"ALL"
 #define NAME_LEN	8
-#define DEBUGFS_FILE	"diag_2fc"
+#define DEBUGFS_FILE	DG_DEBUGFS_FILE_2FC
 #define VM_CPU_ID_OPERATING	"0"
 #define VM_CPU_ID_STOPPED	"1"
+#define GUEST_NAME_REC		"guest_name"
 
 static u64 l_update_time_us;
 static long l_2fc_buf_size;
@@ -73,7 +76,66 @@ struct l_debugfs_d2fc {
 	char			diag2fc_buf[];
 } __attribute__ ((packed));
 
- /*
+/*
+ * Convert recorded debugfs file to host byte order
+ */
+static int l_d2fc_to_host(void *buf, size_t len)
+{
+	struct l_debugfs_d2fc_hdr *hdr = buf;
+	struct l_diag2fc_data *data;
+	u64 i;
+
+	hdr->len = be64toh(hdr->len);
+	hdr->version = be16toh(hdr->version);
+	dg_debugfs_tod_ext_to_host(hdr->tod_ext);
+	hdr->count = be64toh(hdr->count);
+	/* The first entry is always used */
+	if (hdr->count == 0 ||
+	    hdr->count > (len - sizeof(*hdr)) / sizeof(*data))
+		return -1;
+	data = (void *) (hdr + 1);
+	for (i = 0; i < hdr->count; i++) {
+		data->version = be32toh(data->version);
+		data->flags = be32toh(data->flags);
+		data->used_cpu = be64toh(data->used_cpu);
+		data->el_time = be64toh(data->el_time);
+		data->mem_min_kb = be64toh(data->mem_min_kb);
+		data->mem_max_kb = be64toh(data->mem_max_kb);
+		data->mem_share_kb = be64toh(data->mem_share_kb);
+		data->mem_used_kb = be64toh(data->mem_used_kb);
+		data->pcpus = be32toh(data->pcpus);
+		data->lcpus = be32toh(data->lcpus);
+		data->vcpus = be32toh(data->vcpus);
+		data->ocpus = be32toh(data->ocpus);
+		data->cpu_max = be32toh(data->cpu_max);
+		data->cpu_shares = be32toh(data->cpu_shares);
+		data->cpu_use_samp = be32toh(data->cpu_use_samp);
+		data->cpu_delay_samp = be32toh(data->cpu_delay_samp);
+		data->page_wait_samp = be32toh(data->page_wait_samp);
+		data->idle_samp = be32toh(data->idle_samp);
+		data->other_samp = be32toh(data->other_samp);
+		data->total_samp = be32toh(data->total_samp);
+		data++;
+	}
+	return 0;
+}
+
+/*
+ * Get local guest name from recording
+ */
+static void l_guest_name_replay(void)
+{
+	size_t len;
+	char *buf;
+
+	buf = dg_replay_read(GUEST_NAME_REC, &len);
+	if (len == 0 || len > sizeof(l_guest_name) || buf[len - 1] != 0)
+		ERR_EXIT("Recording \"%s\" is invalid\n", g.o.replay_file);
+	strcpy(l_guest_name, buf);
+	ht_free(buf);
+}
+
+/*
  * Get local guest name
  */
 static void l_guest_name_init(void)
@@ -82,6 +144,10 @@ static void l_guest_name_init(void)
 	char line[1024];
 	FILE *fh;
 
+	if (dg_replay_active()) {
+		l_guest_name_replay();
+		goto out;
+	}
 	fh = fopen("/proc/sysinfo", "r");
 	if (!fh)
 		ERR_EXIT_ERRNO("Could not open '/proc/sysinfo'");
@@ -92,6 +158,11 @@ static void l_guest_name_init(void)
 	if (!found)
 		ERR_EXIT("Could find guest name in '/proc/sysinfo'");
 	fclose(fh);
+out:
+	/* The guest name is needed to replay the diag 0c data */
+	if (dg_record_active())
+		dg_record_write(GUEST_NAME_REC, l_guest_name,
+				strlen(l_guest_name) + 1);
 }
 
 /*
@@ -186,25 +257,10 @@ static void l_sd_sys_fill(struct sd_sys *guest, struct l_diag2fc_data *data)
 static void l_read_debugfs(struct l_debugfs_d2fc_hdr **hdr,
 			   struct l_diag2fc_data **data)
 {
-	long real_buf_size;
-	ssize_t rc;
-	void *buf;
-	int fh;
-
-	do {
-		fh = dg_debugfs_open(DEBUGFS_FILE);
-		*hdr = buf = ht_alloc(l_2fc_buf_size);
-		rc = read(fh, buf, l_2fc_buf_size);
-		if (rc == -1)
-			ERR_EXIT_ERRNO("Reading hypervisor data failed");
-		close(fh);
-		real_buf_size = (*hdr)->len + sizeof(struct l_debugfs_d2fc_hdr);
-		if (rc == real_buf_size)
-			break;
-		l_2fc_buf_size = real_buf_size;
-		ht_free(buf);
-	} while (1);
-	*data = buf + sizeof(struct l_debugfs_d2fc_hdr);
+	*hdr = dg_debugfs_read(DEBUGFS_FILE, &l_2fc_buf_size,
+			       sizeof(struct l_debugfs_d2fc_hdr),
+			       l_d2fc_to_host);
+	*data = ((void *) *hdr) + sizeof(struct l_debugfs_d2fc_hdr);
 }
 
 /*
@@ -346,17 +402,17 @@ static struct sd_dg dg_debugfs_vm_dg = {
  */
 int dg_debugfs_vm_init(void)
 {
-	int fh;
+	int rc;
 
-	fh = dg_debugfs_vmd0c_init();
-	if (fh == 0)
+	rc = dg_debugfs_vmd0c_init();
+	if (rc == 0)
 		l_use_debugfs_vmd0c = 1;
-	fh = dg_debugfs_open(DEBUGFS_FILE);
-	if (fh < 0)
-		return fh;
-	else
-		close(fh);
+	rc = dg_debugfs_check(DEBUGFS_FILE);
+	if (rc < 0)
+		return rc;
 	l_2fc_buf_size = sizeof(struct l_debugfs_d2fc_hdr);
+	if (g.o.record_file)
+		dg_record_open(g.o.record_file);
 	l_guest_name_init();
 	sd_dg_register(&dg_debugfs_vm_dg, 0);
 	return 0;
@@ -9,6 +9,7 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <endian.h>
 #include <errno.h>
 #include <linux/types.h>
 #include <stdlib.h>
@@ -19,7 +20,7 @@
 #include "hyptop.h"
 #include "sd.h"
 
-#define DEBUGFS_FILE	"diag_0c"
+#define DEBUGFS_FILE	DG_DEBUGFS_FILE_0C
 
 static long l_0c_buf_size;
 
@@ -74,33 +75,41 @@ static void l_sd_cpu_fill(struct sd_sys *sys, unsigned int cpu_nr,
 	sd_cpu_commit(cpu);
 }
 
+/*
+ * Convert recorded debugfs file to host byte order
+ */
+static int l_d0c_to_host(void *buf, size_t len)
+{
+	struct hypfs_diag0c_hdr *hdr = buf;
+	struct hypfs_diag0c_entry *entry;
+	u64 i;
+
+	hdr->len = be64toh(hdr->len);
+	hdr->version = be16toh(hdr->version);
+	dg_debugfs_tod_ext_to_host(hdr->tod_ext);
+	hdr->count = be64toh(hdr->count);
+	if (hdr->count > (len - sizeof(*hdr)) / sizeof(*entry))
+		return -1;
+	entry = (void *) (hdr + 1);
+	for (i = 0; i < hdr->count; i++) {
+		entry->virtcpu = be64toh(entry->virtcpu);
+		entry->totalproc = be64toh(entry->totalproc);
+		entry->cpu = be32toh(entry->cpu);
+		entry++;
+	}
+	return 0;
+}
+
 /*
  * Read debugfs file
  */
 static void l_read_debugfs(struct hypfs_diag0c_hdr **hdr,
 			   struct hypfs_diag0c_entry **entry)
 {
-	long real_buf_size;
-	ssize_t rc;
-	void *buf;
-	int fh;
-
-	do {
-		fh = dg_debugfs_open(DEBUGFS_FILE);
-		if (fh < 0)
-			ERR_EXIT_ERRNO("Could not open file: %s", DEBUGFS_FILE);
-		*hdr = buf = ht_alloc(l_0c_buf_size);
-		rc = read(fh, buf, l_0c_buf_size);
-		if (rc == -1)
-			ERR_EXIT_ERRNO("Reading hypervisor data failed");
-		close(fh);
-		real_buf_size = (*hdr)->len + sizeof(struct hypfs_diag0c_hdr);
-		if (rc == real_buf_size)
-			break;
-		l_0c_buf_size = real_buf_size;
-		ht_free(buf);
-	} while (1);
-	*entry = buf + sizeof(struct hypfs_diag0c_hdr);
+	*hdr = dg_debugfs_read(DEBUGFS_FILE, &l_0c_buf_size,
+			       sizeof(struct hypfs_diag0c_hdr),
+			       l_d0c_to_host);
+	*entry = ((void *) *hdr) + sizeof(struct hypfs_diag0c_hdr);
 }
 
 /*
@@ -138,13 +147,8 @@ void dg_debugfs_vmd0c_sys_cpu_fill(struct sd_sys *sys, u64 online_time,
  */
 int dg_debugfs_vmd0c_init(void)
 {
-	int fh;
-
-	fh = dg_debugfs_open(DEBUGFS_FILE);
-	if (fh < 0)
+	if (dg_debugfs_check(DEBUGFS_FILE) < 0)
 		return -1;
-	else
-		close(fh);
 	l_0c_buf_size = sizeof(struct hypfs_diag0c_hdr);
 	return 0;
 }
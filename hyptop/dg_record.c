@@ -0,0 +1,308 @@
+/*
+ * hyptop - Show hypervisor performance data on System z
+ *
+ * Record and replay hypervisor data of the debugfs data gatherers
+ *
+ * A recording starts with a file header followed by one record for each
+ * debugfs file that has been read. Each record consists of a record header
+ * with the time stamp and the name of the file and the unmodified file
+ * content. All values are stored in big-endian byte order: The headers are
+ * converted, and the file content is big-endian because it is recorded
+ * on s390.
+ *
+ * On replay the records are passed to the data gatherers in the recorded
+ * order instead of reading the debugfs files. The data gatherers convert
+ * the file content to the byte order of the replay system.
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "dg_record.h"
+#include "helper.h"
+#include "hyptop.h"
+
+#define RECORD_MAGIC		"HYPTOPRC"
+#define RECORD_VERSION		2
+#define RECORD_NAME_LEN		16
+#define RECORD_FILES_MAX	8
+
+/*
+ * Recording file header
+ */
+struct l_file_hdr {
+	char	magic[8];
+	u32	version;
+	u32	reserved;
+};
+
+/*
+ * Record header
+ */
+struct l_rec_hdr {
+	u64	time_us;		/* Time since start of recording */
+	u64	len;			/* Length of data following */
+	char	file[RECORD_NAME_LEN];	/* Name of debugfs file */
+};
+
+/*
+ * Globals for recording
+ */
+static struct {
+	FILE		*fh;
+	const char	*path;
+	u64		start_us;
+	char		last_file[RECORD_NAME_LEN];
+	void		*last_buf;
+	size_t		last_len;
+} l_rec;
+
+/*
+ * Globals for replay
+ */
+static struct {
+	FILE		*fh;
+	const char	*path;
+	u64		start_us;
+	u64		first_us;
+	int		first_done;
+	char		file_vec[RECORD_FILES_MAX][RECORD_NAME_LEN];
+	int		file_cnt;
+	off_t		size;
+} l_play;
+
+/*
+ * Get monotonic time in microseconds
+ */
+static u64 l_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Write to recording file or exit on error
+ */
+static void l_record_fwrite(const void *buf, size_t len)
+{
+	if (len && fwrite(buf, len, 1, l_rec.fh) != 1)
+		ERR_EXIT_ERRNO("Could not write recording \"%s\"", l_rec.path);
+}
+
+/*
+ * Open file for recording
+ */
+void dg_record_open(const char *path)
+{
+	struct l_file_hdr hdr;
+
+	/* The debugfs files are only available on big-endian s390 */
+	if (__BYTE_ORDER != __BIG_ENDIAN)
+		ERR_EXIT("Recording requires a big-endian system\n");
+	l_rec.fh = fopen(path, "w");
+	if (!l_rec.fh)
+		ERR_EXIT_ERRNO("Could not open recording \"%s\"", path);
+	l_rec.path = path;
+	l_rec.start_us = l_time_us();
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, RECORD_MAGIC, sizeof(hdr.magic));
+	hdr.version = htobe32(RECORD_VERSION);
+	l_record_fwrite(&hdr, sizeof(hdr));
+}
+
+/*
+ * Is recording active?
+ */
+int dg_record_active(void)
+{
+	return l_rec.fh != NULL;
+}
+
+/*
+ * Append content of debugfs "file" to recording
+ *
+ * The data gatherers read a file again until the hypervisor has provided
+ * a new snapshot. Such repeated identical snapshots are recorded only once.
+ */
+void dg_record_write(const char *file, const void *buf, size_t len)
+{
+	struct l_rec_hdr hdr;
+
+	if (strcmp(l_rec.last_file, file) == 0 && l_rec.last_len == len &&
+	    memcmp(l_rec.last_buf, buf, len) == 0)
+		return;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.time_us = htobe64(l_time_us() - l_rec.start_us);
+	hdr.len = htobe64(len);
+	strncpy(hdr.file, file, sizeof(hdr.file) - 1);
+	l_record_fwrite(&hdr, sizeof(hdr));
+	l_record_fwrite(buf, len);
+	if (fflush(l_rec.fh))
+		ERR_EXIT_ERRNO("Could not write recording \"%s\"", l_rec.path);
+
+	memcpy(l_rec.last_file, hdr.file, sizeof(l_rec.last_file));
+	l_rec.last_buf = ht_realloc(l_rec.last_buf, len);
+	memcpy(l_rec.last_buf, buf, len);
+	l_rec.last_len = len;
+}
+
+/*
+ * Read next record header, return 0 at end of recording
+ *
+ * The data of the record must fit into the rest of the recording.
+ */
+static int l_replay_hdr_read(struct l_rec_hdr *hdr)
+{
+	off_t pos;
+
+	if (fread(hdr, sizeof(*hdr), 1, l_play.fh) == 1) {
+		hdr->time_us = be64toh(hdr->time_us);
+		hdr->len = be64toh(hdr->len);
+		hdr->file[RECORD_NAME_LEN - 1] = 0;
+		pos = ftello(l_play.fh);
+		if (pos < 0)
+			ERR_EXIT_ERRNO("Could not read recording \"%s\"",
+				       l_play.path);
+		if (hdr->len > (u64) (l_play.size - pos))
+			ERR_EXIT("Recording \"%s\" is truncated\n",
+				 l_play.path);
+		return 1;
+	}
+	if (ferror(l_play.fh))
+		ERR_EXIT_ERRNO("Could not read recording \"%s\"", l_play.path);
+	return 0;
+}
+
+/*
+ * Remember which debugfs files are contained in the recording
+ */
+static void l_replay_file_add(const char *file)
+{
+	int i;
+
+	for (i = 0; i < l_play.file_cnt; i++) {
+		if (strcmp(l_play.file_vec[i], file) == 0)
+			return;
+	}
+	if (l_play.file_cnt == RECORD_FILES_MAX)
+		ERR_EXIT("Recording \"%s\" is invalid\n", l_play.path);
+	strcpy(l_play.file_vec[l_play.file_cnt++], file);
+}
+
+/*
+ * Open recording for replay
+ */
+void dg_replay_open(const char *path)
+{
+	struct l_file_hdr file_hdr;
+	struct l_rec_hdr hdr;
+	struct stat sb;
+
+	l_play.fh = fopen(path, "r");
+	if (!l_play.fh)
+		ERR_EXIT_ERRNO("Could not open recording \"%s\"", path);
+	l_play.path = path;
+	if (fstat(fileno(l_play.fh), &sb))
+		ERR_EXIT_ERRNO("Could not read recording \"%s\"", path);
+	l_play.size = sb.st_size;
+	if (fread(&file_hdr, sizeof(file_hdr), 1, l_play.fh) != 1 ||
+	    memcmp(file_hdr.magic, RECORD_MAGIC, sizeof(file_hdr.magic)) != 0)
+		ERR_EXIT("File \"%s\" is not a hyptop recording\n", path);
+	file_hdr.version = be32toh(file_hdr.version);
+	if (file_hdr.version != RECORD_VERSION)
+		ERR_EXIT("Recording \"%s\" has unsupported version %u\n", path,
+			 file_hdr.version);
+	/* Scan the record headers for the contained files */
+	while (l_replay_hdr_read(&hdr)) {
+		l_replay_file_add(hdr.file);
+		if (fseeko(l_play.fh, hdr.len, SEEK_CUR))
+			ERR_EXIT_ERRNO("Could not read recording \"%s\"",
+				       path);
+	}
+	if (fseeko(l_play.fh, sizeof(file_hdr), SEEK_SET))
+		ERR_EXIT_ERRNO("Could not read recording \"%s\"", path);
+}
+
+/*
+ * Is replay active?
+ */
+int dg_replay_active(void)
+{
+	return l_play.fh != NULL;
+}
+
+/*
+ * Does the recording contain data for debugfs "file"?
+ */
+int dg_replay_has_file(const char *file)
+{
+	int i;
+
+	for (i = 0; i < l_play.file_cnt; i++) {
+		if (strcmp(l_play.file_vec[i], file) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Wait until record with time stamp "time_us" is due
+ *
+ * The time between the records is divided by the replay speed. With
+ * speed zero the records are replayed without delay.
+ */
+static void l_replay_wait(u64 time_us)
+{
+	struct timespec ts;
+	u64 due_us;
+
+	if (!l_play.first_done) {
+		l_play.first_us = time_us;
+		l_play.start_us = l_time_us();
+		l_play.first_done = 1;
+		return;
+	}
+	if (g.o.replay_speed == 0)
+		return;
+	due_us = l_play.start_us +
+		(time_us - l_play.first_us) / g.o.replay_speed;
+	ts.tv_sec = due_us / 1000000;
+	ts.tv_nsec = (due_us % 1000000) * 1000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+	       EINTR) {}
+}
+
+/*
+ * Read next record that must contain debugfs "file"
+ *
+ * Returns the allocated file content. At the end of the recording hyptop
+ * exits.
+ */
+void *dg_replay_read(const char *file, size_t *len)
+{
+	struct l_rec_hdr hdr;
+	void *buf;
+
+	if (!l_replay_hdr_read(&hdr))
+		hyptop_exit(0);
+	if (strcmp(hdr.file, file) != 0)
+		ERR_EXIT("Recording \"%s\" contains \"%s\" instead of \"%s\"\n",
+			 l_play.path, hdr.file, file);
+	buf = ht_alloc(hdr.len);
+	if (hdr.len && fread(buf, hdr.len, 1, l_play.fh) != 1)
+		ERR_EXIT("Recording \"%s\" is truncated\n", l_play.path);
+	l_replay_wait(hdr.time_us);
+	*len = hdr.len;
+	return buf;
+}
@@ -0,0 +1,26 @@
+/*
+ * hyptop - Show hypervisor performance data on System z
+ *
+ * Record and replay hypervisor data of the debugfs data gatherers
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef DG_RECORD_H
+#define DG_RECORD_H
+
+#include <stddef.h>
+
+extern void dg_record_open(const char *path);
+extern int dg_record_active(void);
+extern void dg_record_write(const char *file, const void *buf, size_t len);
+
+extern void dg_replay_open(const char *path);
+extern int dg_replay_active(void);
+extern int dg_replay_has_file(const char *file);
+extern void *dg_replay_read(const char *file, size_t *len);
+
+#endif /* DG_RECORD_H */
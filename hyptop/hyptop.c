@@ -23,6 +23,7 @@
 #include "hyptop.h"
 #include "opts.h"
 #include "sd.h"
+#include "stream.h"
 #include "win_cpu_types.h"
 
 #ifdef WITH_HYPFS
@@ -252,7 +253,8 @@ fail:
 #ifdef WITH_HYPFS
 static void l_dg_init(void)
 {
-	if (dg_debugfs_init(0) == 0)
+	/* Recording is only supported for debugfs, so do not fall back */
+	if (dg_debugfs_init(g.o.record_file != NULL) == 0)
 		return;
 	if (dg_hypfs_init() == 0)
 		return;
@@ -368,6 +370,8 @@ int main(int argc, char *argv[])
 
 	win_sys_list_init();
 	win_sys_init();
+	if (g.o.output != HYPTOP_OUTPUT_TEXT)
+		stream_run();
 	g.win_cpu_types = win_cpu_types_new();
 	l_event_loop();
 	return 0;
@@ -48,6 +48,12 @@ struct hyptop_win_opts {
 	char				sort_field;
 };
 
+enum hyptop_output {
+	HYPTOP_OUTPUT_TEXT,
+	HYPTOP_OUTPUT_JSON,
+	HYPTOP_OUTPUT_CSV,
+};
+
 struct hyptop_opts {
 	unsigned int			win_specified;
 	unsigned int			batch_mode_specified;
@@ -60,6 +66,11 @@ struct hyptop_opts {
 
 	int				delay_s;
 	int				delay_us;
+	enum hyptop_output		output;
+
+	const char			*record_file;
+	const char			*replay_file;
+	double				replay_speed;
 };
 
 /*
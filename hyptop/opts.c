@@ -10,6 +10,7 @@
  */
 
 #include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 
 #include "lib/zt_common.h"
@@ -22,6 +23,9 @@
 
 static const char l_copyright_str[] = "Copyright IBM Corp. 2010, 2017";
 
+/* Options without short option character */
+#define OPT_REPLAY_SPEED	256
+
 /*
  * Help text for tool
  */
@@ -39,7 +43,11 @@ static char HELP_TEXT[] =
 "-t, --cpu_types TYPE[,..]       CPU types used for time calculations\n"
 "-b, --batch_mode                Use batch mode (no curses)\n"
 "-d, --delay SECONDS             Delay time between screen updates\n"
-"-n, --iterations NUMBER         Number of iterations before ending\n";
+"-n, --iterations NUMBER         Number of iterations before ending\n"
+"-o, --output FORMAT             Output format (\"text\", \"json\", \"csv\")\n"
+"-r, --record FILE               Record hypervisor data into FILE\n"
+"-p, --replay FILE               Replay hypervisor data recorded in FILE\n"
+"    --replay_speed FACTOR       Speed factor for replay (0: no delay)\n";
 
 /*
  * Initialize default settings
@@ -48,6 +56,7 @@ static void l_init_defaults(void)
 {
 	g.prog_name = PROG_NAME;
 	g.o.delay_s = HYPTOP_OPT_DEFAULT_DELAY;
+	g.o.replay_speed = 1;
 	g.w.cur = &win_sys_list;
 	g.o.cur_win = &win_sys_list;
 }
@@ -96,16 +105,36 @@ static int l_number_check(const char *str)
 
 /*
  * Set delay option
+ *
+ * The delay can be specified with up to six decimal places, e.g. "0.5".
  */
 static void l_delay_set(char *delay_string)
 {
-	int secs;
-
-	l_number_check(delay_string);
-	if (sscanf(delay_string, "%i", &secs) != 1)
-		ERR_EXIT("The delay value \"%s\" is invalid\n", delay_string);
+	unsigned long secs, usecs = 0;
+	char *ptr = delay_string;
+	int digits = 0;
+
+	if (!isdigit(*ptr))
+		goto fail;
+	secs = strtoul(ptr, &ptr, 10);
+	if (*ptr == '.') {
+		ptr++;
+		for (; isdigit(*ptr); ptr++) {
+			if (digits == 6)
+				continue;
+			usecs = usecs * 10 + (*ptr - '0');
+			digits++;
+		}
+		for (; digits < 6; digits++)
+			usecs *= 10;
+	}
+	if (*ptr != 0 || secs > INT_MAX)
+		goto fail;
 	g.o.delay_s = secs;
-	g.o.delay_us = 0;
+	g.o.delay_us = usecs;
+	return;
+fail:
+	ERR_EXIT("The delay value \"%s\" is invalid\n", delay_string);
 }
 
 /*
@@ -271,6 +300,38 @@ static void l_batch_mode_set(void)
 	g.o.batch_mode_specified = 1;
 }
 
+/*
+ * Set the "--output" option
+ */
+static void l_output_set(const char *str)
+{
+	if (strcmp(str, "text") == 0)
+		g.o.output = HYPTOP_OUTPUT_TEXT;
+	else if (strcmp(str, "json") == 0)
+		g.o.output = HYPTOP_OUTPUT_JSON;
+	else if (strcmp(str, "csv") == 0)
+		g.o.output = HYPTOP_OUTPUT_CSV;
+	else
+		ERR_EXIT("The output format \"%s\" is unknown\n", str);
+	/* Structured output is written in batch mode only */
+	if (g.o.output != HYPTOP_OUTPUT_TEXT)
+		l_batch_mode_set();
+}
+
+/*
+ * Set the "--replay_speed" option
+ */
+static void l_replay_speed_set(const char *str)
+{
+	char *end;
+	double speed;
+
+	speed = strtod(str, &end);
+	if (*str == 0 || *end != 0 || !isfinite(speed) || speed < 0)
+		ERR_EXIT("The replay speed \"%s\" is invalid\n", str);
+	g.o.replay_speed = speed;
+}
+
 /*
  * Make option consisteny checks at end of command line parsing
  */
@@ -305,9 +366,13 @@ void opts_parse(int argc, char *argv[])
 		{ "fields",      required_argument, NULL, 'f'},
 		{ "sort_field",  required_argument, NULL, 'S'},
 		{ "cpu_types",   required_argument, NULL, 't'},
+		{ "output",      required_argument, NULL, 'o'},
+		{ "record",      required_argument, NULL, 'r'},
+		{ "replay",      required_argument, NULL, 'p'},
+		{ "replay_speed", required_argument, NULL, OPT_REPLAY_SPEED},
 		{ NULL,          0,                 NULL, 0  }
 	};
-	static const char option_string[] = "vhbd:w:s:n:f:t:S:";
+	static const char option_string[] = "vhbd:w:s:n:f:t:S:o:r:p:";
 
 	l_init_defaults();
 	while (1) {
@@ -346,6 +411,18 @@ void opts_parse(int argc, char *argv[])
 		case 'S':
 			l_sort_field_set(optarg);
 			break;
+		case 'o':
+			l_output_set(optarg);
+			break;
+		case 'r':
+			g.o.record_file = optarg;
+			break;
+		case 'p':
+			g.o.replay_file = optarg;
+			break;
+		case OPT_REPLAY_SPEED:
+			l_replay_speed_set(optarg);
+			break;
 		default:
 			l_std_usage_exit();
 		}
@@ -414,7 +491,7 @@ void opts_iterations_next(void)
 		if (g.o.iterations_act >= g.o.iterations)
 			hyptop_exit(0);
 	}
-	if (g.o.batch_mode_specified)
+	if (g.o.batch_mode_specified && g.o.output == HYPTOP_OUTPUT_TEXT)
 		printf("---------------------------------------------------"
 		       "----------------------------\n");
 }
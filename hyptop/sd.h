@@ -12,6 +12,7 @@
 #ifndef SD_H
 #define SD_H
 
+#include "lib/util_hash.h"
 #include "lib/util_list.h"
 
 #include "helper.h"
@@ -75,14 +76,17 @@ struct sd_cpu;
  */
 struct sd_sys {
 	struct util_list_node	list;
+	struct util_hash_node	hash;
 	struct sd_info		i;
 	u64			update_time_us;
 	u32			child_cnt;
 	u32			child_cnt_active;
 	struct util_list	child_list;
+	struct util_hash	child_hash;
 	u32			cpu_cnt;
 	u32			cpu_cnt_active;
 	struct util_list	cpu_list;
+	struct util_hash	cpu_hash;
 	u32			threads_per_core;
 	char			id[SD_SYS_ID_SIZE];
 	struct sd_sys_name	name;
@@ -192,6 +196,7 @@ enum sd_cpu_state {
 
 struct sd_cpu {
 	struct util_list_node	list;
+	struct util_hash_node	hash;
 	struct sd_info		i;
 	char			id[9];
 	struct sd_cpu_type	*type;
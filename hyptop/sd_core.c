@@ -185,13 +185,7 @@ int sd_dg_has_core_data(void)
  */
 struct sd_cpu *sd_cpu_get(struct sd_sys *sys, const char* id)
 {
-	struct sd_cpu *cpu;
-
-	util_list_iterate(&sys->cpu_list, cpu) {
-		if (strcmp(cpu->id, id) == 0)
-			return cpu;
-	}
-	return NULL;
+	return util_hash_find_str(&sys->cpu_hash, id);
 }
 
 /*
@@ -224,7 +218,7 @@ struct sd_cpu *sd_cpu_new(struct sd_sys *parent, const char *id,
 	cpu->d_cur = &cpu->d1;
 	cpu->cnt = cnt;
 
-	util_list_add_tail(&parent->cpu_list, cpu);
+	util_hash_add_tail(&parent->cpu_hash, cpu);
 
 	return cpu;
 }
@@ -234,13 +228,7 @@ struct sd_cpu *sd_cpu_new(struct sd_sys *parent, const char *id,
  */
 struct sd_sys *sd_sys_get(struct sd_sys *parent, const char* id)
 {
-	struct sd_sys *sys;
-
-	util_list_iterate(&parent->child_list, sys) {
-		if (strcmp(sys->id, id) == 0)
-			return sys;
-	}
-	return NULL;
+	return util_hash_find_str(&parent->child_hash, id);
 }
 
 /*
@@ -253,12 +241,16 @@ struct sd_sys *sd_sys_new(struct sd_sys *parent, const char *id)
 	sys_new = ht_zalloc(sizeof(*sys_new));
 	util_strlcpy(sys_new->id, id, sizeof(sys_new->id));
 	util_list_init(&sys_new->child_list, struct sd_sys, list);
+	util_hash_init_str(&sys_new->child_hash, &sys_new->child_list,
+			   struct sd_sys, hash, id);
 	util_list_init(&sys_new->cpu_list, struct sd_cpu, list);
+	util_hash_init_str(&sys_new->cpu_hash, &sys_new->cpu_list,
+			   struct sd_cpu, hash, id);
 
 	if (parent) {
 		sys_new->i.parent = parent;
 		parent->child_cnt++;
-		util_list_add_tail(&parent->child_list, sys_new);
+		util_hash_add_tail(&parent->child_hash, sys_new);
 	}
 	sys_new->threads_per_core = 1;
 	return sys_new;
@@ -269,6 +261,8 @@ struct sd_sys *sd_sys_new(struct sd_sys *parent, const char *id)
  */
 static void sd_sys_free(struct sd_sys *sys)
 {
+	util_hash_exit(&sys->child_hash);
+	util_hash_exit(&sys->cpu_hash);
 	ht_free(sys);
 }
 
@@ -329,7 +323,7 @@ static void l_cpu_update_end(struct sd_sys *sys)
 	util_list_iterate_safe(&sys->cpu_list, cpu, tmp) {
 		if (!cpu->i.active) {
 			/* CPU has not been updated, remove it */
-			util_list_remove(&sys->cpu_list, cpu);
+			util_hash_remove(&sys->cpu_hash, cpu);
 			sd_cpu_free(cpu);
 			continue;
 		}
@@ -349,7 +343,7 @@ static void l_sys_update_end(struct sd_sys *sys)
 	util_list_iterate_safe(&sys->child_list, child, tmp) {
 		if (!child->i.active) {
 			/* child has not been updated, remove it */
-			util_list_remove(&sys->child_list, child);
+			util_hash_remove(&sys->child_hash, child);
 			sd_sys_free(child);
 			continue;
 		}
@@ -0,0 +1,374 @@
+/*
+ * hyptop - Show hypervisor performance data on System z
+ *
+ * Structured output: Write raw system data as JSON or CSV records
+ *
+ * The item values are written as provided by the data gatherer without
+ * unit conversion: Times in microseconds, memory in KiB, and the "diff"
+ * items in microseconds per second of the last update interval.
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "helper.h"
+#include "hyptop.h"
+#include "opts.h"
+#include "sd.h"
+#include "stream.h"
+
+/*
+ * Globals for structured output
+ */
+static struct sd_sys_item	**l_sys_item_vec;	/* Items for sys_list */
+static struct sd_cpu_item	**l_cpu_item_vec;	/* Items for sys */
+static unsigned int		l_field_cnt;		/* Fields in record */
+
+/*
+ * Write string as JSON string or CSV field
+ */
+static void l_str_put(const char *str)
+{
+	unsigned char c;
+
+	if (g.o.output == HYPTOP_OUTPUT_CSV) {
+		if (!strpbrk(str, ",\"\r\n")) {
+			fputs(str, stdout);
+			return;
+		}
+		putchar('"');
+		for (; *str; str++) {
+			if (*str == '"')
+				putchar('"');
+			putchar(*str);
+		}
+		putchar('"');
+		return;
+	}
+	putchar('"');
+	for (; *str; str++) {
+		c = *str;
+		if (c == '"' || c == '\\')
+			printf("\\%c", c);
+		else if (c < 0x20)
+			printf("\\u%04x", c);
+		else
+			putchar(c);
+	}
+	putchar('"');
+}
+
+/*
+ * Start new record
+ */
+static void l_rec_start(void)
+{
+	l_field_cnt = 0;
+	if (g.o.output == HYPTOP_OUTPUT_JSON)
+		putchar('{');
+}
+
+/*
+ * Finish record
+ */
+static void l_rec_end(void)
+{
+	if (g.o.output == HYPTOP_OUTPUT_JSON)
+		putchar('}');
+	putchar('\n');
+}
+
+/*
+ * Write field separator and for JSON the field name
+ */
+static void l_field_key(const char *key)
+{
+	if (l_field_cnt++)
+		putchar(',');
+	if (g.o.output != HYPTOP_OUTPUT_JSON)
+		return;
+	l_str_put(key);
+	putchar(':');
+}
+
+/*
+ * Write CSV header field
+ */
+static void l_head_put(const char *key)
+{
+	if (l_field_cnt++)
+		putchar(',');
+	l_str_put(key);
+}
+
+static void l_field_str(const char *key, const char *value)
+{
+	l_field_key(key);
+	l_str_put(value);
+}
+
+static void l_field_u64(const char *key, u64 value)
+{
+	l_field_key(key);
+	printf("%llu", (unsigned long long) value);
+}
+
+static void l_field_s64(const char *key, s64 value)
+{
+	l_field_key(key);
+	printf("%lld", (long long) value);
+}
+
+/*
+ * Write field for value that is not available
+ */
+static void l_field_none(const char *key)
+{
+	l_field_key(key);
+	if (g.o.output == HYPTOP_OUTPUT_JSON)
+		fputs("null", stdout);
+}
+
+/*
+ * Write time stamp in seconds since the epoch
+ */
+static void l_field_time(struct timeval *tv)
+{
+	l_field_key("time");
+	printf("%ld.%06ld", (long) tv->tv_sec, (long) tv->tv_usec);
+}
+
+/*
+ * Write system item value
+ */
+static void l_sys_item_put(struct sd_sys *sys, struct sd_sys_item *item)
+{
+	const char *key = sd_sys_item_table_col(item)->head;
+
+	if (!sd_sys_item_set(sys, item)) {
+		l_field_none(key);
+		return;
+	}
+	switch (sd_sys_item_type(item)) {
+	case SD_TYPE_U64:
+	case SD_TYPE_U32:
+	case SD_TYPE_U16:
+		l_field_u64(key, sd_sys_item_u64(sys, item));
+		break;
+	case SD_TYPE_S64:
+		l_field_s64(key, sd_sys_item_s64(sys, item));
+		break;
+	case SD_TYPE_STR:
+		l_field_str(key, sd_sys_item_str(sys, item));
+		break;
+	}
+}
+
+/*
+ * Write CPU item value
+ */
+static void l_cpu_item_put(struct sd_cpu *cpu, struct sd_cpu_item *item)
+{
+	const char *key = sd_cpu_item_table_col(item)->head;
+
+	if (!sd_cpu_item_set(item, cpu)) {
+		l_field_none(key);
+		return;
+	}
+	switch (sd_cpu_item_type(item)) {
+	case SD_TYPE_U64:
+	case SD_TYPE_U32:
+	case SD_TYPE_U16:
+		l_field_u64(key, sd_cpu_item_u64(item, cpu));
+		break;
+	case SD_TYPE_S64:
+		l_field_s64(key, sd_cpu_item_s64(item, cpu));
+		break;
+	case SD_TYPE_STR:
+		l_field_str(key, sd_cpu_item_str(item, cpu));
+		break;
+	}
+}
+
+/*
+ * Write one record for each system (window "sys_list")
+ */
+static void l_sys_list_put(struct timeval *tv)
+{
+	struct sd_sys *parent, *guest;
+	unsigned int i;
+
+	parent = sd_sys_root_get();
+	sd_sys_iterate(parent, guest) {
+		if (!opts_sys_specified(&win_sys_list, sd_sys_id(guest)))
+			continue;
+		l_rec_start();
+		l_field_time(tv);
+		l_field_str("system", sd_sys_id(guest));
+		for (i = 0; l_sys_item_vec[i]; i++)
+			l_sys_item_put(guest, l_sys_item_vec[i]);
+		l_rec_end();
+	}
+}
+
+/*
+ * Write one record for each CPU of the selected system (window "sys")
+ */
+static void l_sys_put(struct timeval *tv)
+{
+	struct sd_sys *sys;
+	struct sd_cpu *cpu;
+	unsigned int i;
+
+	sys = sd_sys_get(sd_sys_root_get(), win_sys.opts.sys.vec[0]);
+	if (!sys)
+		return;
+	sd_cpu_iterate(sys, cpu) {
+		l_rec_start();
+		l_field_time(tv);
+		l_field_str("system", sd_sys_id(sys));
+		l_field_str("cpuid", sd_cpu_id(cpu));
+		for (i = 0; l_cpu_item_vec[i]; i++)
+			l_cpu_item_put(cpu, l_cpu_item_vec[i]);
+		l_rec_end();
+	}
+}
+
+/*
+ * Write CSV header line
+ */
+static void l_csv_head_put(void)
+{
+	struct table_col *col;
+	unsigned int i;
+
+	l_rec_start();
+	l_head_put("time");
+	l_head_put("system");
+	if (g.o.cur_win == &win_sys) {
+		l_head_put("cpuid");
+		for (i = 0; l_cpu_item_vec[i]; i++) {
+			col = sd_cpu_item_table_col(l_cpu_item_vec[i]);
+			l_head_put(col->head);
+		}
+	} else {
+		for (i = 0; l_sys_item_vec[i]; i++) {
+			col = sd_sys_item_table_col(l_sys_item_vec[i]);
+			l_head_put(col->head);
+		}
+	}
+	l_rec_end();
+}
+
+/*
+ * Is field with "hotkey" selected with the "--fields" option for "win"?
+ */
+static int l_field_selected(struct hyptop_win *win, char hotkey)
+{
+	struct hyptop_col_vec_opt *fields = &win->opts.fields;
+	unsigned int i;
+
+	if (!fields->specified)
+		return 1;
+	for (i = 0; i < fields->cnt; i++) {
+		if (fields->vec[i]->hotkey == hotkey)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Select items for current window
+ */
+static void l_items_init(void)
+{
+	struct sd_sys_item *sys_item;
+	struct sd_cpu_item *cpu_item;
+	unsigned int i, cnt = 0;
+
+	if (g.o.cur_win == &win_sys) {
+		l_cpu_item_vec = ht_zalloc(sizeof(void *) *
+					   (sd_cpu_item_cnt() + 1));
+		sd_cpu_item_iterate(cpu_item, i) {
+			if (l_field_selected(&win_sys,
+					     cpu_item->table_col.hotkey))
+				l_cpu_item_vec[cnt++] = cpu_item;
+		}
+	} else {
+		l_sys_item_vec = ht_zalloc(sizeof(void *) *
+					   (sd_sys_item_cnt() + 1));
+		sd_sys_item_iterate(sys_item, i) {
+			if (l_field_selected(&win_sys_list,
+					     sys_item->table_col.hotkey))
+				l_sys_item_vec[cnt++] = sys_item;
+		}
+	}
+}
+
+/*
+ * Advance "ts" by the update delay
+ */
+static void l_timespec_add_delay(struct timespec *ts)
+{
+	ts->tv_sec += g.o.delay_s;
+	ts->tv_nsec += g.o.delay_us * 1000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+/*
+ * Sleep until "ts" or return at once if "ts" has already passed
+ *
+ * Absolute wakeup times keep the update interval steady independent of
+ * the time needed for gathering and writing the data.
+ */
+static void l_sleep_until(struct timespec *ts)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (ts->tv_sec < now.tv_sec ||
+	    (ts->tv_sec == now.tv_sec && ts->tv_nsec <= now.tv_nsec)) {
+		/* We are late: Do not try to catch up */
+		*ts = now;
+		return;
+	}
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, ts, NULL) ==
+	       EINTR) {}
+}
+
+/*
+ * Write records for each update interval until the iterations are done
+ */
+void stream_run(void)
+{
+	struct timespec next;
+	struct timeval tv;
+
+	l_items_init();
+	if (g.o.output == HYPTOP_OUTPUT_CSV)
+		l_csv_head_put();
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (1) {
+		gettimeofday(&tv, NULL);
+		if (g.o.cur_win == &win_sys)
+			l_sys_put(&tv);
+		else
+			l_sys_list_put(&tv);
+		fflush(stdout);
+		opts_iterations_next();
+		l_timespec_add_delay(&next);
+		l_sleep_until(&next);
+		sd_update();
+	}
+}
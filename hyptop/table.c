@@ -81,6 +81,7 @@ void table_row_mark_del_all(struct table *t)
 		util_list_remove(&t->mark_key_list, key);
 		ht_free(key);
 	}
+	t->row_cnt_marked = 0;
 }
 
 /*
@@ -144,10 +145,13 @@ static int l_row_cnt_displ(struct table *t)
 struct table_row *table_row_alloc(struct table *t)
 {
 	struct table_row *table_row;
+	int i;
 
 	table_row = ht_zalloc(sizeof(*table_row));
 	table_row->entries = ht_zalloc(sizeof(*table_row->entries) *
 					  t->col_cnt);
+	for (i = 0; i < t->col_cnt; i++)
+		table_row->entries[i].changed = 1;
 	return table_row;
 }
 
@@ -169,6 +173,8 @@ struct table *table_new(int extra_rows, int sorted, int first_bold,
 	struct table *t = ht_zalloc(sizeof(*t));
 
 	util_list_init(&t->row_list, struct table_row, list);
+	util_hash_init_str(&t->row_hash, &t->row_list, struct table_row, hash,
+			   key);
 	util_list_init(&t->mark_key_list, struct table_mark_key, list);
 	t->row_cnt_marked = 0;
 	if (with_units)
@@ -257,6 +263,7 @@ void table_row_del_all(struct table *t)
 		util_list_remove(&t->row_list, row);
 		table_row_free(row);
 	}
+	util_hash_exit(&t->row_hash);
 	l_row_last_init(t);
 	t->row_cnt_marked = 0;
 	t->ready = 0;
@@ -376,14 +383,20 @@ static void l_row_last_agg(struct table *t, struct table_row *table_row)
 
 /*
  * Format row: Invoke unit callback and adjust max width of column
+ *
+ * Unless "force" is set, only entries with changed values are formatted.
+ * The max width values only grow, so unchanged entries need no update.
  */
-static void l_row_format(struct table *t, struct table_row *row)
+static void l_row_format(struct table *t, struct table_row *row, int force)
 {
 	unsigned int len, col_nr;
 	struct table_col *col;
 
 	table_col_iterate(t, col, col_nr) {
 		struct table_entry *e = &row->entries[col_nr];
+		if (!force && !e->changed)
+			continue;
+		e->changed = 0;
 		if (col->agg == TABLE_COL_AGG_NONE && row == t->row_last)
 			len = 0;
 		else
@@ -407,7 +420,7 @@ static void l_row_last_calc(struct table *t)
 			continue;
 		l_row_last_agg(t, row);
 	}
-	l_row_format(t, t->row_last);
+	l_row_format(t, t->row_last, 1);
 }
 
 /*
@@ -426,7 +439,7 @@ void table_row_add(struct table *t, struct table_row *row)
 {
 	struct table_row *tmp;
 
-	l_row_format(t, row);
+	l_row_format(t, row, 1);
 
 	if (util_list_is_empty(&t->row_list) || !t->attr_sorted_table) {
 		util_list_add_tail(&t->row_list, row);
@@ -459,8 +472,8 @@ void table_rebuild(struct table *t)
 	table_col_iterate(t, col, i)
 		l_col_max_width_init(t, col);
 	util_list_iterate(&t->row_list, row)
-		l_row_format(t, row);
-	l_row_format(t, t->row_last);
+		l_row_format(t, row, 1);
+	l_row_format(t, t->row_last, 1);
 }
 
 /*
@@ -479,6 +492,115 @@ static void l_table_sort(struct table *t)
 	util_list_sort(&t->row_list, l_row_cmp_fn, t);
 }
 
+/*
+ * Start update cycle for rows that are retained with table_row_get()
+ */
+void table_update_start(struct table *t)
+{
+	t->gen++;
+	t->ready = 0;
+}
+
+/*
+ * Get row by key for update cycle or add a new row
+ *
+ * The caller has to set all entries of the row again. Entries that are not
+ * set until table_update_finish() are reset.
+ */
+struct table_row *table_row_get(struct table *t, const char *key)
+{
+	struct table_row *row;
+	int i;
+
+	row = util_hash_find_str(&t->row_hash, key);
+	if (row) {
+		for (i = 0; i < t->col_cnt; i++)
+			row->entries[i].updated = 0;
+	} else {
+		row = table_row_alloc(t);
+		util_strlcpy(row->key, key, sizeof(row->key));
+		row->is_new = 1;
+		util_hash_add_tail(&t->row_hash, row);
+	}
+	row->gen = t->gen;
+	return row;
+}
+
+/*
+ * Merge sorted rows of list "add" into the sorted row list
+ */
+static void l_row_list_merge(struct table *t, struct util_list *add)
+{
+	struct table_row *row, *tmp, *pos;
+
+	pos = util_list_start(&t->row_list);
+	util_list_iterate_safe(add, row, tmp) {
+		util_list_remove(add, row);
+		while (pos && !l_row_less_than(t, pos, row))
+			pos = util_list_next(&t->row_list, pos);
+		if (pos)
+			util_list_add_prev(&t->row_list, row, pos);
+		else
+			util_list_add_tail(&t->row_list, row);
+	}
+}
+
+/*
+ * Finish update cycle: Remove rows that have not been updated, format
+ * changed entries, and sort table
+ *
+ * Rows whose sort value did not change keep their order. Only new rows and
+ * rows with a changed sort value are sorted and merged into the table.
+ */
+void table_update_finish(struct table *t)
+{
+	struct table_row *row, *tmp;
+	struct util_list resort;
+	struct table_entry *e;
+	int col_nr;
+
+	util_list_init(&resort, struct table_row, list);
+	util_list_iterate_safe(&t->row_list, row, tmp) {
+		if (row->gen != t->gen) {
+			if (row->marked)
+				t->row_cnt_marked--;
+			util_hash_remove(&t->row_hash, row);
+			table_row_free(row);
+			t->row_cnt--;
+			continue;
+		}
+		for (col_nr = 0; col_nr < t->col_cnt; col_nr++) {
+			e = &row->entries[col_nr];
+			if (e->set && !e->updated) {
+				/* Reset to the state of a new entry */
+				memset(&e->d, 0, sizeof(e->d));
+				e->str[0] = 0;
+				e->set = 0;
+				e->changed = 1;
+			}
+		}
+		if (row->is_new && l_row_is_marked(t, row)) {
+			row->marked = 1;
+			t->row_cnt_marked++;
+		}
+		if (row->is_new)
+			t->row_cnt++;
+		if (t->attr_sorted_table &&
+		    (row->is_new ||
+		     row->entries[t->col_selected->p->col_nr].changed)) {
+			util_list_remove(&t->row_list, row);
+			util_list_add_tail(&resort, row);
+		}
+		row->is_new = 0;
+		l_row_format(t, row, 0);
+	}
+	if (!util_list_is_empty(&resort)) {
+		util_list_sort(&resort, l_row_cmp_fn, t);
+		l_row_list_merge(t, &resort);
+	}
+	table_finish(t);
+}
+
 /*
  * Adjust table values for select mode (e.g. for window resize or scrolling)
  */
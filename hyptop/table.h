@@ -15,6 +15,7 @@
 #include <assert.h>
 #include <string.h>
 
+#include "lib/util_hash.h"
 #include "lib/util_list.h"
 #include "helper.h"
 
@@ -289,6 +290,8 @@ struct table_entry {
 		} s64;
 	} d;
 	int			set;
+	int			changed;	/* Value changed: Format again */
+	int			updated;	/* Value set in update cycle */
 	char			str[TABLE_STR_MAX];
 };
 
@@ -297,8 +300,12 @@ struct table_entry {
  */
 struct table_row {
 	struct util_list_node	list;
+	struct util_hash_node	hash;
 	struct table_entry	*entries;
 	int			marked;
+	int			is_new;
+	unsigned int		gen;
+	char			key[TABLE_STR_MAX];
 };
 
 /*
@@ -314,6 +321,8 @@ struct table_mark_key {
  */
 struct table {
 	struct util_list	row_list;
+	struct util_hash	row_hash;
+	unsigned int		gen;
 	int 			col_cnt;
 	struct table_col	**col_vec;
 	struct table_col	*col_selected;
@@ -358,6 +367,8 @@ extern struct table *table_new(int extra_rows, int sorted, int first_bold,
 extern void table_reset(struct table *t);
 extern void table_rebuild(struct table *t);
 extern void table_finish(struct table *t);
+extern void table_update_start(struct table *t);
+extern void table_update_finish(struct table *t);
 extern void table_print(struct table *t);
 extern void table_process_input(struct table *t, int c);
 
@@ -380,45 +391,72 @@ extern void table_row_select_down(struct table *t, enum table_scroll_unit unit);
 extern void table_row_select_up(struct table *t, enum table_scroll_unit unit);
 extern void table_row_select_key_get(struct table *t, char str[TABLE_STR_MAX]);
 extern struct table_row *table_row_alloc(struct table *t);
+extern struct table_row *table_row_get(struct table *t, const char *key);
 
 extern void table_scroll_down(struct table *t, enum table_scroll_unit unit);
 extern void table_scroll_up(struct table *t, enum table_scroll_unit unit);
 
 /*
  * Entry add functions
+ *
+ * Entries with changed values are marked for formatting.
  */
 static inline void table_row_entry_u64_add(struct table_row *table_row,
 					   struct table_col *table_col,
 					   u64 value)
 {
-	table_row->entries[table_col->p->col_nr].d.u64.v1 = value;
-	table_row->entries[table_col->p->col_nr].set = 1;
+	struct table_entry *e = &table_row->entries[table_col->p->col_nr];
+
+	if (!e->set || e->d.u64.v1 != value) {
+		e->d.u64.v1 = value;
+		e->changed = 1;
+	}
+	e->set = 1;
+	e->updated = 1;
 }
 
 static inline void table_row_entry_s64_add(struct table_row *table_row,
 					   struct table_col *table_col,
 					   s64 value)
 {
-	table_row->entries[table_col->p->col_nr].d.s64.v1 = value;
-	table_row->entries[table_col->p->col_nr].set = 1;
+	struct table_entry *e = &table_row->entries[table_col->p->col_nr];
+
+	if (!e->set || e->d.s64.v1 != value) {
+		e->d.s64.v1 = value;
+		e->changed = 1;
+	}
+	e->set = 1;
+	e->updated = 1;
 }
 
 static inline void table_row_entry_u64_add_pair(struct table_row *table_row,
 						struct table_col *table_col,
 						u64 value1, u64 value2)
 {
-	table_row->entries[table_col->p->col_nr].d.u64.v1 = value1;
-	table_row->entries[table_col->p->col_nr].d.u64.v2 = value2;
-	table_row->entries[table_col->p->col_nr].set = 1;
+	struct table_entry *e = &table_row->entries[table_col->p->col_nr];
+
+	if (!e->set || e->d.u64.v1 != value1 || e->d.u64.v2 != value2) {
+		e->d.u64.v1 = value1;
+		e->d.u64.v2 = value2;
+		e->changed = 1;
+	}
+	e->set = 1;
+	e->updated = 1;
 }
 
 static inline void table_row_entry_str_add(struct table_row *table_row,
 					   struct table_col *table_col,
 					   const char *str)
 {
+	struct table_entry *e = &table_row->entries[table_col->p->col_nr];
+
 	assert(strlen(str) < TABLE_STR_MAX);
-	strcpy(table_row->entries[table_col->p->col_nr].str, str);
-	table_row->entries[table_col->p->col_nr].set = 1;
+	if (!e->set || strcmp(e->str, str) != 0) {
+		strcpy(e->str, str);
+		e->changed = 1;
+	}
+	e->set = 1;
+	e->updated = 1;
 }
 
 /*
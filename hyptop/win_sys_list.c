@@ -171,7 +171,7 @@ static void l_sys_add(struct sd_sys *sys)
 	struct sd_sys_item *item;
 	unsigned int i;
 
-	table_row = table_row_alloc(l_t);
+	table_row = table_row_get(l_t, sd_sys_id(sys));
 	table_row_entry_str_add(table_row, &l_col_sys, sd_sys_id(sys));
 
 	sd_sys_item_iterate(item, i) {
@@ -179,24 +179,25 @@ static void l_sys_add(struct sd_sys *sys)
 			continue;
 		l_sys_item_add(table_row, sys, item);
 	}
-	table_row_add(l_t, table_row);
 }
 
 /*
  * Fill system data into table
+ *
+ * Rows are kept between updates and only changed entries are formatted.
  */
 static void l_table_create(void)
 {
 	struct sd_sys *parent, *guest;
 
-	table_row_del_all(l_t);
+	table_update_start(l_t);
 	parent = sd_sys_root_get();
 	sd_sys_iterate(parent, guest) {
 		if (!opts_sys_specified(&win_sys_list, sd_sys_id(guest)))
 			continue;
 		l_sys_add(guest);
 	}
-	table_finish(l_t);
+	table_update_finish(l_t);
 }
 
 /*
@@ -184,6 +184,15 @@
  */
 #define MAXVOLUMESPERDS 59
 
+/**
+ * @brief The maximum number of track frames that can be read ahead.
+ *
+ * Each read-ahead track frame needs a raw track buffer for every read
+ * position of a dshandle, so the number is limited to keep the memory
+ * that is allocated per dshandle reasonable.
+ */
+#define MAXREADAHEAD 64
+
 /**
  * @brief Eight bytes of 0xFF are used in several cases to designate the end of data.
  *
@@ -395,6 +404,9 @@ struct dasd {
 	struct raw_vtoc *rawvtoc;
 	/** @brief The volume label that has been read from this device */
 	volume_label_t *vlabel;
+	/** @brief Data sets extracted from the VTOC that have not yet been
+	 *  merged into the zdsroot */
+	struct util_list *dslist;
 	/** @brief Detailed error messages in case of a problem */
 	struct errorlog *log;
 };
@@ -734,6 +746,17 @@ void lzds_dataset_get_name(struct dataset *ds, char **name);
  */
 void lzds_dataset_get_format1_dscb(struct dataset *ds, format1_label_t **f1);
 
+/**
+ * @brief Read the directory of a partitioned data set, if this has not
+ *        been done yet.
+ */
+int lzds_dataset_read_members(struct dataset *ds);
+
+/**
+ * @brief Get the errorlog.
+ */
+void lzds_dataset_get_errorlog(struct dataset *ds, struct errorlog **log);
+
 /**
  * @brief Search the data set for a given member name and if a matching
  *        member is found return a struct pdsmember.
@@ -816,6 +839,13 @@ int lzds_dshandle_read(struct dshandle *dsh, char *buf,
 int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
 			long long *rcoffset);
 
+/**
+ * @brief Read data from the data set at the given offset. Several threads
+ *        may use this function with the same dsh at the same time.
+ */
+int lzds_dshandle_pread(struct dshandle *dsh, char *buf, size_t size,
+			long long offset, ssize_t *rcsize);
+
 /**
  * @brief Get the current buffer position.
  */
@@ -832,6 +862,21 @@ void lzds_dshandle_get_errorlog(struct dshandle *dsh, struct errorlog **log);
 int lzds_dshandle_set_seekbuffer(struct dshandle *dsh,
 				 unsigned long long seek_buffer_size);
 
+/**
+ * @brief Load the seek buffer from a persistent seek index in a directory.
+ */
+int lzds_dshandle_load_seekbuffer(struct dshandle *dsh, const char *dir);
+
+/**
+ * @brief Store the seek buffer as persistent seek index in a directory.
+ */
+int lzds_dshandle_save_seekbuffer(struct dshandle *dsh, const char *dir);
+
+/**
+ * @brief Set the number of track frames that are read ahead asynchronously.
+ */
+int lzds_dshandle_set_readahead(struct dshandle *dsh, unsigned int readahead);
+
 /**
  * @brief Get the size of the data set in number of tracks (sum of all extents).
  */
@@ -851,6 +896,20 @@ void lzds_pdsmember_get_name(struct pdsmember *member, char **name);
 int lzds_zdsroot_extract_datasets_from_dasd(struct zdsroot *root,
 					    struct dasd *dasd);
 
+/**
+ * @brief Extract the data set information from the rawvtoc stored in the
+ *        dasd and keep it in the dasd. May be called concurrently for
+ *        different dasds.
+ */
+int lzds_dasd_extract_datasets(struct dasd *dasd);
+
+/**
+ * @brief Add the data sets previously extracted from the dasd to the list
+ *        of data sets stored in the zdsroot.
+ */
+int lzds_zdsroot_merge_datasets_from_dasd(struct zdsroot *root,
+					  struct dasd *dasd);
+
 
 void lzds_dslist_free(struct zdsroot *root);
 
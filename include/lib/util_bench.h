@@ -0,0 +1,31 @@
+/*
+ * util - Utility function library
+ *
+ * Helper functions for example and benchmark programs
+ *
+ * The functions are not part of libutil, they are only used by programs
+ * that measure the performance of s390-tools code.
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIB_UTIL_BENCH_H
+#define LIB_UTIL_BENCH_H
+
+#include <time.h>
+
+/*
+ * Return monotonic time in seconds for measuring durations
+ */
+static inline double util_bench_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#endif /* LIB_UTIL_BENCH_H */
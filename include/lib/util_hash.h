@@ -0,0 +1,53 @@
+/*
+ * util - Utility function library
+ *
+ * Hash index for linked lists
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIB_UTIL_HASH_H
+#define LIB_UTIL_HASH_H
+
+#include <stddef.h>
+
+#include "lib/util_list.h"
+
+enum util_hash_key {
+	UTIL_HASH_KEY_STR,		/* Key is a char array in the entry */
+	UTIL_HASH_KEY_ULONG,		/* Key is an unsigned long */
+};
+
+struct util_hash {
+	struct util_list *list;		/* List that holds the entries */
+	unsigned long offset;		/* Offset of struct util_hash_node */
+	unsigned long key_offset;	/* Offset of the key */
+	enum util_hash_key key_type;	/* Type of the key */
+	struct util_hash_node **table;	/* Hash buckets */
+	unsigned long size;		/* Number of buckets (power of 2) */
+	unsigned long cnt;		/* Number of entries */
+};
+
+struct util_hash_node {
+	struct util_hash_node *next;
+};
+
+#define util_hash_init_str(hash, list, type, member, key)		\
+	util_hash_init_offset(hash, list, offsetof(type, member),	\
+			      offsetof(type, key), UTIL_HASH_KEY_STR)
+#define util_hash_init_ulong(hash, list, type, member, key)		\
+	util_hash_init_offset(hash, list, offsetof(type, member),	\
+			      offsetof(type, key), UTIL_HASH_KEY_ULONG)
+void util_hash_init_offset(struct util_hash *hash, struct util_list *list,
+			   unsigned long offset, unsigned long key_offset,
+			   enum util_hash_key key_type);
+void util_hash_exit(struct util_hash *hash);
+void util_hash_add_tail(struct util_hash *hash, void *entry);
+void util_hash_remove(struct util_hash *hash, void *entry);
+void *util_hash_find_str(struct util_hash *hash, const char *key);
+void *util_hash_find_ulong(struct util_hash *hash, unsigned long key);
+
+#endif /* LIB_UTIL_HASH_H */
@@ -0,0 +1,34 @@
+/**
+ * @defgroup util_iconv_h util_iconv: Code page conversion interface
+ * @{
+ * @brief Convert text between code pages
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIB_UTIL_ICONV_H
+#define LIB_UTIL_ICONV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct util_iconv;
+
+struct util_iconv *util_iconv_open(const char *to, const char *from);
+size_t util_iconv_conv(struct util_iconv *cd, char **inbuf, size_t *inleft,
+		       char **outbuf, size_t *outleft);
+bool util_iconv_stateless(struct util_iconv *cd);
+void util_iconv_close(struct util_iconv *cd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /** LIB_UTIL_ICONV_H @} */
@@ -51,6 +51,8 @@ unsigned long util_list_len(struct util_list *list);
  */
 typedef int (*util_list_cmp_fn)(void *a, void *b, void *data);
 void util_list_sort(struct util_list *list, util_list_cmp_fn fn, void *data);
+void util_list_add_sorted(struct util_list *list, void *entry,
+			  util_list_cmp_fn fn, void *data);
 
 #define util_list_iterate(list, i)		\
 	for (i = util_list_start(list);		\
@@ -0,0 +1,213 @@
+/*
+ * util - Utility function library
+ *
+ * Hash index for linked lists
+ *
+ * A hash index is attached to a util_list and finds list entries by a key
+ * that is stored in the entry. The list keeps the insertion order for
+ * iteration with util_list_iterate(). Entries must be added and removed
+ * with the util_hash functions to keep the list and the index in sync.
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/util_hash.h"
+#include "lib/util_libc.h"
+
+#define HASH_SIZE_MIN	16
+
+/*
+ * Node to entry
+ */
+static inline void *n2e(struct util_hash *hash, struct util_hash_node *node)
+{
+	return ((void *) node) - hash->offset;
+}
+
+/*
+ * Entry to node
+ */
+static inline struct util_hash_node *e2n(struct util_hash *hash, void *entry)
+{
+	return entry + hash->offset;
+}
+
+/*
+ * Entry to key
+ */
+static inline void *e2k(struct util_hash *hash, void *entry)
+{
+	return entry + hash->key_offset;
+}
+
+/*
+ * Calculate hash value of string (FNV-1a)
+ */
+static unsigned long hash_str(const char *str)
+{
+	unsigned long val = 2166136261UL;
+
+	while (*str) {
+		val ^= (unsigned char) *str++;
+		val *= 16777619UL;
+	}
+	return val;
+}
+
+/*
+ * Calculate hash value of integer (multiplicative hashing)
+ */
+static unsigned long hash_ulong(unsigned long key)
+{
+	unsigned long long val = key * 0x9e3779b97f4a7c15ULL;
+
+	return val ^ (val >> 32);
+}
+
+/*
+ * Get bucket for entry
+ */
+static unsigned long entry_bucket(struct util_hash *hash, void *entry)
+{
+	unsigned long val;
+
+	if (hash->key_type == UTIL_HASH_KEY_STR)
+		val = hash_str(e2k(hash, entry));
+	else
+		val = hash_ulong(*(unsigned long *) e2k(hash, entry));
+	return val & (hash->size - 1);
+}
+
+/*
+ * Double the number of hash buckets
+ */
+static void hash_grow(struct util_hash *hash)
+{
+	struct util_hash_node **old_table = hash->table, *node, *next;
+	unsigned long old_size = hash->size, i, bucket;
+
+	hash->size = old_size ? old_size * 2 : HASH_SIZE_MIN;
+	hash->table = util_zalloc(hash->size * sizeof(hash->table[0]));
+	for (i = 0; i < old_size; i++) {
+		for (node = old_table[i]; node; node = next) {
+			next = node->next;
+			bucket = entry_bucket(hash, n2e(hash, node));
+			node->next = hash->table[bucket];
+			hash->table[bucket] = node;
+		}
+	}
+	free(old_table);
+}
+
+/*
+ * Initialize hash index for list
+ *
+ * The list must be initialized and empty.
+ */
+void util_hash_init_offset(struct util_hash *hash, struct util_list *list,
+			   unsigned long offset, unsigned long key_offset,
+			   enum util_hash_key key_type)
+{
+	memset(hash, 0, sizeof(*hash));
+	hash->list = list;
+	hash->offset = offset;
+	hash->key_offset = key_offset;
+	hash->key_type = key_type;
+}
+
+/*
+ * Free hash index
+ *
+ * The list and its entries are not freed.
+ */
+void util_hash_exit(struct util_hash *hash)
+{
+	free(hash->table);
+	hash->table = NULL;
+	hash->size = 0;
+	hash->cnt = 0;
+}
+
+/*
+ * Add new element to end of list and to hash index
+ */
+void util_hash_add_tail(struct util_hash *hash, void *entry)
+{
+	struct util_hash_node *node = e2n(hash, entry);
+	unsigned long bucket;
+
+	if (hash->cnt >= hash->size)
+		hash_grow(hash);
+	bucket = entry_bucket(hash, entry);
+	node->next = hash->table[bucket];
+	hash->table[bucket] = node;
+	hash->cnt++;
+	util_list_add_tail(hash->list, entry);
+}
+
+/*
+ * Remove element from list and from hash index
+ */
+void util_hash_remove(struct util_hash *hash, void *entry)
+{
+	struct util_hash_node *node = e2n(hash, entry), **ptr;
+
+	if (!hash->table) {
+		/* Entry has been added to the list but not to the index */
+		util_list_remove(hash->list, entry);
+		return;
+	}
+	ptr = &hash->table[entry_bucket(hash, entry)];
+	for (; *ptr; ptr = &(*ptr)->next) {
+		if (*ptr == node) {
+			*ptr = node->next;
+			hash->cnt--;
+			break;
+		}
+	}
+	util_list_remove(hash->list, entry);
+}
+
+/*
+ * Find element with string key
+ */
+void *util_hash_find_str(struct util_hash *hash, const char *key)
+{
+	struct util_hash_node *node;
+	void *entry;
+
+	if (!hash->cnt)
+		return NULL;
+	node = hash->table[hash_str(key) & (hash->size - 1)];
+	for (; node; node = node->next) {
+		entry = n2e(hash, node);
+		if (strcmp(e2k(hash, entry), key) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+/*
+ * Find element with integer key
+ */
+void *util_hash_find_ulong(struct util_hash *hash, unsigned long key)
+{
+	struct util_hash_node *node;
+	void *entry;
+
+	if (!hash->cnt)
+		return NULL;
+	node = hash->table[hash_ulong(key) & (hash->size - 1)];
+	for (; node; node = node->next) {
+		entry = n2e(hash, node);
+		if (*(unsigned long *) e2k(hash, entry) == key)
+			return entry;
+	}
+	return NULL;
+}
@@ -0,0 +1,87 @@
+/**
+ * util_hash_example - Example program for util_hash
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+//! [code]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/util_base.h"
+#include "lib/util_hash.h"
+#include "lib/util_list.h"
+
+/*
+ * List entry that is found by its name
+ */
+struct device {
+	struct util_list_node	node;		/* List node */
+	struct util_hash_node	hash_node;	/* Hash index node */
+	char			name[16];	/* Key */
+	unsigned long		nr;
+};
+
+static const char * const name_vec[] = {"dasda", "dasdb", "dasdc", "dasdd"};
+
+/*
+ * Print all devices in list order
+ */
+static void print_devices(struct util_list *list)
+{
+	struct device *dev;
+
+	util_list_iterate(list, dev)
+		printf("  %-8s 0x%lx\n", dev->name, dev->nr);
+}
+
+/*
+ * Create a list with a hash index, find entries, and remove an entry
+ */
+int main(void)
+{
+	struct device *dev, *next;
+	struct util_hash hash;
+	struct util_list list;
+	unsigned long i;
+
+	/* The hash index is attached to an initialized and empty list */
+	util_list_init(&list, struct device, node);
+	util_hash_init_str(&hash, &list, struct device, hash_node, name);
+
+	/* Add entries to the end of the list and to the hash index */
+	for (i = 0; i < UTIL_ARRAY_SIZE(name_vec); i++) {
+		dev = calloc(1, sizeof(*dev));
+		strcpy(dev->name, name_vec[i]);
+		dev->nr = 0x5000 + i;
+		util_hash_add_tail(&hash, dev);
+	}
+	printf("Devices:\n");
+	print_devices(&list);
+
+	/* Find entries by key */
+	dev = util_hash_find_str(&hash, "dasdc");
+	printf("Find \"dasdc\": %s\n", dev ? dev->name : "not found");
+	dev = util_hash_find_str(&hash, "dasdz");
+	printf("Find \"dasdz\": %s\n", dev ? dev->name : "not found");
+
+	/* Remove entry from the list and from the hash index */
+	dev = util_hash_find_str(&hash, "dasdb");
+	util_hash_remove(&hash, dev);
+	free(dev);
+	printf("Devices after removing \"dasdb\":\n");
+	print_devices(&list);
+
+	/* Free the hash index and then the list entries */
+	util_hash_exit(&hash);
+	util_list_iterate_safe(&list, dev, next) {
+		util_list_remove(&list, dev);
+		free(dev);
+	}
+	return EXIT_SUCCESS;
+}
+//! [code]
@@ -0,0 +1,181 @@
+/*
+ * util - Utility function library
+ *
+ * Convert text between code pages
+ *
+ * Conversions between single-byte code pages, for example between EBCDIC
+ * and ASCII code pages, are done with a 256 byte translation table that is
+ * built with iconv(3) when the converter is opened. This avoids one library
+ * call per record. All other conversions are passed to iconv(3).
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <errno.h>
+#include <iconv.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/util_base.h"
+#include "lib/util_iconv.h"
+#include "lib/util_libc.h"
+
+struct util_iconv {
+	iconv_t cd;
+	bool table_valid;
+	unsigned char table[256];
+};
+
+/*
+ * Check if each byte is converted into exactly one byte without a shift
+ * state and fill the translation table.
+ */
+static bool build_table(struct util_iconv *conv)
+{
+	char *in_ptr, *out_ptr, in, out;
+	size_t in_count, out_count;
+	bool rc = true;
+	int c;
+
+	for (c = 0; c < 256; c++) {
+		in = c;
+		in_ptr = &in;
+		out_ptr = &out;
+		in_count = out_count = 1;
+		if (iconv(conv->cd, &in_ptr, &in_count,
+			  &out_ptr, &out_count) == (size_t) -1 ||
+		    in_count || out_count) {
+			rc = false;
+			break;
+		}
+		/* Stateful encodings would need to write a shift sequence */
+		if (iconv(conv->cd, NULL, NULL, &out_ptr, &out_count) ==
+		    (size_t) -1) {
+			rc = false;
+			break;
+		}
+		conv->table[c] = out;
+	}
+	iconv(conv->cd, NULL, NULL, NULL, NULL);
+	return rc;
+}
+
+/*
+ * Translate len bytes from in to out with the translation table
+ */
+static void translate(struct util_iconv *conv, unsigned char *out,
+		      const unsigned char *in, size_t len)
+{
+	const unsigned char *table = conv->table;
+
+#ifdef __s390x__
+	/* Translate 256 byte blocks in place with the TR instruction */
+	while (len >= 256) {
+		if (out != in)
+			memcpy(out, in, 256);
+		asm volatile("tr 0(256,%[buf]),0(%[tbl])"
+			     :
+			     : [buf] "a" (out), [tbl] "a" (table)
+			     : "memory");
+		in += 256;
+		out += 256;
+		len -= 256;
+	}
+#endif
+	while (len--)
+		*out++ = table[*in++];
+}
+
+/**
+ * Open a converter for text in code page "from" to code page "to"
+ *
+ * @param[in] to    Name of the target code page as for iconv_open(3)
+ * @param[in] from  Name of the source code page as for iconv_open(3)
+ *
+ * @returns   Pointer to converter or NULL with errno set on failure
+ */
+struct util_iconv *util_iconv_open(const char *to, const char *from)
+{
+	struct util_iconv *conv;
+
+	conv = util_zalloc(sizeof(*conv));
+	conv->cd = iconv_open(to, from);
+	if (conv->cd == (iconv_t) -1) {
+		free(conv);
+		return NULL;
+	}
+	conv->table_valid = build_table(conv);
+	return conv;
+}
+
+/**
+ * Convert text with the semantics of iconv(3)
+ *
+ * For single-byte code page pairs the input and output buffers may be
+ * identical to convert text in place.
+ *
+ * @param[in]     cd       Converter
+ * @param[in,out] inbuf    Start of input, advanced by the bytes converted
+ * @param[in,out] inleft   Number of input bytes left
+ * @param[in,out] outbuf   Start of output, advanced by the bytes written
+ * @param[in,out] outleft  Number of free output bytes left
+ *
+ * @returns   Number of non-reversible conversions or (size_t) -1 with
+ *            errno set on failure
+ */
+size_t util_iconv_conv(struct util_iconv *cd, char **inbuf, size_t *inleft,
+		       char **outbuf, size_t *outleft)
+{
+	size_t len;
+
+	if (!cd->table_valid)
+		return iconv(cd->cd, inbuf, inleft, outbuf, outleft);
+	/* Reset of the shift state */
+	if (inbuf == NULL || *inbuf == NULL)
+		return 0;
+
+	len = MIN(*inleft, *outleft);
+	translate(cd, (unsigned char *) *outbuf, (unsigned char *) *inbuf,
+		  len);
+	*inbuf += len;
+	*inleft -= len;
+	*outbuf += len;
+	*outleft -= len;
+	if (*inleft) {
+		errno = E2BIG;
+		return (size_t) -1;
+	}
+	return 0;
+}
+
+/**
+ * Check if a converter uses a translation table
+ *
+ * Conversions with such a converter do not modify it and can be done
+ * concurrently by multiple threads.
+ *
+ * @param[in] cd  Converter
+ *
+ * @returns   true if a translation table is used, false otherwise
+ */
+bool util_iconv_stateless(struct util_iconv *cd)
+{
+	return cd->table_valid;
+}
+
+/**
+ * Close a converter and free all resources
+ *
+ * @param[in] cd  Converter
+ */
+void util_iconv_close(struct util_iconv *cd)
+{
+	if (!cd)
+		return;
+	iconv_close(cd->cd);
+	free(cd);
+}
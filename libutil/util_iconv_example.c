@@ -0,0 +1,124 @@
+/**
+ * util_iconv_example - Example program for util_iconv
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+//! [code]
+#include <iconv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lib/util_iconv.h"
+
+#define BUF_SIZE	(64 * 1024 * 1024)
+#define REC_LEN		80
+
+/*
+ * Return seconds since an arbitrary point in time
+ */
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Convert a buffer record by record with iconv(3) and util_iconv and
+ * print the throughput of both
+ */
+static void benchmark(const char *to, const char *from)
+{
+	char *in, *out, *in_ptr, *out_ptr;
+	size_t in_left, out_left, i;
+	struct util_iconv *conv;
+	double start, t_iconv, t_util;
+	iconv_t cd;
+
+	in = malloc(BUF_SIZE);
+	out = malloc(BUF_SIZE);
+	conv = util_iconv_open(to, from);
+	cd = iconv_open(to, from);
+	if (!in || !out || !conv || cd == (iconv_t) -1) {
+		perror("Setup failed");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < BUF_SIZE; i++)
+		in[i] = 0x40 + i % 0x40;
+
+	start = now();
+	for (i = 0; i < BUF_SIZE; i += REC_LEN) {
+		in_ptr = in + i;
+		out_ptr = out + i;
+		in_left = out_left = REC_LEN;
+		iconv(cd, &in_ptr, &in_left, &out_ptr, &out_left);
+	}
+	t_iconv = now() - start;
+
+	start = now();
+	for (i = 0; i < BUF_SIZE; i += REC_LEN) {
+		in_ptr = in + i;
+		out_ptr = out + i;
+		in_left = out_left = REC_LEN;
+		util_iconv_conv(conv, &in_ptr, &in_left, &out_ptr, &out_left);
+	}
+	t_util = now() - start;
+
+	printf("%s -> %s (%s):\n", from, to,
+	       util_iconv_stateless(conv) ? "table" : "iconv");
+	printf("  iconv:      %8.1f MB/s\n", BUF_SIZE / t_iconv / 1e6);
+	printf("  util_iconv: %8.1f MB/s\n", BUF_SIZE / t_util / 1e6);
+
+	iconv_close(cd);
+	util_iconv_close(conv);
+	free(out);
+	free(in);
+}
+
+/*
+ * Convert a string to EBCDIC and back and compare throughput
+ */
+int main(void)
+{
+	char str[] = "Hello world!", *in_ptr, *out_ptr;
+	size_t in_left, out_left, len = strlen(str);
+	struct util_iconv *conv;
+	unsigned int i;
+
+	/* Convert in place to EBCDIC */
+	conv = util_iconv_open("CP1047", "ISO-8859-1");
+	if (!conv) {
+		perror("util_iconv_open failed");
+		return EXIT_FAILURE;
+	}
+	in_ptr = out_ptr = str;
+	in_left = out_left = len;
+	util_iconv_conv(conv, &in_ptr, &in_left, &out_ptr, &out_left);
+	util_iconv_close(conv);
+
+	printf("EBCDIC:");
+	for (i = 0; i < len; i++)
+		printf(" %02x", (unsigned char) str[i]);
+	printf("\n");
+
+	/* Convert back to ASCII */
+	conv = util_iconv_open("ISO-8859-1", "CP1047");
+	in_ptr = out_ptr = str;
+	in_left = out_left = len;
+	util_iconv_conv(conv, &in_ptr, &in_left, &out_ptr, &out_left);
+	util_iconv_close(conv);
+	printf("ASCII:  %s\n\n", str);
+
+	benchmark("ISO-8859-1", "CP1047");
+	benchmark("CP1047", "ISO-8859-1");
+	benchmark("UTF-8", "CP1047");
+	return EXIT_SUCCESS;
+}
+//! [code]
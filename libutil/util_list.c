@@ -213,41 +213,90 @@ unsigned long util_list_len(struct util_list *list)
 }
 
 /*
- * Sort table (bubble sort)
+ * Merge the sorted lists a and b that are linked via the next pointers
+ *
+ * For equal elements, the element from list a comes first.
+ */
+static struct util_list_node *merge(struct util_list *list,
+				    struct util_list_node *a,
+				    struct util_list_node *b,
+				    util_list_cmp_fn cmp_fn, void *data)
+{
+	struct util_list_node *head = NULL, **tail = &head;
+
+	while (a && b) {
+		if (cmp_fn(n2e(list, a), n2e(list, b), data) <= 0) {
+			*tail = a;
+			a = a->next;
+		} else {
+			*tail = b;
+			b = b->next;
+		}
+		tail = &(*tail)->next;
+	}
+	*tail = a ? a : b;
+	return head;
+}
+
+/*
+ * Sort table (stable bottom-up merge sort)
+ *
+ * Element i of "bin" is either empty or holds a sorted list with 2^i
+ * elements. Each element is merged into the bins like adding one to a
+ * binary counter. Lower bins always hold later elements of the list, so
+ * equal elements keep their order.
  */
 void util_list_sort(struct util_list *list, util_list_cmp_fn cmp_fn,
 		    void *data)
 {
-	struct util_list_node *node1, *node2;
-	unsigned long list_cnt, i, j;
-	void *entry1, *entry2;
-
-	list_cnt = util_list_len(list);
-
-	for (i = 1; i < list_cnt; i++) {
-		node1 = list->start;
-		for (j = 0; j < list_cnt - i; j++) {
-			node2 = node1->next;
-			entry1 = n2e(list, node1);
-			entry2 = n2e(list, node2);
-			if (cmp_fn(entry1, entry2, data) > 0) {
-				node1->next = node2->next;
-				if (node1->next)
-					node1->next->prev = node1;
-				else
-					list->end = node1;
-				node2->next = node1;
-				node2->prev = node1->prev;
-				if (node2->prev)
-					node2->prev->next = node2;
-				else
-					list->start = node2;
-				node1->prev = node2;
-			} else {
-				node1 = node2;
-			}
+	struct util_list_node *bin[64] = {}, *node, *next, *run, *prev;
+	unsigned int i, max = 0;
+
+	for (node = list->start; node; node = next) {
+		next = node->next;
+		node->next = NULL;
+		run = node;
+		for (i = 0; bin[i]; i++) {
+			run = merge(list, bin[i], run, cmp_fn, data);
+			bin[i] = NULL;
 		}
+		bin[i] = run;
+		if (i > max)
+			max = i;
 	}
+	run = NULL;
+	for (i = 0; i <= max; i++) {
+		if (bin[i])
+			run = merge(list, bin[i], run, cmp_fn, data);
+	}
+
+	/* Restore the prev pointers */
+	list->start = run;
+	prev = NULL;
+	for (node = run; node; node = node->next) {
+		node->prev = prev;
+		prev = node;
+	}
+	list->end = prev;
+}
+
+/*
+ * Add new element to sorted list
+ *
+ * The element is added behind all elements that are not greater. The list
+ * is searched from the end, so adding elements in ascending order is fast.
+ */
+void util_list_add_sorted(struct util_list *list, void *entry,
+			  util_list_cmp_fn cmp_fn, void *data)
+{
+	void *list_entry = util_list_end(list);
+
+	while (list_entry && cmp_fn(list_entry, entry, data) > 0)
+		list_entry = util_list_prev(list, list_entry);
+	if (list_entry)
+		util_list_add_next(list, entry, list_entry);
+	else
+		util_list_add_head(list, entry);
 }
 
 /*
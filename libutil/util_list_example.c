@@ -0,0 +1,172 @@
+/**
+ * util_list_example - Example program for util_list
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+//! [code]
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lib/util_bench.h"
+#include "lib/util_list.h"
+#include "lib/zt_common.h"
+
+/* Largest list for which the quadratic algorithms are measured */
+#define SLOW_MAX	20000
+
+struct entry {
+	struct util_list_node	node;
+	unsigned long		key;
+	unsigned long		seq;	/* Original position in list */
+};
+
+/*
+ * Compare two entries by key
+ */
+static int cmp_key(void *a, void *b, void *UNUSED(data))
+{
+	struct entry *e1 = a, *e2 = b;
+
+	if (e1->key < e2->key)
+		return -1;
+	return e1->key > e2->key;
+}
+
+/*
+ * Bubble sort as used by util_list_sort() before, for comparison
+ */
+static void bubble_sort(struct util_list *list)
+{
+	struct entry *e1, *e2;
+	int swapped;
+
+	do {
+		swapped = 0;
+		e1 = util_list_start(list);
+		while ((e2 = util_list_next(list, e1))) {
+			if (cmp_key(e1, e2, NULL) > 0) {
+				util_list_remove(list, e1);
+				util_list_add_next(list, e1, e2);
+				swapped = 1;
+			} else {
+				e1 = e2;
+			}
+		}
+	} while (swapped);
+}
+
+/*
+ * Check that the list is sorted and that equal keys kept their order
+ */
+static void check(struct util_list *list, unsigned long cnt)
+{
+	struct entry *e, *prev = NULL;
+	unsigned long n = 0;
+
+	util_list_iterate(list, e) {
+		if (prev && (prev->key > e->key ||
+			     (prev->key == e->key && prev->seq > e->seq))) {
+			fprintf(stderr, "List not sorted\n");
+			exit(EXIT_FAILURE);
+		}
+		if (util_list_prev(list, e) != prev) {
+			fprintf(stderr, "List not linked correctly\n");
+			exit(EXIT_FAILURE);
+		}
+		prev = e;
+		n++;
+	}
+	if (n != cnt || util_list_end(list) != prev) {
+		fprintf(stderr, "List has lost entries\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Fill list with "cnt" entries with random keys
+ */
+static void fill(struct util_list *list, struct entry *vec, unsigned long cnt)
+{
+	unsigned long i;
+
+	util_list_init(list, struct entry, node);
+	for (i = 0; i < cnt; i++) {
+		vec[i].key = random() % (cnt / 2 + 1);
+		vec[i].seq = i;
+		util_list_add_tail(list, &vec[i]);
+	}
+}
+
+/*
+ * Measure sorting and sorted insertion for a list with "cnt" entries
+ */
+static void benchmark(unsigned long cnt)
+{
+	struct util_list list;
+	struct entry *vec;
+	unsigned long i;
+	double start;
+
+	vec = malloc(cnt * sizeof(*vec));
+	if (!vec) {
+		perror("Out of memory");
+		exit(EXIT_FAILURE);
+	}
+	printf("%lu entries:\n", cnt);
+
+	fill(&list, vec, cnt);
+	start = util_bench_time();
+	util_list_sort(&list, cmp_key, NULL);
+	printf("  util_list_sort():                %8.3f s\n",
+	       util_bench_time() - start);
+	check(&list, cnt);
+
+	if (cnt <= SLOW_MAX) {
+		fill(&list, vec, cnt);
+		start = util_bench_time();
+		bubble_sort(&list);
+		printf("  Bubble sort:                     %8.3f s\n",
+		       util_bench_time() - start);
+		check(&list, cnt);
+
+		/* Random order: Each insertion scans half of the list */
+		fill(&list, vec, cnt);
+		util_list_init(&list, struct entry, node);
+		start = util_bench_time();
+		for (i = 0; i < cnt; i++)
+			util_list_add_sorted(&list, &vec[i], cmp_key, NULL);
+		printf("  util_list_add_sorted() random:   %8.3f s\n",
+		       util_bench_time() - start);
+		check(&list, cnt);
+	}
+
+	/* Almost ascending order: Each insertion scans a few entries */
+	fill(&list, vec, cnt);
+	util_list_init(&list, struct entry, node);
+	for (i = 0; i < cnt; i++)
+		vec[i].key = i + random() % 8;
+	start = util_bench_time();
+	for (i = 0; i < cnt; i++)
+		util_list_add_sorted(&list, &vec[i], cmp_key, NULL);
+	printf("  util_list_add_sorted() ascending:%8.3f s\n",
+	       util_bench_time() - start);
+	check(&list, cnt);
+
+	free(vec);
+}
+
+/*
+ * Sort lists of different sizes
+ */
+int main(void)
+{
+	benchmark(10000);
+	benchmark(100000);
+	benchmark(1000000);
+	return EXIT_SUCCESS;
+}
+//! [code]
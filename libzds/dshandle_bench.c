@@ -0,0 +1,414 @@
+/*
+ * libzds - Benchmark for data set reads
+ *
+ * Create an image of a DASD in raw-track format that contains one
+ * sequential data set and attach it to a loop device. Read the data set
+ * sequentially with different read-ahead settings, and then with a growing
+ * number of threads that share one dshandle through lzds_dshandle_pread().
+ * Each thread reads its own part of the data set. All data is verified.
+ *
+ * Build with "make dshandle_bench". The program is not installed and must
+ * run as root to set up the loop device.
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <linux/loop.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "lib/libzds.h"
+#include "lib/util_base.h"
+#include "lib/util_bench.h"
+#include "lib/vtoc.h"
+
+#define HEADS		15
+#define BLK_SIZE	4096
+#define BLKS_PER_TRK	12
+#define CHUNK_SIZE	(128 * 1024)
+#define CYLS_DEFAULT	100
+#define THREADS_DEFAULT	8
+#define DSNAME		"BENCH.DATA"
+
+struct reader {
+	pthread_t thread;
+	struct dshandle *dsh;
+	long long start;
+	long long end;
+};
+
+/*
+ * Add a record to the track image at *pos and return the data area
+ */
+static char *track_add_record(char *track, size_t *pos, unsigned int trk,
+			      unsigned char recno, unsigned char kl,
+			      unsigned short dl)
+{
+	struct eckd_count *ecount = (struct eckd_count *)(track + *pos);
+
+	vtoc_set_cchhb(&ecount->recid, trk / HEADS, trk % HEADS, recno);
+	ecount->kl = kl;
+	ecount->dl = dl;
+	*pos += sizeof(*ecount) + kl + dl;
+	return (char *)(ecount + 1);
+}
+
+/*
+ * Start a track image with record zero
+ */
+static void track_init(char *track, size_t *pos, unsigned int trk)
+{
+	memset(track, 0, RAWTRACKSIZE);
+	*pos = 0;
+	track_add_record(track, pos, trk, 0, 0, 8);
+}
+
+/*
+ * Mark the end of the records on a track
+ */
+static void track_finish(char *track, size_t pos)
+{
+	memset(track + pos, 0xff, sizeof(unsigned long long));
+}
+
+/*
+ * Write the label track: Two IPL records and the volume label
+ */
+static void write_label_track(int fd, char *track)
+{
+	volume_label_t *vlabel;
+	size_t pos;
+
+	track_init(track, &pos, 0);
+	track_add_record(track, &pos, 0, 1, 4, 24);
+	track_add_record(track, &pos, 0, 2, 4, 144);
+	vlabel = (volume_label_t *)track_add_record(track, &pos, 0, 3, 4, 80);
+	vtoc_volume_label_init(vlabel);
+	vtoc_volume_label_set_key(vlabel, "VOL1");
+	vtoc_volume_label_set_label(vlabel, "VOL1");
+	vtoc_volume_label_set_volser(vlabel, "BENCH0");
+	vtoc_set_cchhb(&vlabel->vtoc, 0, 1, 1);
+	track_finish(track, pos);
+	if (write(fd, track, RAWTRACKSIZE) != RAWTRACKSIZE)
+		err(EXIT_FAILURE, "Could not write image");
+}
+
+/*
+ * Write the VTOC track: A format 4 and a format 1 DSCB
+ */
+static void write_vtoc_track(int fd, char *track, unsigned int cyls)
+{
+	char name[sizeof(((format1_label_t *)0)->DS1DSNAM) + 1];
+	format4_label_t *f4;
+	format1_label_t *f1;
+	cchh_t lower, upper;
+	size_t pos;
+
+	track_init(track, &pos, 1);
+	f4 = (format4_label_t *)track_add_record(track, &pos, 1, 1, 44, 96);
+	memset(f4->DS4KEYCD, 0x04, sizeof(f4->DS4KEYCD));
+	f4->DS4IDFMT = 0xf4;
+	f4->DS4DEVCT.DS4DSCYL = cyls;
+	f4->DS4DEVCT.DS4DSTRK = HEADS;
+	f4->DS4DEVCT.DS4DEVDT = 50;
+	vtoc_set_cchh(&lower, 0, 1);
+	vtoc_set_cchh(&upper, 0, 1);
+	vtoc_set_extent(&f4->DS4VTOCE, 0x01, 0, &lower, &upper);
+
+	f1 = (format1_label_t *)track_add_record(track, &pos, 1, 2, 44, 96);
+	snprintf(name, sizeof(name), "%-44s", DSNAME);
+	vtoc_ebcdic_enc(name, f1->DS1DSNAM, sizeof(f1->DS1DSNAM));
+	f1->DS1FMTID = 0xf1;
+	vtoc_ebcdic_enc("BENCH0", (char *)f1->DS1DSSN, sizeof(f1->DS1DSSN));
+	f1->DS1VOLSQ = 1;
+	f1->DS1NOEPV = 1;
+	f1->DS1DSRG1 = 0x40;	/* PS */
+	f1->DS1RECFM = 0x80;	/* F */
+	f1->DS1BLKL = BLK_SIZE;
+	f1->DS1LRECL = BLK_SIZE;
+	vtoc_set_cchh(&lower, 1, 0);
+	vtoc_set_cchh(&upper, cyls - 1, HEADS - 1);
+	vtoc_set_extent(&f1->DS1EXT1, 0x01, 0, &lower, &upper);
+	track_finish(track, pos);
+	if (write(fd, track, RAWTRACKSIZE) != RAWTRACKSIZE)
+		err(EXIT_FAILURE, "Could not write image");
+}
+
+/*
+ * Fill a data block with the data set offsets of its 8 byte words
+ */
+static void fill_block(unsigned long long *data, unsigned long long offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < BLK_SIZE / sizeof(*data); i++)
+		data[i] = offset + i * sizeof(*data);
+}
+
+/*
+ * Write an image with "cyls" cylinders and a data set on all but the first
+ */
+static long long write_image(int fd, unsigned int cyls)
+{
+	unsigned long long offset = 0;
+	unsigned int trk, blk;
+	char *track;
+	size_t pos;
+
+	track = malloc(RAWTRACKSIZE);
+	if (!track)
+		errx(EXIT_FAILURE, "Out of memory");
+	write_label_track(fd, track);
+	write_vtoc_track(fd, track, cyls);
+	memset(track, 0, RAWTRACKSIZE);
+	for (trk = 2; trk < HEADS; trk++) {
+		if (write(fd, track, RAWTRACKSIZE) != RAWTRACKSIZE)
+			err(EXIT_FAILURE, "Could not write image");
+	}
+	for (trk = HEADS; trk < cyls * HEADS; trk++) {
+		track_init(track, &pos, trk);
+		for (blk = 1; blk <= BLKS_PER_TRK; blk++) {
+			fill_block((unsigned long long *)
+				   track_add_record(track, &pos, trk, blk, 0,
+						    BLK_SIZE), offset);
+			offset += BLK_SIZE;
+		}
+		/* An empty record marks the end of the data set */
+		if (trk == cyls * HEADS - 1)
+			track_add_record(track, &pos, trk, blk, 0, 0);
+		track_finish(track, pos);
+		if (write(fd, track, RAWTRACKSIZE) != RAWTRACKSIZE)
+			err(EXIT_FAILURE, "Could not write image");
+	}
+	free(track);
+	return offset;
+}
+
+/*
+ * Attach the image to a free loop device that is released on close
+ */
+static int loop_attach(const char *image, char *dev, size_t size)
+{
+	struct loop_info64 info;
+	int ctl, nr, fd, loop_fd;
+
+	ctl = open("/dev/loop-control", O_RDWR);
+	if (ctl == -1)
+		err(EXIT_FAILURE, "Could not open /dev/loop-control");
+	nr = ioctl(ctl, LOOP_CTL_GET_FREE);
+	if (nr == -1)
+		err(EXIT_FAILURE, "Could not get free loop device");
+	close(ctl);
+	snprintf(dev, size, "/dev/loop%d", nr);
+	loop_fd = open(dev, O_RDWR);
+	if (loop_fd == -1)
+		err(EXIT_FAILURE, "Could not open %s", dev);
+	fd = open(image, O_RDWR);
+	if (fd == -1)
+		err(EXIT_FAILURE, "Could not open %s", image);
+	if (ioctl(loop_fd, LOOP_SET_FD, fd))
+		err(EXIT_FAILURE, "Could not attach %s", dev);
+	close(fd);
+	memset(&info, 0, sizeof(info));
+	info.lo_flags = LO_FLAGS_AUTOCLEAR;
+	if (ioctl(loop_fd, LOOP_SET_STATUS64, &info))
+		err(EXIT_FAILURE, "Could not set status of %s", dev);
+	return loop_fd;
+}
+
+/*
+ * Find the data set on the loop device
+ */
+static struct dataset *dataset_find(struct zdsroot *root, const char *dev)
+{
+	struct dataset *ds;
+	struct dasd *dasd;
+
+	if (lzds_zdsroot_add_device(root, dev, &dasd) ||
+	    lzds_dasd_read_vlabel(dasd) ||
+	    lzds_dasd_alloc_rawvtoc(dasd) ||
+	    lzds_zdsroot_extract_datasets_from_dasd(root, dasd) ||
+	    lzds_zdsroot_find_dataset(root, DSNAME, &ds))
+		errx(EXIT_FAILURE, "Could not find data set %s on %s",
+		     DSNAME, dev);
+	return ds;
+}
+
+/*
+ * Open a dshandle for the data set
+ */
+static struct dshandle *dshandle_open(struct dataset *ds,
+				      unsigned int readahead)
+{
+	struct dshandle *dsh;
+
+	if (lzds_dataset_alloc_dshandle(ds, 0, &dsh) ||
+	    lzds_dshandle_set_seekbuffer(dsh, 1024 * 1024) ||
+	    lzds_dshandle_set_readahead(dsh, readahead) ||
+	    lzds_dshandle_open(dsh))
+		errx(EXIT_FAILURE, "Could not open data set %s", DSNAME);
+	return dsh;
+}
+
+/*
+ * Verify that the buffer contains the data of the given data set offset
+ */
+static void verify(const char *buf, long long offset, ssize_t count)
+{
+	unsigned long long *data = (unsigned long long *)buf;
+	ssize_t i;
+
+	for (i = 0; i < count / (ssize_t)sizeof(*data); i++) {
+		if (data[i] != offset + i * sizeof(*data))
+			errx(EXIT_FAILURE, "Wrong data at offset %lld",
+			     offset + i * (long long)sizeof(*data));
+	}
+}
+
+/*
+ * Read the part of the data set that is assigned to a thread
+ */
+static void *reader_main(void *arg)
+{
+	struct reader *reader = arg;
+	long long offset;
+	ssize_t count;
+	size_t size;
+	char *buf;
+
+	buf = malloc(CHUNK_SIZE);
+	if (!buf)
+		errx(EXIT_FAILURE, "Out of memory");
+	for (offset = reader->start; offset < reader->end; offset += count) {
+		size = MIN((long long)CHUNK_SIZE, reader->end - offset);
+		if (lzds_dshandle_pread(reader->dsh, buf, size, offset,
+					&count) || count != (ssize_t)size)
+			errx(EXIT_FAILURE, "Read at offset %lld failed",
+			     offset);
+		verify(buf, offset, count);
+	}
+	free(buf);
+	return NULL;
+}
+
+/*
+ * Read the data set sequentially with lzds_dshandle_read
+ */
+static double benchmark_read(struct dataset *ds, long long len,
+			     unsigned int readahead)
+{
+	struct dshandle *dsh;
+	long long offset;
+	ssize_t count;
+	double start;
+	char *buf;
+
+	buf = malloc(CHUNK_SIZE);
+	if (!buf)
+		errx(EXIT_FAILURE, "Out of memory");
+	dsh = dshandle_open(ds, readahead);
+	start = util_bench_time();
+	for (offset = 0; offset < len; offset += count) {
+		if (lzds_dshandle_read(dsh, buf, CHUNK_SIZE, &count) || !count)
+			errx(EXIT_FAILURE, "Read at offset %lld failed",
+			     offset);
+		verify(buf, offset, count);
+	}
+	start = util_bench_time() - start;
+	lzds_dshandle_close(dsh);
+	lzds_dshandle_free(dsh);
+	free(buf);
+	return start;
+}
+
+/*
+ * Read the data set with "cnt" threads that share one dshandle
+ */
+static double benchmark_pread(struct dataset *ds, long long len,
+			      unsigned int cnt)
+{
+	struct reader *readers;
+	struct dshandle *dsh;
+	long long part;
+	unsigned int i;
+	double start;
+
+	readers = calloc(cnt, sizeof(*readers));
+	if (!readers)
+		errx(EXIT_FAILURE, "Out of memory");
+	dsh = dshandle_open(ds, 1);
+	part = len / cnt / CHUNK_SIZE * CHUNK_SIZE;
+	start = util_bench_time();
+	for (i = 0; i < cnt; i++) {
+		readers[i].dsh = dsh;
+		readers[i].start = i * part;
+		readers[i].end = (i == cnt - 1) ? len : (i + 1) * part;
+		if (pthread_create(&readers[i].thread, NULL, reader_main,
+				   &readers[i]))
+			errx(EXIT_FAILURE, "Could not create thread");
+	}
+	for (i = 0; i < cnt; i++)
+		pthread_join(readers[i].thread, NULL);
+	start = util_bench_time() - start;
+	lzds_dshandle_close(dsh);
+	lzds_dshandle_free(dsh);
+	free(readers);
+	return start;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int cyls = CYLS_DEFAULT, threads = THREADS_DEFAULT, cnt, i;
+	static const unsigned int readahead_vec[] = { 0, 1, 4 };
+	char image[] = "/tmp/dshandle_bench.XXXXXX";
+	struct zdsroot *root;
+	struct dataset *ds;
+	int fd, loop_fd;
+	char dev[32];
+	long long len;
+	double t;
+
+	if (argc > 1)
+		cyls = atoi(argv[1]);
+	if (argc > 2)
+		threads = atoi(argv[2]);
+	if (cyls < 2 || cyls > 0xfff0 || threads == 0)
+		errx(EXIT_FAILURE, "Usage: %s [CYLINDERS [THREADS]]", argv[0]);
+
+	fd = mkstemp(image);
+	if (fd == -1)
+		err(EXIT_FAILURE, "Could not create image");
+	len = write_image(fd, cyls);
+	close(fd);
+	loop_fd = loop_attach(image, dev, sizeof(dev));
+	unlink(image);
+
+	if (lzds_zdsroot_alloc(&root))
+		errx(EXIT_FAILURE, "Out of memory");
+	ds = dataset_find(root, dev);
+	printf("Data set with %lld MiB on %u cylinders\n", len >> 20, cyls);
+	printf("Sequential read:\n");
+	for (i = 0; i < UTIL_ARRAY_SIZE(readahead_vec); i++) {
+		t = benchmark_read(ds, len, readahead_vec[i]);
+		printf("  Read-ahead %u: %8.3f s %8.1f MiB/s\n",
+		       readahead_vec[i], t, len / t / (1 << 20));
+	}
+	printf("Concurrent pread with one shared dshandle:\n");
+	for (cnt = 1; cnt <= threads; cnt *= 2) {
+		t = benchmark_pread(ds, len, cnt);
+		printf("  %2u threads: %8.3f s %8.1f MiB/s\n", cnt, t,
+		       len / t / (1 << 20));
+	}
+	lzds_zdsroot_free(root);
+	close(loop_fd);
+	return EXIT_SUCCESS;
+}
@@ -12,9 +12,11 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <aio.h>
 #include <errno.h>
 #include <linux/types.h>
 #include <malloc.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -161,6 +163,9 @@ struct dataset {
 	/** @brief If a data set is a partitioned data set (PDS), then this
 	 *  contains a list of members, otherwise the list is empty */
 	struct util_list *memberlist;
+	/** @brief Flag that is set to 1 when the PDS directory has been read
+	 *  into memberlist */
+	int members_read;
 	/** @brief Detailed error messages in case of a problem */
 	struct errorlog *log;
 };
@@ -214,35 +219,97 @@ struct seekelement {
  */
 #define TRACK_BUFFER_DEFAULT 128
 
-struct dshandle {
-	/** @brief Data set this context relates to */
-	struct dataset *ds;
-	/** @brief Pointer to member, only applicable to PDS */
-	struct pdsmember *member;
-	/** @brief One dasdhandle per data set part
-	 *
-	 *  The dshandle functions do not read directly from the devices,
-	 *  instead they use the dasdhandle interfacesw.
-	 */
-	struct dasdhandle *dasdhandle[MAXVOLUMESPERDS];
+/**
+ * @brief Identifier at the beginning of a persistent seek index file
+ */
+#define SEEKINDEX_MAGIC "LZDSSIX2"
 
-	/** @brief A multiplier that is used to determine the various
-	    buffer sizes. Number of tracks in one track frame. */
-	unsigned int tracks_per_frame;
+/**
+ * @brief Internal structure at the beginning of a persistent seek index file
+ *
+ * The header is followed by count elements of type struct seekelement.
+ */
+struct seekindex_header {
+	/** @brief Identifier SEEKINDEX_MAGIC, not 0-terminated */
+	char magic[8];
+	/** @brief Hash of all data that the seek elements depend on */
+	unsigned long long key;
+	/** @brief Size of a single struct seekindex_element */
+	unsigned long long elemsize;
+	/** @brief Number of seek elements in the file */
+	unsigned long long count;
+};
 
-	/** @brief Flag: While interpreting the data, keep the record
-	 *  descriptor words in the data stream */
-	int keepRDW;
-	/** @brief Flag that is set between open and close */
-	int is_open;
+/**
+ * @brief Internal structure of a seek element in a persistent seek index file
+ *
+ * Unlike struct seekelement, this structure has no padding, so that the
+ * file contents are completely defined.
+ */
+struct seekindex_element {
+	/** @brief Data set part this element refers to */
+	unsigned char dsp_no;
+	/** @brief The extent on that part/dasd */
+	unsigned char ext_seq_no;
+	/** @brief Reserved, always 0 */
+	unsigned short reserved;
+	/** @brief The starting track on that part/dasd */
+	unsigned int bufstarttrk;
+	/** @brief The absolute offset in the data set */
+	long long databufoffset;
+} __attribute__ ((packed));
+
+/**
+ * @brief Internal structure that describes the location of a track frame
+ */
+struct framepos {
+	/** @brief Index number of the data set part */
+	int dsp_no;
+	/** @brief The sequence number of the extent in the data set part */
+	int ext_seq_no;
+	/** @brief The first track of the extent */
+	unsigned int extstarttrk;
+	/** @brief The last track of the extent */
+	unsigned int extendtrk;
+	/** @brief The first track of the track frame */
+	unsigned int bufstarttrk;
+	/** @brief The last track of the track frame */
+	unsigned int bufendtrk;
+};
+
+/**
+ * @brief Internal structure for an asynchronous read of a track frame
+ */
+struct readahead {
+	/** @brief Location of the track frame that is read */
+	struct framepos pos;
+	/** @brief POSIX AIO control block */
+	struct aiocb cb;
+	/** @brief Buffer for the raw track images */
+	char *rawbuffer;
+};
+
+/**
+ * @brief Maximum number of positional reads that can use a dshandle
+ *        concurrently
+ */
+#define MAXREADERS 4
+
+/**
+ * @brief Internal structure for a read position within a data set
+ *
+ * A read position holds the location of the current track frame, the
+ * buffers with its raw and extracted data and the read-ahead requests
+ * for the following track frames. Sequential reads and seeks use the
+ * read position in the dshandle. Each positional read uses one of the
+ * additional read positions exclusively, so that concurrent positional
+ * reads do not disturb each other or the sequential read position.
+ */
+struct readpos {
 	/** @brief This flag is set when during interpretation of the track
 	 *  buffer the end of the data is found	 */
 	int eof_reached;
 
-
-	/* The following values describe our current position within the data
-	 * set */
-
 	/** @brief Index number of the current data set part */
 	int dsp_no;
 	/** @brief The sequence number of the current extent in the current
@@ -271,10 +338,6 @@ struct dshandle {
 	char *rawbuffer;
 	/** @brief Buffer for the extracted user data */
 	char *databuffer;
-	/** @brief Size of the rawbuffer */
-	long long rawbufmax;
-	/** @brief Size of the databuffer */
-	long long databufmax;
 	/** @brief Size of the currently used part of the rawbuffer */
 	long long rawbufsize;
 	/** @brief Size of the currently used part of the databuffer */
@@ -285,6 +348,57 @@ struct dshandle {
 	/** @brief Current position in the databuffer */
 	long long bufpos;
 
+	/** @brief Ring of read-ahead requests with dshandle->readahead
+	 *  elements */
+	struct readahead *ra;
+	/** @brief Index of the oldest outstanding request in ra */
+	unsigned int ra_first;
+	/** @brief Number of outstanding requests in ra */
+	unsigned int ra_count;
+
+	/** @brief Flag: The read position is used by a positional read */
+	int busy;
+};
+
+struct dshandle {
+	/** @brief Data set this context relates to */
+	struct dataset *ds;
+	/** @brief Pointer to member, only applicable to PDS */
+	struct pdsmember *member;
+	/** @brief One dasdhandle per data set part
+	 *
+	 *  The dshandle functions do not read directly from the devices,
+	 *  instead they use the dasdhandle interfacesw.
+	 */
+	struct dasdhandle *dasdhandle[MAXVOLUMESPERDS];
+
+	/** @brief A multiplier that is used to determine the various
+	    buffer sizes. Number of tracks in one track frame. */
+	unsigned int tracks_per_frame;
+
+	/** @brief Flag: While interpreting the data, keep the record
+	 *  descriptor words in the data stream */
+	int keepRDW;
+	/** @brief Flag that is set between open and close */
+	int is_open;
+
+	/** @brief Read position of lzds_dshandle_read and lzds_dshandle_lseek */
+	struct readpos pos;
+	/** @brief Read positions of lzds_dshandle_pread */
+	struct readpos readers[MAXREADERS];
+	/** @brief Number of allocated elements in readers */
+	unsigned int reader_count;
+	/** @brief Protects readers, the seek buffer and the error log against
+	 *  concurrent positional reads */
+	pthread_mutex_t lock;
+	/** @brief Signaled when an element of readers is no longer busy */
+	pthread_cond_t cond;
+
+	/** @brief Size of the rawbuffer of a read position */
+	long long rawbufmax;
+	/** @brief Size of the databuffer of a read position */
+	long long databufmax;
+
 
 	/** @brief Buffer for seek data points */
 	struct seekelement *seekbuf;
@@ -298,6 +412,14 @@ struct dshandle {
 	 *  Example: If skip is 2, then every 2'nd frame is stored.
 	 */
 	unsigned long long skip;
+	/** @brief Number of elements in seekbuf that are known to be stored
+	 *  in the persistent seek index */
+	unsigned long long seek_saved;
+
+	/** @brief Number of track frames that are read ahead asynchronously
+	 *  by each read position */
+	unsigned int readahead;
+
 	/** @brief Detailed error messages in case of a problem */
 	struct errorlog *log;
 };
@@ -310,6 +432,7 @@ struct dshandle {
 /******************************************************************************/
 
 static void dasd_free(struct dasd *dasd);
+static void dasd_free_dslist(struct dasd *dasd);
 static void dataset_free_memberlist(struct dataset *ds);
 static void errorlog_free(struct errorlog *log);
 static void errorlog_clear(struct errorlog *log);
@@ -536,6 +659,7 @@ void lzds_dasd_get_errorlog(struct dasd *dasd, struct errorlog **log)
  */
 static void dasd_free(struct dasd *dasd)
 {
+	dasd_free_dslist(dasd);
 	free(dasd->device);
 	free(dasd->vlabel);
 	if (dasd->rawvtoc) {
@@ -949,37 +1073,43 @@ int lzds_dasdhandle_close(struct dasdhandle *dasdh)
 }
 
 /**
+ * @brief Subroutine of lzds_dasdhandle_read_tracks_to_buffer
+ *
+ * The tracks are read with pread, so that several threads can read from
+ * the same dasdhandle concurrently. Error messages are written to the
+ * given log instead of the log of the dasdhandle for the same reason.
+ *
  * @param[in]  dasdh The dasdhandle we are reading from
  * @param[in]  starttrck First track to read
  * @param[in]  endtrck Last track to read
  * @param[out] trackdata Target buffer we read into, must have at least the
  *                       size (endtrk - starttrk + 1) * RAWTRACKSIZE
+ * @param[out] log The error log for error messages.
  * @return     0 on success, otherwise one of the following error codes:
  *   - EINVAL  starttrck or endtrck are not within the boundaries of the
  *             underlying DASD device.
  *   - EPROTO  Could not read a full track image
  *   - EIO     Other I/O error
  */
-int lzds_dasdhandle_read_tracks_to_buffer(struct dasdhandle *dasdh,
-					  unsigned int starttrck,
-					  unsigned int endtrck,
-					  char *trackdata)
+static int dasdhandle_read_tracks(struct dasdhandle *dasdh,
+				  unsigned int starttrck,
+				  unsigned int endtrck,
+				  char *trackdata,
+				  struct errorlog **log)
 {
 	off_t trckseek;
 	ssize_t residual;
-	off_t rc;
 	ssize_t count;
 
 	unsigned int cylinders;
 	unsigned int heads;
 
-	errorlog_clear(dasdh->log);
 	/* verify that endtrck is not beyond the end of the dasd */
 	lzds_dasd_get_cylinders(dasdh->dasd, &cylinders);
 	lzds_dasd_get_heads(dasdh->dasd, &heads);
 	if (starttrck > endtrck || endtrck >= cylinders * heads)
 		return errorlog_add_message(
-			&dasdh->log, NULL, EINVAL,
+			log, NULL, EINVAL,
 			"dasdhandle read tracks: start %u, end %u is"
 			" out of bounds for device %s\n",
 			starttrck, endtrck, dasdh->dasd->device);
@@ -991,35 +1121,51 @@ int lzds_dasdhandle_read_tracks_to_buffer(struct dasdhandle *dasdh,
 	trckseek = (off_t)starttrck * RAWTRACKSIZE;
 	/* residual is the number of bytes we still have to read */
 	residual = (off_t)(endtrck - starttrck + 1) * RAWTRACKSIZE;
-	rc = lseek(dasdh->fd, trckseek, SEEK_SET);
-	if (rc < 0)
-		return errorlog_add_message(
-			&dasdh->log, NULL, EINVAL,
-			"dasdhandle read tracks: seek to %llu, failed"
-			" for device %s\n",
-			(unsigned long long)trckseek, dasdh->dasd->device);
 
 	while (residual) {
-		count = read(dasdh->fd, trackdata, residual);
-		if (count < 0)
+		count = pread(dasdh->fd, trackdata, residual, trckseek);
+		if (count <= 0)
 			return errorlog_add_message(
-				&dasdh->log, NULL, EIO,
+				log, NULL, EIO,
 				"dasdhandle read tracks: read failed"
 				" for device %s, start %u, end %u\n",
 				dasdh->dasd->device, starttrck, endtrck);
 		if (count % RAWTRACKSIZE) /* No full track read */
 			return errorlog_add_message(
-				&dasdh->log, NULL, EPROTO,
+				log, NULL, EPROTO,
 				"dasdhandle read tracks: read returned "
 				"unaligned data for device %s,"
 				"start %u, end %u\n",
 				dasdh->dasd->device, starttrck, endtrck);
 		residual -= count;
 		trackdata += count;
+		trckseek += count;
 	}
 	return 0;
 }
 
+/**
+ * @param[in]  dasdh The dasdhandle we are reading from
+ * @param[in]  starttrck First track to read
+ * @param[in]  endtrck Last track to read
+ * @param[out] trackdata Target buffer we read into, must have at least the
+ *                       size (endtrk - starttrk + 1) * RAWTRACKSIZE
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  starttrck or endtrck are not within the boundaries of the
+ *             underlying DASD device.
+ *   - EPROTO  Could not read a full track image
+ *   - EIO     Other I/O error
+ */
+int lzds_dasdhandle_read_tracks_to_buffer(struct dasdhandle *dasdh,
+					  unsigned int starttrck,
+					  unsigned int endtrck,
+					  char *trackdata)
+{
+	errorlog_clear(dasdh->log);
+	return dasdhandle_read_tracks(dasdh, starttrck, endtrck, trackdata,
+				      &dasdh->log);
+}
+
 
 /******************************************************************************/
 /*      MID  level functions                                                  */
@@ -1713,10 +1859,19 @@ int lzds_zdsroot_find_dataset(struct zdsroot *root, const char *name,
  *   - ENOMEM  Could not allocate structure due to lack of memory.
  *   - EINVAL  Failed to allocate a memberiterator because the data set does
  *             not support members (is not a PDS).
+ *   - EPROTO  The PDS directory is not valid.
+ *   - EIO     An error happened while reading the PDS directory.
  */
 int lzds_dataset_alloc_memberiterator(struct dataset *ds,
 				      struct memberiterator **it)
 {
+	int rc;
+
+	rc = lzds_dataset_read_members(ds);
+	if (rc) {
+		*it = NULL;
+		return rc;
+	}
 	if (!ds->memberlist) {
 		*it = NULL;
 		return errorlog_add_message(
@@ -2101,7 +2256,7 @@ static int extract_members_from_track(char *trackdata, struct dataset *ds,
 }
 
 /**
- * @brief Subroutine of lzds_zdsroot_extract_datasets_from_dasd.
+ * @brief Subroutine of lzds_dataset_read_members.
  *
  * This function checks if a data set is a PDS, analyzes the PDS directory
  * and creates a corresponding list of struct pdsmember in the dataset.
@@ -2215,6 +2370,48 @@ out1:
 	return rc;
 }
 
+/**
+ * @param[in]  ds     A dataset on which an error occurred.
+ * @param[out] log    Reference to a variable in which the errorlog
+ *                    is returned.
+ */
+void lzds_dataset_get_errorlog(struct dataset *ds, struct errorlog **log)
+{
+	*log = ds->log;
+}
+
+/**
+ * The directory of a partitioned data set is read when the members are
+ * accessed for the first time, so that data sets can be found without
+ * reading the directories of all partitioned data sets first. Functions
+ * that access the members call this function implicitly, but it is not
+ * thread-safe. Applications that access a data set from several threads
+ * must call it once while holding a lock.
+ *
+ * @param[in]  ds  The dataset whose members are to be read.
+ * @return     0 on success or if the data set is not a PDS,
+ *             otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate structure due to lack of memory.
+ *   - EPROTO  The track layout is not valid.
+ *   - EINVAL  An internal error happened.
+ *   - EIO     An error happened while reading data from disk.
+ */
+int lzds_dataset_read_members(struct dataset *ds)
+{
+	int rc;
+
+	if (ds->members_read)
+		return 0;
+	rc = dataset_member_analysis(ds);
+	if (rc)
+		return errorlog_add_message(
+			&ds->log, ds->log, rc,
+			"read members: member analysis failed for %s\n",
+			ds->name);
+	ds->members_read = 1;
+	return 0;
+}
+
 /**
  * @brief Subroutine of zdsroot_merge_dataset
  *
@@ -2343,118 +2540,223 @@ static int zdsroot_merge_dataset(struct zdsroot *root, struct dataset *newds)
 	return 0;
 }
 
+/**
+ * @brief Helper function that frees a data set that has been extracted
+ *        from a VTOC but has not been merged into a zdsroot.
+ *
+ * @param[in] ds Pointer to the struct dataset that is to be freed.
+ */
+static void dataset_free(struct dataset *ds)
+{
+	int i;
+
+	dataset_free_memberlist(ds);
+	for (i = 0; i < MAXVOLUMESPERDS; ++i)
+		free(ds->dsp[i]);
+	errorlog_free(ds->log);
+	free(ds);
+}
+
+/**
+ * @brief Helper function that frees the data sets that have been extracted
+ *        from the VTOC of a dasd but have not been merged into a zdsroot.
+ *
+ * @param[in] dasd The dasd that holds the list of data sets.
+ */
+static void dasd_free_dslist(struct dasd *dasd)
+{
+	struct dataset *ds, *nextds;
+
+	if (!dasd->dslist)
+		return;
+	util_list_iterate_safe(dasd->dslist, ds, nextds) {
+		util_list_remove(dasd->dslist, ds);
+		dataset_free(ds);
+	}
+	util_list_free(dasd->dslist);
+	dasd->dslist = NULL;
+}
+
 /**
  * This function finds all data set descriptions in the VTOC of the
- * dasd and creates respective struct dataset representations. These
- * struct dataset are stored in the zdsroot and can later be traversed
- * using a dsiterator.  In case that it finds a dataset that is
- * already present in the zdsroot, it verifies that both are parts of
- * the same multivolume data set and then merges the new data with the
- * existing struct dataset.  If the conflicting data sets are indeed
- * individual data sets and not parts of a single one, the function
- * returns an error.
+ * dasd and creates respective struct dataset representations. The
+ * directories of partitioned data sets are read later, when the members
+ * are accessed for the first time. The data sets are stored
+ * in the dasd in VTOC order until they are merged into a zdsroot with
+ * lzds_zdsroot_merge_datasets_from_dasd.
  *
- * @param[in]  root    The zdsroot that the dataset will be merged into.
- * @param[in]  dasd    The datasets found in this dasd will be merged.
+ * This function does only access the given dasd, so it can be called
+ * concurrently for different dasds, for example to read the VTOCs of
+ * many devices in parallel.
+ *
+ * @param[in]  dasd    The dasd with the rawvtoc that is to be analyzed.
  * @return     0 on success, otherwise one of the following error codes:
  *   - ENOMEM  Could not allocate structure due to lack of memory.
- *   - EPROTO  The data is not mergable because of conflicting entries,
- *             or invalid data in the VTOC of the dasd.
+ *   - EPROTO  Invalid data in the VTOC of the dasd.
  */
-int lzds_zdsroot_extract_datasets_from_dasd(struct zdsroot *root,
-					    struct dasd *dasd)
+int lzds_dasd_extract_datasets(struct dasd *dasd)
 {
 	format1_label_t *f1;
 	struct dscb *dscb;
 	struct dscbiterator *it;
+	struct dataset *ds;
 	int rc;
-	struct dataset tmpds;
-	int i;
 
-	errorlog_clear(root->log);
-	memset(&tmpds, 0, sizeof(tmpds));
+	dasd_free_dslist(dasd);
+	dasd->dslist = util_list_new(struct dataset, list);
 	rc = lzds_raw_vtoc_alloc_dscbiterator(dasd->rawvtoc, &it);
 	if (rc)
 		return ENOMEM;
 	while (!lzds_dscbiterator_get_next_dscb(it, &dscb)) {
-		if (dscb->fmtid == 0xf1 || dscb->fmtid == 0xf8) {
-			f1 = (format1_label_t *)dscb;
-			rc = create_dataset_from_dscb(dasd, f1, &tmpds);
-			if (rc) {
-				errorlog_add_message(
-					&root->log, dasd->log, rc,
-					"extract data sets: "
-					"creating dataset failed for %s\n",
-					dasd->device);
-				break;
-			}
-			rc = dataset_member_analysis(&tmpds);
-			if (rc) {
-				errorlog_add_message(
-					&root->log, tmpds.log, rc,
-					"extract data sets: "
-					"member analysis failed for %s\n",
-					tmpds.name);
-				break;
-			}
-			rc = zdsroot_merge_dataset(root, &tmpds);
-			if (rc) {
-				errorlog_add_message(
-					&root->log, root->log, rc,
-					"extract data sets: "
-					"merge dataset failed for %s\n",
-					tmpds.name);
-				break;
-			}
+		if (dscb->fmtid != 0xf1 && dscb->fmtid != 0xf8)
+			continue;
+		f1 = (format1_label_t *)dscb;
+		ds = malloc(sizeof(*ds));
+		if (!ds) {
+			rc = ENOMEM;
+			break;
 		}
+		rc = create_dataset_from_dscb(dasd, f1, ds);
+		if (rc) {
+			free(ds);
+			errorlog_add_message(
+				&dasd->log, dasd->log, rc,
+				"extract data sets: "
+				"creating dataset failed for %s\n",
+				dasd->device);
+			break;
+		}
+		util_list_add_tail(dasd->dslist, ds);
 	}
-	if (rc) {
-		dataset_free_memberlist(&tmpds);
-		for (i = 0; i < MAXVOLUMESPERDS; ++i)
-			free(tmpds.dsp[i]);
-		errorlog_free(tmpds.log);
-	}
+	if (rc)
+		dasd_free_dslist(dasd);
 	lzds_dscbiterator_free(it);
 	return rc;
 }
 
 /**
- * @brief Subroutine of lzds_dataset_get_size_in_tracks
+ * This function merges the data sets that have been extracted from the
+ * VTOC of the dasd by lzds_dasd_extract_datasets into the zdsroot.
+ * In case that it finds a dataset that is already present in the
+ * zdsroot, it verifies that both are parts of the same multivolume
+ * data set and then merges the new data with the existing struct
+ * dataset.  If the conflicting data sets are indeed individual data
+ * sets and not parts of a single one, the function returns an error.
  *
- * Computes the number of tracks in a given extent.
- * Returns 0 for anything but user data.
- * @param[in]  ext    The extent we want to know the size of.
- * @param[in]  dasd   The dasd that the extent is located on.
- * @return     Number of tracks the extent contains
+ * The data sets are merged in VTOC order, so merging the dasds in a
+ * fixed order yields the same zdsroot, regardless of the order in
+ * which the VTOCs have been read.
+ *
+ * @param[in]  root    The zdsroot that the dataset will be merged into.
+ * @param[in]  dasd    The datasets found in this dasd will be merged.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate structure due to lack of memory.
+ *   - EPROTO  The data is not mergable because of conflicting entries.
  */
-static unsigned int get_extent_size_in_tracks(extent_t *ext, struct dasd *dasd)
+int lzds_zdsroot_merge_datasets_from_dasd(struct zdsroot *root,
+					  struct dasd *dasd)
 {
-	unsigned int starttrck, endtrck;
+	struct dataset *ds, *nextds;
+	int rc;
 
-	if (!extent_contains_userdata(ext))
+	errorlog_clear(root->log);
+	if (!dasd->dslist)
 		return 0;
-
-	lzds_dasd_cchh2trk(dasd, &ext->llimit, &starttrck);
-	lzds_dasd_cchh2trk(dasd, &ext->ulimit, &endtrck);
-
-	return endtrck - starttrck + 1;
+	rc = 0;
+	util_list_iterate_safe(dasd->dslist, ds, nextds) {
+		util_list_remove(dasd->dslist, ds);
+		rc = zdsroot_merge_dataset(root, ds);
+		if (rc) {
+			errorlog_add_message(
+				&root->log, root->log, rc,
+				"extract data sets: "
+				"merge dataset failed for %s\n",
+				ds->name);
+			dataset_free(ds);
+			break;
+		}
+		/* the content of ds belongs to root now */
+		free(ds);
+	}
+	dasd_free_dslist(dasd);
+	return rc;
 }
 
 /**
- * @param[in]  ds     The dataset we we want to know the size of.
- * @param[out] tracks Reference to a return buffer for the number of tracks.
- */
-void lzds_dataset_get_size_in_tracks(struct dataset *ds,
-				     unsigned long long *tracks)
-{
-	unsigned long long sumtracks;
-	int i, j;
-
-	*tracks = 0;
-	sumtracks = 0;
-	for (i = 0; i < MAXVOLUMESPERDS; ++i)
-		if (ds->dsp[i])
-			for (j = 0; j < MAXEXTENTS; ++j)
+ * This function finds all data set descriptions in the VTOC of the
+ * dasd and creates respective struct dataset representations. These
+ * struct dataset are stored in the zdsroot and can later be traversed
+ * using a dsiterator.  In case that it finds a dataset that is
+ * already present in the zdsroot, it verifies that both are parts of
+ * the same multivolume data set and then merges the new data with the
+ * existing struct dataset.  If the conflicting data sets are indeed
+ * individual data sets and not parts of a single one, the function
+ * returns an error.
+ *
+ * This is the combination of lzds_dasd_extract_datasets and
+ * lzds_zdsroot_merge_datasets_from_dasd.
+ *
+ * @param[in]  root    The zdsroot that the dataset will be merged into.
+ * @param[in]  dasd    The datasets found in this dasd will be merged.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate structure due to lack of memory.
+ *   - EPROTO  The data is not mergable because of conflicting entries,
+ *             or invalid data in the VTOC of the dasd.
+ *   - EIO     An error happened while reading data from disk.
+ */
+int lzds_zdsroot_extract_datasets_from_dasd(struct zdsroot *root,
+					    struct dasd *dasd)
+{
+	int rc;
+
+	errorlog_clear(root->log);
+	rc = lzds_dasd_extract_datasets(dasd);
+	if (rc)
+		return errorlog_add_message(
+			&root->log, dasd->log, rc,
+			"extract data sets: "
+			"analyzing VTOC failed for %s\n",
+			dasd->device);
+	return lzds_zdsroot_merge_datasets_from_dasd(root, dasd);
+}
+
+/**
+ * @brief Subroutine of lzds_dataset_get_size_in_tracks
+ *
+ * Computes the number of tracks in a given extent.
+ * Returns 0 for anything but user data.
+ * @param[in]  ext    The extent we want to know the size of.
+ * @param[in]  dasd   The dasd that the extent is located on.
+ * @return     Number of tracks the extent contains
+ */
+static unsigned int get_extent_size_in_tracks(extent_t *ext, struct dasd *dasd)
+{
+	unsigned int starttrck, endtrck;
+
+	if (!extent_contains_userdata(ext))
+		return 0;
+
+	lzds_dasd_cchh2trk(dasd, &ext->llimit, &starttrck);
+	lzds_dasd_cchh2trk(dasd, &ext->ulimit, &endtrck);
+
+	return endtrck - starttrck + 1;
+}
+
+/**
+ * @param[in]  ds     The dataset we we want to know the size of.
+ * @param[out] tracks Reference to a return buffer for the number of tracks.
+ */
+void lzds_dataset_get_size_in_tracks(struct dataset *ds,
+				     unsigned long long *tracks)
+{
+	unsigned long long sumtracks;
+	int i, j;
+
+	*tracks = 0;
+	sumtracks = 0;
+	for (i = 0; i < MAXVOLUMESPERDS; ++i)
+		if (ds->dsp[i])
+			for (j = 0; j < MAXEXTENTS; ++j)
 				sumtracks += get_extent_size_in_tracks(
 					&ds->dsp[i]->ext[j], ds->dsp[i]->dasdi);
 	*tracks = sumtracks;
@@ -2577,7 +2879,7 @@ int lzds_dataset_get_member_by_name(struct dataset *ds, char *membername,
 	*member = NULL;
 	rc = lzds_dataset_alloc_memberiterator(ds, &it);
 	if (rc)
-		return ENOMEM;
+		return rc;
 	while (!lzds_memberiterator_get_next_member(it, &tmpmember)) {
 		if (!strcmp(tmpmember->name, membername)) {
 			*member = tmpmember;
@@ -2590,22 +2892,165 @@ int lzds_dataset_get_member_by_name(struct dataset *ds, char *membername,
 	return 0;
 }
 
+/**
+ * @brief Helper function that waits for the completion of a read-ahead
+ *        request.
+ *
+ * @param[in]  req  The read-ahead request.
+ * @return     0 if the complete track frame has been read, otherwise EIO.
+ */
+static int readahead_wait(struct readahead *req)
+{
+	const struct aiocb *list[1] = { &req->cb };
+	ssize_t count;
+	int rc;
+
+	while (aio_error(&req->cb) == EINPROGRESS)
+		aio_suspend(list, 1, NULL);
+	rc = aio_error(&req->cb);
+	count = aio_return(&req->cb);
+	if (rc || count != (ssize_t)req->cb.aio_nbytes)
+		return EIO;
+	return 0;
+}
+
+/**
+ * @brief Helper function that drops all outstanding read-ahead requests
+ *        of a read position.
+ *
+ * The requests are not canceled with aio_cancel, because the requests of
+ * other read positions for the same device can get lost when it is called
+ * while they are queued. We just wait for the requests instead, which
+ * takes at most dsh->readahead track frame reads.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ */
+static void readpos_cancel_readahead(struct dshandle *dsh, struct readpos *rp)
+{
+	struct readahead *req;
+
+	while (rp->ra_count) {
+		req = &rp->ra[rp->ra_first];
+		readahead_wait(req);
+		rp->ra_first = (rp->ra_first + 1) % dsh->readahead;
+		rp->ra_count--;
+	}
+	rp->ra_first = 0;
+}
+
+/**
+ * @brief Helper function that frees the read-ahead buffers of a read
+ *        position.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ */
+static void readpos_free_readahead(struct dshandle *dsh, struct readpos *rp)
+{
+	unsigned int i;
+
+	if (!rp->ra)
+		return;
+	readpos_cancel_readahead(dsh, rp);
+	for (i = 0; i < dsh->readahead; ++i)
+		free(rp->ra[i].rawbuffer);
+	free(rp->ra);
+	rp->ra = NULL;
+}
+
+/**
+ * @brief Helper function that allocates dsh->readahead read-ahead buffers
+ *        for a read position.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate the buffers due to lack of memory.
+ */
+static int readpos_alloc_readahead(struct dshandle *dsh, struct readpos *rp)
+{
+	struct readahead *ra;
+	unsigned int i;
+
+	if (!dsh->readahead)
+		return 0;
+	ra = malloc(dsh->readahead * sizeof(*ra));
+	if (!ra)
+		return ENOMEM;
+	memset(ra, 0, dsh->readahead * sizeof(*ra));
+	for (i = 0; i < dsh->readahead; ++i) {
+		/* track buffer must be page aligned for O_DIRECT */
+		ra[i].rawbuffer = memalign(4096, dsh->rawbufmax);
+		if (!ra[i].rawbuffer) {
+			while (i--)
+				free(ra[i].rawbuffer);
+			free(ra);
+			return ENOMEM;
+		}
+	}
+	rp->ra = ra;
+	rp->ra_first = 0;
+	rp->ra_count = 0;
+	return 0;
+}
+
+/**
+ * @brief Helper function that frees all buffers of a read position.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ */
+static void readpos_free(struct dshandle *dsh, struct readpos *rp)
+{
+	readpos_free_readahead(dsh, rp);
+	free(rp->databuffer);
+	free(rp->rawbuffer);
+	memset(rp, 0, sizeof(*rp));
+}
+
+/**
+ * @brief Helper function that allocates all buffers of a read position.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate the buffers due to lack of memory.
+ */
+static int readpos_alloc(struct dshandle *dsh, struct readpos *rp)
+{
+	memset(rp, 0, sizeof(*rp));
+	/* track buffer must be page aligned for O_DIRECT */
+	rp->rawbuffer = memalign(4096, dsh->rawbufmax);
+	rp->databuffer = malloc(dsh->databufmax);
+	if (!rp->rawbuffer || !rp->databuffer ||
+	    readpos_alloc_readahead(dsh, rp)) {
+		readpos_free(dsh, rp);
+		return ENOMEM;
+	}
+	return 0;
+}
+
 /**
  * @param[in] dsh Pointer to structure that is to be freed.
  */
 void lzds_dshandle_free(struct dshandle *dsh)
 {
+	unsigned int j;
 	int i;
 
 	if (!dsh)
 		return;
+	for (j = 0; j < dsh->reader_count; ++j)
+		readpos_free(dsh, &dsh->readers[j]);
+	readpos_free(dsh, &dsh->pos);
 	for (i = 0; i < MAXVOLUMESPERDS; ++i)
 		if (dsh->dasdhandle[i])
 			lzds_dasdhandle_free(dsh->dasdhandle[i]);
-	free(dsh->databuffer);
-	free(dsh->rawbuffer);
 	if (dsh->seekbuf)
 		free(dsh->seekbuf);
+	pthread_cond_destroy(&dsh->cond);
+	pthread_mutex_destroy(&dsh->lock);
 	errorlog_free(dsh->log);
 	free(dsh);
 }
@@ -2630,6 +3075,8 @@ int lzds_dataset_alloc_dshandle(struct dataset *ds,
 	if (!dshtmp)
 		return ENOMEM;
 	memset(dshtmp, 0, sizeof(*dshtmp));
+	pthread_mutex_init(&dshtmp->lock, NULL);
+	pthread_cond_init(&dshtmp->cond, NULL);
 	for (i = 0; i < ds->dspcount; ++i) {
 		rc = lzds_dasd_alloc_dasdhandle(ds->dsp[i]->dasdi,
 						&dshtmp->dasdhandle[i]);
@@ -2643,16 +3090,8 @@ int lzds_dataset_alloc_dshandle(struct dataset *ds,
 	else
 		dshtmp->tracks_per_frame = TRACK_BUFFER_DEFAULT;
 	dshtmp->rawbufmax = dshtmp->tracks_per_frame * RAWTRACKSIZE;
-	/* track buffer must be page aligned for O_DIRECT */
-	dshtmp->rawbuffer = memalign(4096, dshtmp->rawbufmax);
-	if (!dshtmp->rawbuffer) {
-		lzds_dshandle_free(dshtmp);
-		return ENOMEM;
-	}
-
 	dshtmp->databufmax = dshtmp->tracks_per_frame * MAXRECSIZE;
-	dshtmp->databuffer = malloc(dshtmp->databufmax);
-	if (!dshtmp->databuffer) {
+	if (readpos_alloc(dshtmp, &dshtmp->pos)) {
 		lzds_dshandle_free(dshtmp);
 		return ENOMEM;
 	}
@@ -2694,6 +3133,7 @@ int lzds_dshandle_set_seekbuffer(struct dshandle *dsh,
 	dsh->seekbuf = NULL;
 	dsh->seek_count = 0;
 	dsh->seek_current = 0;
+	dsh->seek_saved = 0;
 	dsh->skip = 0;
 
 	if (!seek_buffer_size)
@@ -2727,6 +3167,332 @@ int lzds_dshandle_set_seekbuffer(struct dshandle *dsh,
 }
 
 
+/**
+ * @brief Helper function that updates a 64 bit FNV-1a hash with a buffer.
+ */
+static unsigned long long fnv1a_hash(unsigned long long hash,
+				     const void *buf, size_t size)
+{
+	const unsigned char *ptr = buf;
+
+	while (size--) {
+		hash ^= *ptr++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/**
+ * @brief Subroutine of the seek index functions
+ *
+ * Compute the key of the persistent seek index of the dshandle. The key
+ * covers everything that the seek elements depend on: The volume serials,
+ * the extents and the format 1 DSCB fields of all data set parts that
+ * change when the data set is extended or rewritten, the member and the
+ * settings of the dshandle that affect the track frames and the data
+ * offsets. Fields that change when the data set is only read, like the
+ * date of last reference, are not part of the key.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @return     The key of the seek index.
+ */
+static unsigned long long dshandle_seekindex_key(struct dshandle *dsh)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	struct datasetpart *dsp;
+	format1_label_t *f1;
+	int i;
+
+	hash = fnv1a_hash(hash, &dsh->tracks_per_frame,
+			  sizeof(dsh->tracks_per_frame));
+	hash = fnv1a_hash(hash, &dsh->keepRDW, sizeof(dsh->keepRDW));
+	hash = fnv1a_hash(hash, &dsh->skip, sizeof(dsh->skip));
+	hash = fnv1a_hash(hash, &dsh->seek_count, sizeof(dsh->seek_count));
+	for (i = 0; i < dsh->ds->dspcount; ++i) {
+		dsp = dsh->ds->dsp[i];
+		if (dsp->dasdi->vlabel)
+			hash = fnv1a_hash(hash, dsp->dasdi->vlabel->volid,
+					  sizeof(dsp->dasdi->vlabel->volid));
+		f1 = dsp->f1;
+		hash = fnv1a_hash(hash, f1->DS1DSNAM, sizeof(f1->DS1DSNAM));
+		hash = fnv1a_hash(hash, f1->DS1DSSN, sizeof(f1->DS1DSSN));
+		hash = fnv1a_hash(hash, &f1->DS1VOLSQ, sizeof(f1->DS1VOLSQ));
+		hash = fnv1a_hash(hash, &f1->DS1CREDT, sizeof(f1->DS1CREDT));
+		hash = fnv1a_hash(hash, &f1->DS1NOEPV, sizeof(f1->DS1NOEPV));
+		hash = fnv1a_hash(hash, &f1->DS1DSRG1, sizeof(f1->DS1DSRG1));
+		hash = fnv1a_hash(hash, &f1->DS1RECFM, sizeof(f1->DS1RECFM));
+		hash = fnv1a_hash(hash, &f1->DS1BLKL, sizeof(f1->DS1BLKL));
+		hash = fnv1a_hash(hash, &f1->DS1LRECL, sizeof(f1->DS1LRECL));
+		hash = fnv1a_hash(hash, &f1->DS1KEYL, sizeof(f1->DS1KEYL));
+		hash = fnv1a_hash(hash, &f1->DS1DSIND, sizeof(f1->DS1DSIND));
+		hash = fnv1a_hash(hash, &f1->DS1LSTAR, sizeof(f1->DS1LSTAR));
+		hash = fnv1a_hash(hash, &f1->DS1TRBAL, sizeof(f1->DS1TRBAL));
+		hash = fnv1a_hash(hash, dsp->ext, sizeof(dsp->ext));
+	}
+	if (dsh->member) {
+		hash = fnv1a_hash(hash, dsh->member->name,
+				  sizeof(dsh->member->name));
+		hash = fnv1a_hash(hash, &dsh->member->track,
+				  sizeof(dsh->member->track));
+		hash = fnv1a_hash(hash, &dsh->member->record,
+				  sizeof(dsh->member->record));
+	}
+	return hash;
+}
+
+/**
+ * @brief Subroutine of the seek index functions
+ *
+ * Read and verify the header of a persistent seek index file.
+ *
+ * @param[in]  fd   File descriptor of the seek index file.
+ * @param[in]  key  The expected key.
+ * @param[out] hdr  The header that has been read.
+ * @return     1 if the header is valid, 0 otherwise.
+ */
+static int seekindex_read_header(int fd, unsigned long long key,
+				 struct seekindex_header *hdr)
+{
+	if (read(fd, hdr, sizeof(*hdr)) != sizeof(*hdr))
+		return 0;
+	return !memcmp(hdr->magic, SEEKINDEX_MAGIC, sizeof(hdr->magic)) &&
+		hdr->key == key &&
+		hdr->elemsize == sizeof(struct seekindex_element);
+}
+
+/**
+ * @brief Subroutine of the seek index functions
+ *
+ * Allocate the path name of the seek index file for the dshandle.
+ *
+ * @param[in]  dir  The directory that contains the seek index files.
+ * @param[in]  key  The key of the seek index.
+ * @return     The path name or NULL, if no memory could be allocated.
+ */
+static char *seekindex_path(const char *dir, unsigned long long key)
+{
+	size_t size;
+	char *path;
+
+	size = strlen(dir) + sizeof("/") + 16;
+	path = malloc(size);
+	if (path)
+		snprintf(path, size, "%s/%016llx", dir, key);
+	return path;
+}
+
+/**
+ * Positions in data sets with variable record lengths can only be found
+ * by interpreting all data before them. The seek buffer, which is built
+ * while the data set is read, can therefore be stored in a directory and
+ * loaded again to allow fast seeks right after the data set has been
+ * opened the next time, for example after a new mount.
+ *
+ * The seek index is identified by a key that covers the volume serials,
+ * the extents and the relevant format 1 DSCB fields of the data set, the
+ * member and the settings of the dshandle. A seek index that does not match the current
+ * state of the data set is ignored.
+ *
+ * @pre The dsh must be open, so that all settings are final.
+ *
+ * @param[in] dsh  The dshandle we want to modify.
+ * @param[in] dir  The directory that contains the seek index files.
+ * @return     0 on success or if there is no matching seek index,
+ *             otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate internal structure due to lack of memory.
+ *   - EINVAL  The handle is not open.
+ *   - EIO     The seek index could not be read.
+ */
+int lzds_dshandle_load_seekbuffer(struct dshandle *dsh, const char *dir)
+{
+	struct seekindex_header hdr;
+	struct seekindex_element *buf;
+	unsigned long long key, i;
+	ssize_t size;
+	char *path;
+	int fd, rc;
+
+	errorlog_clear(dsh->log);
+	if (!dsh->is_open)
+		return errorlog_add_message(
+			&dsh->log, NULL, EINVAL,
+			"load seek index: dshandle is not open\n");
+	if (!dsh->seekbuf)
+		return 0;
+	key = dshandle_seekindex_key(dsh);
+	path = seekindex_path(dir, key);
+	if (!path)
+		return ENOMEM;
+	fd = open(path, O_RDONLY);
+	free(path);
+	if (fd < 0)
+		return 0;
+	rc = 0;
+	if (!seekindex_read_header(fd, key, &hdr) ||
+	    hdr.count > dsh->seek_count || hdr.count <= dsh->seek_current)
+		goto out_close;
+	size = hdr.count * sizeof(*buf);
+	buf = malloc(size);
+	if (!buf) {
+		rc = ENOMEM;
+		goto out_close;
+	}
+	if (read(fd, buf, size) != size) {
+		rc = errorlog_add_message(
+			&dsh->log, NULL, EIO,
+			"load seek index: could not read seek index for "
+			"data set %s\n", dsh->ds->name);
+		goto out_free;
+	}
+	for (i = 0; i < hdr.count; ++i) {
+		dsh->seekbuf[i].dsp_no = buf[i].dsp_no;
+		dsh->seekbuf[i].ext_seq_no = buf[i].ext_seq_no;
+		dsh->seekbuf[i].bufstarttrk = buf[i].bufstarttrk;
+		dsh->seekbuf[i].databufoffset = buf[i].databufoffset;
+	}
+	dsh->seek_current = hdr.count;
+	dsh->seek_saved = hdr.count;
+out_free:
+	free(buf);
+out_close:
+	close(fd);
+	return rc;
+}
+
+/**
+ * Store the seek buffer in a persistent seek index file in directory dir,
+ * so that it can be loaded with lzds_dshandle_load_seekbuffer later. The
+ * seek index is only written if the seek buffer contains more elements
+ * than an existing seek index for the same data set. The file is replaced
+ * atomically, so that concurrent readers never see a partial seek index.
+ *
+ * @param[in] dsh  The dshandle with the seek buffer.
+ * @param[in] dir  The directory that contains the seek index files.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate internal structure due to lack of memory.
+ *   - EIO     The seek index could not be written.
+ */
+int lzds_dshandle_save_seekbuffer(struct dshandle *dsh, const char *dir)
+{
+	struct seekindex_element *buf;
+	struct seekindex_header hdr;
+	char *path, *tmppath;
+	unsigned long long key, i;
+	ssize_t size;
+	int fd, rc;
+
+	errorlog_clear(dsh->log);
+	if (!dsh->seekbuf || dsh->seek_current <= dsh->seek_saved)
+		return 0;
+	key = dshandle_seekindex_key(dsh);
+	path = seekindex_path(dir, key);
+	if (!path)
+		return ENOMEM;
+	/* keep an existing seek index that is at least as complete */
+	fd = open(path, O_RDONLY);
+	if (fd >= 0) {
+		rc = seekindex_read_header(fd, key, &hdr);
+		close(fd);
+		if (rc && hdr.count >= dsh->seek_current) {
+			dsh->seek_saved = dsh->seek_current;
+			free(path);
+			return 0;
+		}
+	}
+	tmppath = malloc(strlen(path) + sizeof(".XXXXXX"));
+	if (!tmppath) {
+		free(path);
+		return ENOMEM;
+	}
+	sprintf(tmppath, "%s.XXXXXX", path);
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SEEKINDEX_MAGIC, sizeof(hdr.magic));
+	hdr.key = key;
+	hdr.elemsize = sizeof(*buf);
+	hdr.count = dsh->seek_current;
+	size = hdr.count * sizeof(*buf);
+	buf = malloc(size);
+	if (!buf) {
+		free(tmppath);
+		free(path);
+		return ENOMEM;
+	}
+	memset(buf, 0, size);
+	for (i = 0; i < hdr.count; ++i) {
+		buf[i].dsp_no = dsh->seekbuf[i].dsp_no;
+		buf[i].ext_seq_no = dsh->seekbuf[i].ext_seq_no;
+		buf[i].bufstarttrk = dsh->seekbuf[i].bufstarttrk;
+		buf[i].databufoffset = dsh->seekbuf[i].databufoffset;
+	}
+	rc = 0;
+	fd = mkstemp(tmppath);
+	if (fd < 0) {
+		rc = EIO;
+		goto out;
+	}
+	if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    write(fd, buf, size) != size)
+		rc = EIO;
+	if (close(fd))
+		rc = EIO;
+	if (!rc && rename(tmppath, path))
+		rc = EIO;
+	if (rc)
+		unlink(tmppath);
+	else
+		dsh->seek_saved = dsh->seek_current;
+out:
+	free(buf);
+	free(tmppath);
+	free(path);
+	if (rc)
+		return errorlog_add_message(
+			&dsh->log, NULL, rc,
+			"save seek index: could not write seek index for "
+			"data set %s to %s\n", dsh->ds->name, dir);
+	return 0;
+}
+
+/**
+ * While data is read from a data set, the following track frames can be
+ * read ahead asynchronously, so that reading from the DASD overlaps with
+ * the interpretation of the track data and the processing by the caller.
+ * Each read-ahead track frame requires an additional raw track buffer of
+ * the size tracks_per_frame * RAWTRACKSIZE. This applies to the sequential
+ * read position and to each read position of lzds_dshandle_pread.
+ *
+ * @pre The dsh must not be open when this function is called.
+ *
+ * @param[in] dsh       The dshandle we want to modify.
+ * @param[in] readahead The maximum number of track frames that are read
+ *                      ahead. If 0, no data is read ahead. The value must
+ *                      not exceed MAXREADAHEAD.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate internal structure due to lack of memory.
+ *   - EBUSY   The handle is already open.
+ *   - EINVAL  The readahead value is larger than MAXREADAHEAD.
+ */
+int lzds_dshandle_set_readahead(struct dshandle *dsh, unsigned int readahead)
+{
+	errorlog_clear(dsh->log);
+	if (dsh->is_open)
+		return errorlog_add_message(
+			&dsh->log, NULL, EBUSY,
+			"dshandle: cannot set read-ahead while handle is open\n");
+	if (readahead > MAXREADAHEAD)
+		return errorlog_add_message(
+			&dsh->log, NULL, EINVAL,
+			"dshandle: read-ahead of %u track frames exceeds the "
+			"maximum of %u\n", readahead, MAXREADAHEAD);
+	readpos_free_readahead(dsh, &dsh->pos);
+	dsh->readahead = readahead;
+	if (readpos_alloc_readahead(dsh, &dsh->pos)) {
+		dsh->readahead = 0;
+		return ENOMEM;
+	}
+	return 0;
+}
+
 /**
  * If dsh points to a partitioned data set, the library needs to know
  * which member of that PDS should be read. So this function must be
@@ -2816,14 +3582,18 @@ void lzds_dshandle_get_keepRDW(struct dshandle *dsh, int *keepRDW)
 }
 
 /**
- * @brief Helper function that initializes the given handle so that it
- *        points to the beginning of the dataset or member.
+ * @brief Helper function that initializes the given read position so that
+ *        it points to the beginning of the dataset or member.
  *
  * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ * @param[out] log  The error log for error messages.
  * @return     0 on success, otherwise one of the following error codes:
  *   - EPROTO  The dataset data is inconsistent.
  */
-static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
+static int initialize_buffer_positions_for_first_read(struct dshandle *dsh,
+						      struct readpos *rp,
+						      struct errorlog **log)
 {
 
 	unsigned long long tracksum, extentsize;
@@ -2831,10 +3601,10 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
 	int j;
 
 	/* make sure that read knows that we have no ready data in our buffer */
-	dsh->bufpos = 0;
-	dsh->databufsize = 0;
-	dsh->databufoffset = 0;
-	dsh->eof_reached = 0;
+	rp->bufpos = 0;
+	rp->databufsize = 0;
+	rp->databufoffset = 0;
+	rp->eof_reached = 0;
 
 	/* we need to set the bufendtrk and sequence number so,
 	 * that the current track buffer seems to end with the
@@ -2843,24 +3613,24 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
 	 */
 
 	/* When we read the first track frame this will be incremented to 0 */
-	dsh->frameno = -1;
+	rp->frameno = -1;
 
 	/* We allways start with data set part 0. Partitioned
 	 * data sets have only one part, so this correct for
 	 * both partitioned and non partitioned data sets.
 	 */
-	dsh->dsp_no = 0;
+	rp->dsp_no = 0;
 
 	/* for a non partitioned data set we just need to set the
 	 * extentsequence number to -1 so read will start with the
 	 * first track of extent number 0
 	 */
 	if (!dsh->member) {
-		dsh->ext_seq_no = -1;
-		dsh->bufstarttrk = 0;
-		dsh->bufendtrk = 0;
-		dsh->extstarttrk = 0;
-		dsh->extendtrk = 0;
+		rp->ext_seq_no = -1;
+		rp->bufstarttrk = 0;
+		rp->bufendtrk = 0;
+		rp->extstarttrk = 0;
+		rp->extendtrk = 0;
 		return 0;
 	}
 
@@ -2869,7 +3639,7 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
 	 */
 	if (dsh->ds->dspcount != 1)
 		return errorlog_add_message(
-			&dsh->log, NULL, EPROTO,
+			log, NULL, EPROTO,
 			"initialize read buffer: dataset %s is inconsistent,"
 			" PDS must not span more than one volume\n",
 			dsh->ds->name);
@@ -2879,7 +3649,7 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
 	 * record offset will be set explicitly and handled during
 	 * track interpretation.
 	 */
-	dsh->startrecord = dsh->member->record;
+	rp->startrecord = dsh->member->record;
 
 	/* member->track is an offset based on the start of the data set
 	 * I will have to add up extents until I have got the right number
@@ -2905,9 +3675,9 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
 		 * first extend.
 		 */
 		if (dsh->member->track == tracksum) {
-			dsh->ext_seq_no = j - 1;
-			dsh->bufendtrk = 0;
-			dsh->extendtrk = 0;
+			rp->ext_seq_no = j - 1;
+			rp->bufendtrk = 0;
+			rp->extendtrk = 0;
 			break;
 		}
 		/* If the offset is within the current extent an not the
@@ -2916,11 +3686,11 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
 		 * our target track
 		 */
 		if (dsh->member->track < tracksum + extentsize) {
-			dsh->ext_seq_no = j;
-			dsh->extstarttrk = starttrck;
-			dsh->extendtrk = endtrck;
-			dsh->bufstarttrk = dsh->extstarttrk;
-			dsh->bufendtrk = dsh->bufstarttrk +
+			rp->ext_seq_no = j;
+			rp->extstarttrk = starttrck;
+			rp->extendtrk = endtrck;
+			rp->bufstarttrk = rp->extstarttrk;
+			rp->bufendtrk = rp->bufstarttrk +
 				(dsh->member->track - tracksum) - 1;
 			break;
 		}
@@ -2935,7 +3705,14 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
  */
 void lzds_dshandle_close(struct dshandle *dsh)
 {
+	unsigned int j;
 	int i;
+
+	/* outstanding requests must not refer to closed file descriptors */
+	readpos_cancel_readahead(dsh, &dsh->pos);
+	for (j = 0; j < dsh->reader_count; ++j)
+		readpos_free(dsh, &dsh->readers[j]);
+	dsh->reader_count = 0;
 	for (i = 0; i < MAXVOLUMESPERDS; ++i)
 		if (dsh->dasdhandle[i])
 			lzds_dasdhandle_close(dsh->dasdhandle[i]);
@@ -2980,7 +3757,8 @@ int lzds_dshandle_open(struct dshandle *dsh)
 			NULL, EINVAL,
 			"data set open: a member must be set"
 			" before PDS %s can be opened\n", dsh->ds->name);
-	rc = initialize_buffer_positions_for_first_read(dsh);
+	rc = initialize_buffer_positions_for_first_read(dsh, &dsh->pos,
+							&dsh->log);
 	if (rc)
 		return errorlog_add_message(
 			&dsh->log,
@@ -3007,14 +3785,17 @@ int lzds_dshandle_open(struct dshandle *dsh)
  * @brief subroutine of dshandle_extract_data_from_trackbuffer
  *
  * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
  * @param[in]  rec         Pointer to the raw record.
  * @param[in]  targetdata  Pointer to the data buffer.
+ * @param[out] log  The error log for error messages.
  * @return     Number of copied data bytes on success,
  *             otherwise one of the following (negative) error codes:
  *   - -EPROTO  The record is malformed.
  */
-static ssize_t parse_fixed_record(struct dshandle *dsh,
-				  char *rec, char *targetdata)
+static ssize_t parse_fixed_record(struct dshandle *dsh, struct readpos *rp,
+				  char *rec, char *targetdata,
+				  struct errorlog **log)
 {
 	struct eckd_count *ecount;
 
@@ -3023,9 +3804,9 @@ static ssize_t parse_fixed_record(struct dshandle *dsh,
 	 * the data buffer
 	 */
 	if ((unsigned long)targetdata + ecount->dl >
-	    (unsigned long)dsh->databuffer + dsh->databufmax)
+	    (unsigned long)rp->databuffer + dsh->databufmax)
 		return - errorlog_add_message(
-			&dsh->log, NULL, EPROTO,
+			log, NULL, EPROTO,
 			"fixed record to long for target buffer\n");
 	memcpy(targetdata, (rec + sizeof(*ecount) + ecount->kl), ecount->dl);
 	return ecount->dl;
@@ -3035,16 +3816,19 @@ static ssize_t parse_fixed_record(struct dshandle *dsh,
  * @brief subroutine of dshandle_extract_data_from_trackbuffer
  *
  * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
  * @param[in]  rec         Pointer to the raw record.
  * @param[in]  targetdata  Pointer to the data buffer.
  * @param[in]  keepRDW     Flag that specifies if the RDW should be copied to
  *                         the data buffer or or not.
+ * @param[out] log  The error log for error messages.
  * @return     Number of copied data bytes on success,
  *             otherwise one of the following (negative) error codes:
  *   - -EPROTO  The record is malformed.
  */
-static ssize_t parse_variable_record(struct dshandle *dsh, char *rec,
-				     char *targetdata, int keepRDW)
+static ssize_t parse_variable_record(struct dshandle *dsh, struct readpos *rp,
+				     char *rec, char *targetdata, int keepRDW,
+				     struct errorlog **log)
 {
 	struct eckd_count *ecount;
 	unsigned int blocklength, segmentlength, residual;
@@ -3067,7 +3851,7 @@ static ssize_t parse_variable_record(struct dshandle *dsh, char *rec,
 	 */
 	if (ecount->dl < sizeof(struct segment_header))
 		return - errorlog_add_message(
-			&dsh->log, NULL, EPROTO,
+			log, NULL, EPROTO,
 			"variable record parser: record length to small\n");
 	data = (rec + sizeof(*ecount) + ecount->kl);
 	blockhead = (struct segment_header *)data;
@@ -3080,7 +3864,7 @@ static ssize_t parse_variable_record(struct dshandle *dsh, char *rec,
 	 * large to fit in the data area, then the block descriptor is broken */
 	if ((blocklength < sizeof(*blockhead)) || (blocklength > ecount->dl))
 		return - errorlog_add_message(
-			&dsh->log, NULL, EPROTO,
+			log, NULL, EPROTO,
 			"variable record parser: block length to small\n");
 	data += sizeof(*blockhead);
 	residual = blocklength - sizeof(*blockhead);
@@ -3098,7 +3882,7 @@ static ssize_t parse_variable_record(struct dshandle *dsh, char *rec,
 		if ((residual < segmentlength) ||
 		    (segmentlength < sizeof(*seghead)))
 			return - errorlog_add_message(
-				&dsh->log, NULL, EPROTO,
+				log, NULL, EPROTO,
 				"variable record parser: segment length %d "
 				"inconsistent at offset %lu\n",
 				segmentlength,
@@ -3112,9 +3896,9 @@ static ssize_t parse_variable_record(struct dshandle *dsh, char *rec,
 		 * the data buffer
 		 */
 		if ((unsigned long)targetdata + segmentlength >
-		    (unsigned long)dsh->databuffer + dsh->databufmax)
+		    (unsigned long)rp->databuffer + dsh->databufmax)
 			return - errorlog_add_message(
-				&dsh->log, NULL, EPROTO,
+				log, NULL, EPROTO,
 				"variable record parser: "
 				"record to long for target buffer\n");
 		memcpy(targetdata, data, segmentlength);
@@ -3126,16 +3910,20 @@ static ssize_t parse_variable_record(struct dshandle *dsh, char *rec,
 }
 
 /**
- * @brief subroutine of lzds_dshandle_read
+ * @brief subroutine of dshandle_read
  *
- * Parses the raw track buffer in dsh and copies the user data to
- * the databuffer in dsh.
+ * Parses the raw track buffer of the read position and copies the user
+ * data to its databuffer.
  *
  * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ * @param[out] log  The error log for error messages.
  * @return     0 on success, otherwise one of the following error codes:
  *   - EPROTO  The raw track data is malformed.
  */
-static int dshandle_extract_data_from_trackbuffer(struct dshandle *dsh)
+static int dshandle_extract_data_from_trackbuffer(struct dshandle *dsh,
+						  struct readpos *rp,
+						  struct errorlog **log)
 {
 	char *track;
 	size_t i, trckcount;
@@ -3146,44 +3934,46 @@ static int dshandle_extract_data_from_trackbuffer(struct dshandle *dsh)
 	ssize_t tdsize;
 
 	DS1RECFM = dsh->ds->dsp[0]->f1->DS1RECFM;
-	trckcount = dsh->rawbufsize / RAWTRACKSIZE;
-	track = dsh->rawbuffer;
-	targetdata = dsh->databuffer;
-	dsh->databufsize = 0;
+	trckcount = rp->rawbufsize / RAWTRACKSIZE;
+	track = rp->rawbuffer;
+	targetdata = rp->databuffer;
+	rp->databufsize = 0;
 	/* Record zero is not part of the regular data, so I must not copy its
 	 * data. In case of a PDS member, we may need to skip a few extra
 	 * records on the first track. In this case startrecord is already set
 	 * and will be reset to 1 after the first track has been read.
 	 */
-	if (!dsh->startrecord)
-		dsh->startrecord = 1;
-	for (i = 0; i < trckcount && !dsh->eof_reached; ++i) {
+	if (!rp->startrecord)
+		rp->startrecord = 1;
+	for (i = 0; i < trckcount && !rp->eof_reached; ++i) {
 		record = 0;
 		rawdata = track;
-		while (!dsh->eof_reached) {
+		while (!rp->eof_reached) {
 			tdsize = 0;
-			if (record >= dsh->startrecord) {
+			if (record >= rp->startrecord) {
 				/* fixed or undefined record size */
 				if ((DS1RECFM & 0x80))
-					tdsize = parse_fixed_record(dsh,
+					tdsize = parse_fixed_record(dsh, rp,
 								    rawdata,
-								    targetdata);
+								    targetdata,
+								    log);
 				/* variable records */
 				if (!(DS1RECFM & 0x80) && (DS1RECFM & 0x40))
-					tdsize = parse_variable_record(dsh,
+					tdsize = parse_variable_record(dsh, rp,
 								       rawdata,
 								    targetdata,
-								  dsh->keepRDW);
+								  dsh->keepRDW,
+								       log);
 				if (tdsize < 0)
 					return errorlog_add_message(
-						&dsh->log, dsh->log, EPROTO,
+						log, *log, EPROTO,
 						"data extraction: error at "
 						"record %u, offset %lu\n",
 						record,
 						(unsigned long)rawdata
-						- (unsigned long)dsh->rawbuffer);
+						- (unsigned long)rp->rawbuffer);
 				targetdata += tdsize;
-				dsh->databufsize += tdsize;
+				rp->databufsize += tdsize;
 			}
 			ecount = (struct eckd_count *)rawdata;
 			rawdata += sizeof(*ecount) + ecount->kl + ecount->dl;
@@ -3191,20 +3981,20 @@ static int dshandle_extract_data_from_trackbuffer(struct dshandle *dsh)
 			 * We need to take startrecord into account or we might
 			 * find the end marker of the previous member.
 			 */
-			if ((record >= dsh->startrecord) &&
+			if ((record >= rp->startrecord) &&
 			    (!ecount->kl) && (!ecount->dl))
-				dsh->eof_reached = 1;
+				rp->eof_reached = 1;
 			++record;
 			if ((*(unsigned long long *)rawdata) == ENDTOKEN)
 				break;
 			if ((unsigned long)rawdata >=
 			    (unsigned long)track + RAWTRACKSIZE)
 				return errorlog_add_message(
-					&dsh->log, NULL, EPROTO,
+					log, NULL, EPROTO,
 					"data extraction: run over end of"
 					" track buffer\n");
 		}
-		dsh->startrecord = 1;
+		rp->startrecord = 1;
 		track += RAWTRACKSIZE;
 	}
 	return 0;
@@ -3212,48 +4002,38 @@ static int dshandle_extract_data_from_trackbuffer(struct dshandle *dsh)
 
 
 /**
- * @brief subroutine of lzds_dshandle_read
+ * @brief subroutine of dshandle_prepare_for_next_read_tracks
  *
- * Find the next range of extents and prepare dsh for the next read.
- * The return value indicates whether there is more data to read or not.
- *
- * @pre: For the first call to this function, dsh should be set to the
- *       last track before the first track to read.
- *       If the first track to read is the first track in the dataset
- *       then set dsh->ext_seq_no to -1.
+ * Find the track frame that follows the track frame described by pos.
  *
- * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]     dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in,out] pos  The location of the current track frame as input and
+ *                     the location of the next track frame as output.
  *
  * @return
  *   0 when there is no further raw data available,
- *   1 when there is more data available and dsh is prepared
+ *   1 when there is more data available and pos is updated
  */
-static int dshandle_prepare_for_next_read_tracks(struct dshandle *dsh)
+static int framepos_next(struct dshandle *dsh, struct framepos *pos)
 {
 	int found, dsp_no, ext_seq_no;
 
 	/* If there are still unread tracks in the current extent, we just need
-	 * to point dsh to the next range of tracks
+	 * to point to the next range of tracks
 	 */
-	if (dsh->bufendtrk < dsh->extendtrk) {
-		dsh->bufstarttrk = dsh->bufendtrk + 1;
-		dsh->bufendtrk = dsh->bufstarttrk +
+	if (pos->bufendtrk < pos->extendtrk) {
+		pos->bufstarttrk = pos->bufendtrk + 1;
+		pos->bufendtrk = pos->bufstarttrk +
 			(dsh->rawbufmax / RAWTRACKSIZE) - 1;
-		dsh->bufendtrk = MIN(dsh->bufendtrk, dsh->extendtrk);
-		dsh->rawbufsize = (dsh->bufendtrk - dsh->bufstarttrk + 1)
-			* RAWTRACKSIZE;
-		dsh->databufoffset = dsh->databufoffset + dsh->databufsize;
-		dsh->databufsize = 0;
-		dsh->bufpos = 0;
-		dsh->frameno++;
+		pos->bufendtrk = MIN(pos->bufendtrk, pos->extendtrk);
 		return 1;
 	}
 	/* There are no more tracks left in the current extent.
 	 * Loop over data set parts and extends in these parts until a valid
 	 * extent is found or the end of the data set is reached
 	 */
-	ext_seq_no = dsh->ext_seq_no;
-	dsp_no = dsh->dsp_no;
+	ext_seq_no = pos->ext_seq_no;
+	dsp_no = pos->dsp_no;
 	found = 0;
 	while (!found) {
 		++ext_seq_no;
@@ -3270,160 +4050,292 @@ static int dshandle_prepare_for_next_read_tracks(struct dshandle *dsh)
 	if (!found)
 		return 0;
 	/* We have found the next valid extent. Get lower and upper track
-	 * limits and set dsh to the first range of tracks */
-	dsh->ext_seq_no = ext_seq_no;
-	dsh->dsp_no = dsp_no;
+	 * limits and point to the first range of tracks */
+	pos->ext_seq_no = ext_seq_no;
+	pos->dsp_no = dsp_no;
 	lzds_dasd_cchh2trk(dsh->ds->dsp[dsp_no]->dasdi,
 			&dsh->ds->dsp[dsp_no]->ext[ext_seq_no].llimit,
-			&dsh->extstarttrk);
+			&pos->extstarttrk);
 	lzds_dasd_cchh2trk(dsh->ds->dsp[dsp_no]->dasdi,
 			&dsh->ds->dsp[dsp_no]->ext[ext_seq_no].ulimit,
-			&dsh->extendtrk);
-	dsh->bufstarttrk = dsh->extstarttrk;
-	dsh->bufendtrk = dsh->bufstarttrk + (dsh->rawbufmax / RAWTRACKSIZE) - 1;
-	dsh->bufendtrk = MIN(dsh->bufendtrk, dsh->extendtrk);
-	dsh->rawbufsize = (dsh->bufendtrk - dsh->bufstarttrk + 1)
+			&pos->extendtrk);
+	pos->bufstarttrk = pos->extstarttrk;
+	pos->bufendtrk = pos->bufstarttrk + (dsh->rawbufmax / RAWTRACKSIZE) - 1;
+	pos->bufendtrk = MIN(pos->bufendtrk, pos->extendtrk);
+	return 1;
+}
+
+/**
+ * @brief Helper function that stores the current track frame location of
+ *        the read position rp in pos.
+ */
+static void readpos_get_framepos(struct readpos *rp, struct framepos *pos)
+{
+	pos->dsp_no = rp->dsp_no;
+	pos->ext_seq_no = rp->ext_seq_no;
+	pos->extstarttrk = rp->extstarttrk;
+	pos->extendtrk = rp->extendtrk;
+	pos->bufstarttrk = rp->bufstarttrk;
+	pos->bufendtrk = rp->bufendtrk;
+}
+
+/**
+ * @brief subroutine of dshandle_read
+ *
+ * Find the next range of extents and prepare rp for the next read.
+ * The return value indicates whether there is more data to read or not.
+ *
+ * @pre: For the first call to this function, rp should be set to the
+ *       last track before the first track to read.
+ *       If the first track to read is the first track in the dataset
+ *       then set rp->ext_seq_no to -1.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ *
+ * @return
+ *   0 when there is no further raw data available,
+ *   1 when there is more data available and rp is prepared
+ */
+static int dshandle_prepare_for_next_read_tracks(struct dshandle *dsh,
+						 struct readpos *rp)
+{
+	struct framepos pos;
+
+	readpos_get_framepos(rp, &pos);
+	if (!framepos_next(dsh, &pos))
+		return 0;
+	rp->dsp_no = pos.dsp_no;
+	rp->ext_seq_no = pos.ext_seq_no;
+	rp->extstarttrk = pos.extstarttrk;
+	rp->extendtrk = pos.extendtrk;
+	rp->bufstarttrk = pos.bufstarttrk;
+	rp->bufendtrk = pos.bufendtrk;
+	rp->rawbufsize = (rp->bufendtrk - rp->bufstarttrk + 1)
 			   * RAWTRACKSIZE;
-	dsh->databufoffset = dsh->databufoffset + dsh->databufsize;
-	dsh->databufsize = 0;
-	dsh->bufpos = 0;
-	dsh->frameno++;
+	rp->databufoffset = rp->databufoffset + rp->databufsize;
+	rp->databufsize = 0;
+	rp->bufpos = 0;
+	rp->frameno++;
 	return 1;
 }
 
 /**
- * @brief subroutine of lzds_dshandle_read
+ * @brief subroutine of dshandle_read
+ *
+ * Start asynchronous reads for the track frames that follow the current
+ * track frame or the last track frame that is already being read ahead,
+ * until dsh->readahead requests are outstanding. If a request cannot be
+ * started, the respective track frame will be read synchronously later.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ */
+static void dshandle_submit_readahead(struct dshandle *dsh, struct readpos *rp)
+{
+	struct readahead *req;
+	struct framepos pos;
+
+	if (!dsh->readahead)
+		return;
+	if (rp->ra_count)
+		pos = rp->ra[(rp->ra_first + rp->ra_count - 1) %
+			      dsh->readahead].pos;
+	else
+		readpos_get_framepos(rp, &pos);
+	while (rp->ra_count < dsh->readahead) {
+		if (!framepos_next(dsh, &pos))
+			break;
+		req = &rp->ra[(rp->ra_first + rp->ra_count) %
+			       dsh->readahead];
+		req->pos = pos;
+		memset(&req->cb, 0, sizeof(req->cb));
+		req->cb.aio_fildes = dsh->dasdhandle[pos.dsp_no]->fd;
+		req->cb.aio_buf = req->rawbuffer;
+		req->cb.aio_nbytes = (size_t)(pos.bufendtrk - pos.bufstarttrk
+					      + 1) * RAWTRACKSIZE;
+		req->cb.aio_offset = (off_t)pos.bufstarttrk * RAWTRACKSIZE;
+		req->cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+		if (aio_read(&req->cb))
+			break;
+		rp->ra_count++;
+	}
+}
+
+/**
+ * @brief subroutine of dshandle_read
+ *
+ * Read the raw tracks of the current track frame into the raw track buffer.
+ * If the track frame has been read ahead, the read-ahead buffer is used.
+ * Otherwise, any read-ahead requests are obsolete, for example because of a
+ * seek operation, and the track frame is read synchronously.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ * @param[out] log  The error log for error messages.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  The tracks are not within the boundaries of the DASD.
+ *   - EPROTO  Could not read a full track image
+ *   - EIO     Other I/O error
+ */
+static int dshandle_read_trackframe(struct dshandle *dsh, struct readpos *rp,
+				    struct errorlog **log)
+{
+	struct readahead *req;
+	char *rawbuffer;
+
+	if (rp->ra_count) {
+		req = &rp->ra[rp->ra_first];
+		if (req->pos.dsp_no == rp->dsp_no &&
+		    req->pos.bufstarttrk == rp->bufstarttrk &&
+		    req->pos.bufendtrk == rp->bufendtrk) {
+			rp->ra_first = (rp->ra_first + 1) % dsh->readahead;
+			rp->ra_count--;
+			if (!readahead_wait(req)) {
+				rawbuffer = rp->rawbuffer;
+				rp->rawbuffer = req->rawbuffer;
+				req->rawbuffer = rawbuffer;
+				return 0;
+			}
+			/* repeat the read synchronously to get the error */
+		} else {
+			readpos_cancel_readahead(dsh, rp);
+		}
+	}
+	return dasdhandle_read_tracks(dsh->dasdhandle[rp->dsp_no],
+				      rp->bufstarttrk, rp->bufendtrk,
+				      rp->rawbuffer, log);
+}
+
+/**
+ * @brief subroutine of dshandle_read
  *
  * As we progress in reading data from the dataset, we store
  * track/data offsets in the dshandle for late use by the
  * lzds_dshandle_lseek and related operations.
+ * All read positions of the dshandle store their track frames in the same
+ * seek buffer, so this is done with dsh->lock held.
  *
  * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp   The read position of dsh.
+ * @param[out] log  The error log for error messages.
  *
  * @return     0 on success, otherwise one of the following error codes:
  *   - EPROTO  The existing seek buffer data is inconsistent.
  *   - EINVAL  The existing seek buffer data is inconsistent.
  *   - ERANGE  We try to add more elements than the prepared buffer can hold.
  */
-static int dshandle_store_trackframe(struct dshandle *dsh)
+static int dshandle_store_trackframe(struct dshandle *dsh, struct readpos *rp,
+				     struct errorlog **log)
 {
 	unsigned long long index;
+	int rc;
 
 	/* if we have no skip or seekbuf we cannot store anything */
 	if (!dsh->skip || !dsh->seekbuf)
 		return 0;
 
 	/* if this is a frame we want to skip, just return 0 */
-	if (dsh->frameno % dsh->skip)
+	if (rp->frameno % dsh->skip)
 		return 0;
-	/* make sure we do not access elements beyond the end of the buffer */
-	if (dsh->seek_current >= dsh->seek_count)
-		return errorlog_add_message(
-			&dsh->log,
-			NULL, ERANGE,
-			"store track frame: frame list size is inconsistent\n");
-
+	pthread_mutex_lock(&dsh->lock);
+	rc = 0;
 	/* our seek code relies on the fact that element n refers to frame
 	 * n * skip, so we need to make sure we that we do not leave gaps */
-	index = dsh->frameno / dsh->skip;
-	if (index > dsh->seek_current)
-		return errorlog_add_message(
-			&dsh->log,
-			NULL, EPROTO,
+	index = rp->frameno / dsh->skip;
+	/* make sure we do not access elements beyond the end of the buffer */
+	if (index >= dsh->seek_count)
+		rc = errorlog_add_message(
+			log, NULL, ERANGE,
+			"store track frame: frame list size is inconsistent\n");
+	else if (index > dsh->seek_current)
+		rc = errorlog_add_message(
+			log, NULL, EPROTO,
 			"store track frame: frame list inconsistent\n");
-
-	/* if we have visited this frame before, return */
-	if (index < dsh->seek_current) {
-		if (dsh->seekbuf[index].dsp_no != dsh->dsp_no ||
-		    dsh->seekbuf[index].ext_seq_no != dsh->ext_seq_no ||
-		    dsh->seekbuf[index].bufstarttrk != dsh->bufstarttrk ||
-		    dsh->seekbuf[index].databufoffset != dsh->databufoffset)
-			return errorlog_add_message(
-				&dsh->log,
-				NULL, EINVAL,
+	/* if we have visited this frame before, verify it */
+	else if (index < dsh->seek_current) {
+		if (dsh->seekbuf[index].dsp_no != rp->dsp_no ||
+		    dsh->seekbuf[index].ext_seq_no != rp->ext_seq_no ||
+		    dsh->seekbuf[index].bufstarttrk != rp->bufstarttrk ||
+		    dsh->seekbuf[index].databufoffset != rp->databufoffset)
+			rc = errorlog_add_message(
+				log, NULL, EINVAL,
 				"store track frame: frame data inconsistent\n");
-		else
-			return 0;
+	} else {
+		/* the seek_current = index case */
+		dsh->seekbuf[index].dsp_no = rp->dsp_no;
+		dsh->seekbuf[index].ext_seq_no = rp->ext_seq_no;
+		dsh->seekbuf[index].bufstarttrk = rp->bufstarttrk;
+		dsh->seekbuf[index].databufoffset = rp->databufoffset;
+		dsh->seek_current++;
 	}
-	/* the seek_current = index case */
-	dsh->seekbuf[index].dsp_no = dsh->dsp_no;
-	dsh->seekbuf[index].ext_seq_no = dsh->ext_seq_no;
-	dsh->seekbuf[index].bufstarttrk = dsh->bufstarttrk;
-	dsh->seekbuf[index].databufoffset = dsh->databufoffset;
-	dsh->seek_current++;
-	return 0;
+	pthread_mutex_unlock(&dsh->lock);
+	return rc;
 }
 
 /**
+ * @brief subroutine of lzds_dshandle_read and lzds_dshandle_pread
+ *
+ * Read data from the current offset of a read position.
+ *
  * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp     The read position of dsh.
  * @param[in]  buf    The target buffer for the read data.
  * @param[in]  size   The number of bytes that are to be read.
  * @param[out] rcsize Reference to a variable in which the actual number
  *                    of read bytes is returned.
- *                    If this is 0, the end of the file is reached.
- * @return     0 on success, otherwise one of the following error codes:
- *   - EINVAL  The data in dsh is inconsistent.
- *   - ERANGE  The data in dsh is inconsistent.
- *   - EPROTO  The data read from the disk does not conform to the
- *             expected format.
- *   - EIO     I/O error when reading from device.
+ * @param[out] log    The error log for error messages.
+ * @return     0 on success, otherwise one of the error codes of
+ *             lzds_dshandle_read.
  */
-int lzds_dshandle_read(struct dshandle *dsh, char *buf,
-		       size_t size, ssize_t *rcsize)
+static int dshandle_read(struct dshandle *dsh, struct readpos *rp, char *buf,
+			 size_t size, ssize_t *rcsize, struct errorlog **log)
 {
 	ssize_t copysize;
 	int rc;
 
-	errorlog_clear(dsh->log);
-	if (!dsh->is_open)
-		return errorlog_add_message(
-			&dsh->log, NULL, EINVAL,
-			"data set read: dshandle is not open\n");
 	*rcsize = 0;
 	while (*rcsize < (long long)size) {
-		if (dsh->bufpos >= dsh->databufsize) {
-			/* need to fill dsh data buffer */
-			if (dsh->eof_reached)
+		if (rp->bufpos >= rp->databufsize) {
+			/* need to fill rp data buffer */
+			if (rp->eof_reached)
 				break; /* end of data in data set reached */
-			if (!dshandle_prepare_for_next_read_tracks(dsh))
+			if (!dshandle_prepare_for_next_read_tracks(dsh, rp))
 				break; /* end of data set extents reached */
-			rc = lzds_dasdhandle_read_tracks_to_buffer(
-				dsh->dasdhandle[dsh->dsp_no], dsh->bufstarttrk,
-				dsh->bufendtrk, dsh->rawbuffer);
+			rc = dshandle_read_trackframe(dsh, rp, log);
 			if (rc)
 				return errorlog_add_message(
-					&dsh->log,
-					dsh->dasdhandle[dsh->dsp_no]->log, rc,
+					log, *log, rc,
 					"data set read: error reading data set"
 					" %s\n", dsh->ds->name);
-			rc = dshandle_extract_data_from_trackbuffer(dsh);
+			rc = dshandle_extract_data_from_trackbuffer(dsh, rp,
+								    log);
 			if (rc)
 				return errorlog_add_message(
-					&dsh->log,
-					dsh->log,
-					rc,
+					log, *log, rc,
 					"data set read: extracting data set "
 					"%s from %s, tracks %u to %u\n",
 					dsh->ds->name,
-					dsh->dasdhandle[dsh->dsp_no]->dasd->device,
-					dsh->bufstarttrk,
-					dsh->bufendtrk);
-			rc = dshandle_store_trackframe(dsh);
+					dsh->dasdhandle[rp->dsp_no]->dasd->device,
+					rp->bufstarttrk,
+					rp->bufendtrk);
+			rc = dshandle_store_trackframe(dsh, rp, log);
 			if (rc)
 				return errorlog_add_message(
-					&dsh->log,
-					dsh->log, rc,
+					log, *log, rc,
 					"data set read: storing track frame "
 					"%s\n", dsh->ds->name);
+			if (!rp->eof_reached)
+				dshandle_submit_readahead(dsh, rp);
 		}
 		/* if databuf has data to copy */
-		if (dsh->bufpos < dsh->databufsize) {
+		if (rp->bufpos < rp->databufsize) {
 			/*  copy data from databuf to buf */
 			copysize = MIN(((long long)size - *rcsize),
-				       (dsh->databufsize - dsh->bufpos));
-			memcpy(buf, &dsh->databuffer[dsh->bufpos], copysize);
+				       (rp->databufsize - rp->bufpos));
+			memcpy(buf, &rp->databuffer[rp->bufpos], copysize);
 			buf += copysize;
-			dsh->bufpos += copysize;
+			rp->bufpos += copysize;
 			*rcsize += copysize;
 		}
 	}
@@ -3431,29 +4343,65 @@ int lzds_dshandle_read(struct dshandle *dsh, char *buf,
 }
 
 /**
- * @brief subroutine of lzds_dshandle_lseek
+ * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
+ * @param[in]  buf    The target buffer for the read data.
+ * @param[in]  size   The number of bytes that are to be read.
+ * @param[out] rcsize Reference to a variable in which the actual number
+ *                    of read bytes is returned.
+ *                    If this is 0, the end of the file is reached.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  The data in dsh is inconsistent.
+ *   - ERANGE  The data in dsh is inconsistent.
+ *   - EPROTO  The data read from the disk does not conform to the
+ *             expected format.
+ *   - EIO     I/O error when reading from device.
+ */
+int lzds_dshandle_read(struct dshandle *dsh, char *buf,
+		       size_t size, ssize_t *rcsize)
+{
+	errorlog_clear(dsh->log);
+	*rcsize = 0;
+	if (!dsh->is_open)
+		return errorlog_add_message(
+			&dsh->log, NULL, EINVAL,
+			"data set read: dshandle is not open\n");
+	return dshandle_read(dsh, &dsh->pos, buf, size, rcsize, &dsh->log);
+}
+
+/**
+ * @brief subroutine of dshandle_seek
  *
- * Find the closest buffered seekelement that starts before offset
+ * Find the closest buffered seekelement that starts before offset.
+ * Positional reads may add elements to the seek buffer concurrently,
+ * so the element is copied with dsh->lock held.
  *
  * @param[in]  dsh      The dshandle that keeps track of the I/O operations.
  * @param[in]  offset   The data offset in the dataset that we want to reach.
  * @param[out] se_index Reference to a variable in which the found index
  *                      to dsh->seekbuf is returned.
+ * @param[out] se       Reference to a variable in which a copy of the found
+ *                      seekelement is returned.
  *
  * @return     0 on success, otherwise one of the following error codes:
  *   - EINVAL  There is no seekbuffer available.
  */
 static int dshandle_find_seekelement(struct dshandle *dsh, off_t offset,
-				      long long *se_index)
+				      long long *se_index,
+				      struct seekelement *se)
 {
 	unsigned long long low, high, index;
 
-	if (!dsh->seek_current)
+	pthread_mutex_lock(&dsh->lock);
+	if (!dsh->seek_current) {
+		pthread_mutex_unlock(&dsh->lock);
 		return EINVAL;
+	}
 
 	/* special case for the last element in the list */
 	if (dsh->seekbuf[dsh->seek_current - 1].databufoffset <= offset) {
 		*se_index = dsh->seek_current - 1;
+		*se = dsh->seekbuf[*se_index];
+		pthread_mutex_unlock(&dsh->lock);
 		return 0;
 	}
 	/* search starts with 'high' set to the second to last element */
@@ -3472,25 +4420,31 @@ static int dshandle_find_seekelement(struct dshandle *dsh, off_t offset,
 		}
 	}
 	*se_index = low;
+	*se = dsh->seekbuf[low];
+	pthread_mutex_unlock(&dsh->lock);
 	return 0;
 }
 
 /**
- * @brief subroutine of lzds_dshandle_lseek
+ * @brief subroutine of dshandle_seek
  *
  * Reset the internel buffers etc, so that the next read will read
  * the track frame pointed to by the seekelement.
  *
  * @param[in]  dsh      The dshandle that keeps track of the I/O operations.
- * @param[out] se_index Index to the seekelement in dsh->seekbuf.
+ * @param[in]  rp       The read position of dsh.
+ * @param[in]  se_index Index to the seekelement in dsh->seekbuf.
+ * @param[in]  se       Copy of the seekelement.
  */
 static void dshandle_reset_buffer_position_to_seekelement(
-				      struct dshandle *dsh, long long se_index)
+				      struct dshandle *dsh, struct readpos *rp,
+				      long long se_index,
+				      struct seekelement *se)
 {
 	/* make sure that read knows that we have no ready data in our buffer */
-	dsh->bufpos = 0;
-	dsh->databufsize = 0;
-	dsh->eof_reached = 0;
+	rp->bufpos = 0;
+	rp->databufsize = 0;
+	rp->eof_reached = 0;
 
 	/* we need to set the bufendtrk and sequence number so,
 	 * that the current track buffer seems to end with the
@@ -3499,9 +4453,9 @@ static void dshandle_reset_buffer_position_to_seekelement(
 	 */
 
 	/* framno will be incremented during read, so do a -1 here */
-	dsh->frameno = (se_index * dsh->skip) - 1;
-	dsh->databufoffset = dsh->seekbuf[se_index].databufoffset;
-	dsh->dsp_no = dsh->seekbuf[se_index].dsp_no;
+	rp->frameno = (se_index * dsh->skip) - 1;
+	rp->databufoffset = se->databufoffset;
+	rp->dsp_no = se->dsp_no;
 
 	/* For a partitioned data set we need to find the correct start
 	 * track and point the current buffer just before it.
@@ -3509,8 +4463,8 @@ static void dshandle_reset_buffer_position_to_seekelement(
 	 * record offset will be set explicitly and handled during
 	 * track interpretation.
 	 */
-	if (dsh->member && (dsh->frameno == -1))
-		dsh->startrecord = dsh->member->record;
+	if (dsh->member && (rp->frameno == -1))
+		rp->startrecord = dsh->member->record;
 
 	/* In most cases our track frame will be in the middle of the
 	 * disk, so we set bufendtrk to the last track before our track
@@ -3519,109 +4473,284 @@ static void dshandle_reset_buffer_position_to_seekelement(
 	 * so that the read code will advance to the next extend and
 	 * the first track of that extent
 	 */
-	if (!dsh->seekbuf[se_index].bufstarttrk) {
-		dsh->ext_seq_no = dsh->seekbuf[se_index].ext_seq_no - 1;
-		dsh->bufendtrk = 0;
-		dsh->extendtrk = 0;
+	if (!se->bufstarttrk) {
+		rp->ext_seq_no = se->ext_seq_no - 1;
+		rp->bufendtrk = 0;
+		rp->extendtrk = 0;
 		return;
 	}
 
-	dsh->ext_seq_no = dsh->seekbuf[se_index].ext_seq_no;
+	rp->ext_seq_no = se->ext_seq_no;
 
-	lzds_dasd_cchh2trk(dsh->ds->dsp[dsh->dsp_no]->dasdi,
-			&dsh->ds->dsp[dsh->dsp_no]->ext[dsh->ext_seq_no].llimit,
-			&dsh->extstarttrk);
-	lzds_dasd_cchh2trk(dsh->ds->dsp[dsh->dsp_no]->dasdi,
-			&dsh->ds->dsp[dsh->dsp_no]->ext[dsh->ext_seq_no].ulimit,
-			&dsh->extendtrk);
+	lzds_dasd_cchh2trk(dsh->ds->dsp[rp->dsp_no]->dasdi,
+			&dsh->ds->dsp[rp->dsp_no]->ext[rp->ext_seq_no].llimit,
+			&rp->extstarttrk);
+	lzds_dasd_cchh2trk(dsh->ds->dsp[rp->dsp_no]->dasdi,
+			&dsh->ds->dsp[rp->dsp_no]->ext[rp->ext_seq_no].ulimit,
+			&rp->extendtrk);
 
-	dsh->bufstarttrk = 0;
-	dsh->bufendtrk = dsh->seekbuf[se_index].bufstarttrk - 1;
+	rp->bufstarttrk = 0;
+	rp->bufendtrk = se->bufstarttrk - 1;
 
-	dsh->rawbufsize = 0;
-	dsh->databufoffset = dsh->seekbuf[se_index].databufoffset;
-	dsh->databufsize = 0;
-	dsh->bufpos = 0;
+	rp->rawbufsize = 0;
+	rp->databufoffset = se->databufoffset;
+	rp->databufsize = 0;
+	rp->bufpos = 0;
 	return;
 }
 
 /**
- * It is not possible to seek beyond the end of the data, but an
- * attempt to do so is a common occurrence as we may not know the
- * actual data size beforehand. In this case, the returned rcoffset
- * is smaller than offset and points to the offset directly following
- * the last data byte.
+ * @brief subroutine of lzds_dshandle_lseek and lzds_dshandle_pread
+ *
+ * Move a read position to the given offset.
  *
  * @param[in]  dsh      The dshandle that keeps track of the I/O operations.
+ * @param[in]  rp       The read position of dsh.
  * @param[in]  offset   The data offset in the dataset that we want to reach.
  * @param[out] rcoffset Reference to a variable in which the actual offset
  *                      is returned.
- *
- * @return     0 on success, otherwise one of the following error codes:
- *   - EINVAL  The data in dsh is inconsistent.
- *   - ERANGE  The data in dsh is inconsistent.
- *   - EPROTO  The data read from the disk does not conform to the
- *             expected format.
- *   - EIO     I/O error when reading from device.
+ * @param[out] log      The error log for error messages.
+ * @return     0 on success, otherwise one of the error codes of
+ *             lzds_dshandle_lseek.
  */
-int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
-			long long *rcoffset)
+static int dshandle_seek(struct dshandle *dsh, struct readpos *rp,
+			 long long offset, long long *rcoffset,
+			 struct errorlog **log)
 {
-	char foo;
+	struct seekelement se;
+	long long se_index;
 	ssize_t rcsize;
+	char foo;
 	int rc;
-	long long se_index;
 
-	errorlog_clear(dsh->log);
-	if (dsh->databufoffset <= offset &&
-	    offset < dsh->databufoffset + dsh->databufsize) {
+	if (rp->databufoffset <= offset &&
+	    offset < rp->databufoffset + rp->databufsize) {
 		/* offset is within the current track frame */
-		dsh->bufpos = offset - dsh->databufoffset;
+		rp->bufpos = offset - rp->databufoffset;
 		*rcoffset = offset;
 		return 0;
 	}
 	/* need to seek to some other track frame */
-	if (!dshandle_find_seekelement(dsh, offset, &se_index)) {
+	if (!dshandle_find_seekelement(dsh, offset, &se_index, &se)) {
 		/* do not reset our context if we can seek forward from
 		 * our current position */
-		if (!(dsh->seekbuf[se_index].databufoffset < dsh->databufoffset
-		      && dsh->databufoffset <= offset)) {
-			dshandle_reset_buffer_position_to_seekelement(dsh,
-								      se_index);
+		if (!(se.databufoffset < rp->databufoffset &&
+		      rp->databufoffset <= offset)) {
+			dshandle_reset_buffer_position_to_seekelement(
+				dsh, rp, se_index, &se);
 		}
-	} else if (offset < dsh->databufoffset) {
+	} else if (offset < rp->databufoffset) {
 		/* if we have no seekbuffer, we can only reset to the
 		 * start of the data set */
-		rc = initialize_buffer_positions_for_first_read(dsh);
+		rc = initialize_buffer_positions_for_first_read(dsh, rp, log);
 		if (rc)
 			return errorlog_add_message(
-				&dsh->log,
-				dsh->log, rc,
+				log, *log, rc,
 				"data set seek: error when initializing buffers"
 				" for data set %s\n", dsh->ds->name);
 	}
 	/* from here on we just need to go forward by reading track
 	 * frames until we find a frame that contains the offset
 	 */
-	while (dsh->databufoffset + dsh->databufsize <= offset) {
-		dsh->bufpos = dsh->databufsize;
-		rc = lzds_dshandle_read(dsh, &foo, sizeof(foo), &rcsize);
+	while (rp->databufoffset + rp->databufsize <= offset) {
+		rp->bufpos = rp->databufsize;
+		rc = dshandle_read(dsh, rp, &foo, sizeof(foo), &rcsize, log);
 		if (rc || !rcsize) {
-			*rcoffset = dsh->databufoffset + dsh->databufsize;
+			*rcoffset = rp->databufoffset + rp->databufsize;
 			if (rc)
 				errorlog_add_message(
-					&dsh->log,
-					dsh->log, rc,
+					log, *log, rc,
 					"data set seek: error reading data from"
 					" data set %s\n", dsh->ds->name);
 			return rc;
 		}
 	}
-	dsh->bufpos = offset - dsh->databufoffset;
+	rp->bufpos = offset - rp->databufoffset;
 	*rcoffset = offset;
 	return 0;
 }
 
+/**
+ * It is not possible to seek beyond the end of the data, but an
+ * attempt to do so is a common occurrence as we may not know the
+ * actual data size beforehand. In this case, the returned rcoffset
+ * is smaller than offset and points to the offset directly following
+ * the last data byte.
+ *
+ * @param[in]  dsh      The dshandle that keeps track of the I/O operations.
+ * @param[in]  offset   The data offset in the dataset that we want to reach.
+ * @param[out] rcoffset Reference to a variable in which the actual offset
+ *                      is returned.
+ *
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  The data in dsh is inconsistent.
+ *   - ERANGE  The data in dsh is inconsistent.
+ *   - EPROTO  The data read from the disk does not conform to the
+ *             expected format.
+ *   - EIO     I/O error when reading from device.
+ */
+int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
+			long long *rcoffset)
+{
+	errorlog_clear(dsh->log);
+	return dshandle_seek(dsh, &dsh->pos, offset, rcoffset, &dsh->log);
+}
+
+/**
+ * @brief Helper function that checks if a read position whose track frame
+ *        starts at offset a is better suited to read from offset than one
+ *        whose track frame starts at offset b.
+ *
+ * Read positions before offset only need to read forward.
+ */
+static int readpos_closer(long long a, long long b, long long offset)
+{
+	if (a <= offset)
+		return b > offset || a > b;
+	return b > offset && a < b;
+}
+
+/**
+ * @brief subroutine of lzds_dshandle_pread
+ *
+ * Select a read position for a positional read at offset and mark it busy.
+ * Prefer the idle read position that is closest before offset, so that
+ * sequential readers keep their read position and its read-ahead. Add a
+ * new read position if there is none before offset and the maximum number
+ * of read positions is not reached yet. Wait if all read positions are
+ * busy. Must be called with dsh->lock held.
+ *
+ * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
+ * @param[in]  offset The data offset in the data set to read from.
+ * @param[out] rpp    Reference to a variable in which the selected read
+ *                    position is returned.
+ * @param[out] log    The error log for error messages.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate a new read position.
+ *   - EPROTO  The dataset data is inconsistent.
+ */
+static int dshandle_get_reader(struct dshandle *dsh, long long offset,
+			       struct readpos **rpp, struct errorlog **log)
+{
+	struct readpos *rp, *best;
+	unsigned int i;
+	int rc;
+
+	while (1) {
+		best = NULL;
+		for (i = 0; i < dsh->reader_count; ++i) {
+			rp = &dsh->readers[i];
+			if (rp->busy)
+				continue;
+			if (!best ||
+			    readpos_closer(rp->databufoffset,
+					   best->databufoffset, offset))
+				best = rp;
+		}
+		/* Only move a read position backwards, if no additional
+		 * read position can be added */
+		if (best && (best->databufoffset <= offset ||
+			     dsh->reader_count == MAXREADERS))
+			break;
+		if (dsh->reader_count < MAXREADERS) {
+			best = &dsh->readers[dsh->reader_count];
+			if (readpos_alloc(dsh, best))
+				return errorlog_add_message(
+					log, NULL, ENOMEM,
+					"data set pread: could not allocate "
+					"read buffers\n");
+			rc = initialize_buffer_positions_for_first_read(
+				dsh, best, log);
+			if (rc) {
+				readpos_free(dsh, best);
+				return rc;
+			}
+			dsh->reader_count++;
+			break;
+		}
+		pthread_cond_wait(&dsh->cond, &dsh->lock);
+	}
+	best->busy = 1;
+	*rpp = best;
+	return 0;
+}
+
+/**
+ * Read data from a given offset of the data set, similar to pread(2).
+ * The sequential read position of dsh, which is used by lzds_dshandle_read
+ * and lzds_dshandle_lseek, is not changed.
+ *
+ * Several threads can call this function for the same dshandle at the
+ * same time. Each call uses one of up to MAXREADERS internal read
+ * positions exclusively, preferably one that is positioned just before
+ * offset, so that several sequential streams can be read concurrently with
+ * their own read-ahead. Further calls wait until a read position becomes
+ * available. The read positions share the seek buffer, so that every
+ * caller benefits from the track frames found by the others.
+ * This function must not be called concurrently with any other function
+ * for the same dshandle, and it does not clear the error log of dsh on
+ * success.
+ *
+ * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
+ * @param[in]  buf    The target buffer for the read data.
+ * @param[in]  size   The number of bytes that are to be read.
+ * @param[in]  offset The data offset in the data set to read from.
+ * @param[out] rcsize Reference to a variable in which the actual number
+ *                    of read bytes is returned.
+ *                    If this is 0, the end of the file is reached.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  The data in dsh is inconsistent or dsh is not open.
+ *   - ERANGE  The data in dsh is inconsistent.
+ *   - ENOMEM  Could not allocate internal buffers due to lack of memory.
+ *   - EPROTO  The data read from the disk does not conform to the
+ *             expected format.
+ *   - EIO     I/O error when reading from device.
+ */
+int lzds_dshandle_pread(struct dshandle *dsh, char *buf, size_t size,
+			long long offset, ssize_t *rcsize)
+{
+	struct errorlog *log = NULL;
+	struct readpos *rp = NULL;
+	long long rcoffset;
+	int rc;
+
+	*rcsize = 0;
+	pthread_mutex_lock(&dsh->lock);
+	if (!dsh->is_open)
+		rc = errorlog_add_message(
+			&log, NULL, EINVAL,
+			"data set pread: dshandle is not open\n");
+	else
+		rc = dshandle_get_reader(dsh, offset, &rp, &log);
+	pthread_mutex_unlock(&dsh->lock);
+	if (!rc) {
+		/* the read position is used exclusively while it is busy */
+		rc = dshandle_seek(dsh, rp, offset, &rcoffset, &log);
+		/* there is no data if offset is beyond the end of the data */
+		if (!rc && rcoffset == offset)
+			rc = dshandle_read(dsh, rp, buf, size, rcsize, &log);
+		/* do not rely on a read position after an error */
+		if (rc) {
+			readpos_cancel_readahead(dsh, rp);
+			initialize_buffer_positions_for_first_read(dsh, rp,
+								   NULL);
+		}
+	}
+	pthread_mutex_lock(&dsh->lock);
+	if (rp) {
+		rp->busy = 0;
+		pthread_cond_signal(&dsh->cond);
+	}
+	if (rc)
+		errorlog_add_message(
+			&dsh->log, log, rc,
+			"data set pread: error reading data set %s at "
+			"offset %lld\n", dsh->ds->name, offset);
+	pthread_mutex_unlock(&dsh->lock);
+	errorlog_free(log);
+	return rc;
+}
+
 /**
  * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
  * @param[out] offset Reference to a variable in which the current offset
@@ -3629,7 +4758,7 @@ int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
  */
 void lzds_dshandle_get_offset(struct dshandle *dsh, long long *offset)
 {
-	*offset = dsh->databufoffset + dsh->bufpos;
+	*offset = dsh->pos.databufoffset + dsh->pos.bufpos;
 }
 
 /**
@@ -19,7 +19,6 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <signal.h>
-#include <iconv.h>
 #include <sys/types.h>
 #include <dirent.h>
 #include <sys/sysmacros.h>
@@ -31,6 +30,8 @@
 
 #include "lib/vmdump.h"
 #include "lib/zt_common.h"
+#include "lib/util_base.h"
+#include "lib/util_iconv.h"
 #include "lib/util_libc.h"
 #include "lib/vmcp.h"
 
@@ -84,7 +85,7 @@ struct vmur {
 	int   file_reclen;
 	enum spoolfile_fmt spoolfile_fmt;
 	struct sigaction sigact;
-	iconv_t iconv;
+	struct util_iconv *iconv;
 	int   lock_fd;
 	/* ur device spool state */
 	char  spool_restore_cmd[MAXCMDLEN];
@@ -1528,6 +1529,34 @@ enum spoolfile_fmt get_spoolfile_fmt(struct vmur *info,
 	return TYPE_NORMAL;
 }
 
+/*
+ * Check if text records are converted in one batch
+ *
+ * This is possible if the code page converter uses a translation table. Then
+ * the EBCDIC records are copied with EBCDIC newlines into the output buffer
+ * and converted to ASCII with a single call after all records are copied.
+ */
+static int text_batch(struct vmur *info)
+{
+	return info->text_specified && util_iconv_stateless(info->iconv);
+}
+
+/*
+ * Copy record for text mode without translation
+ */
+static void copy_text(struct splink_record *rec, char **out_ptr)
+{
+	char *data_ptr = (char *) &rec->data;
+
+	/* one blank -> just a newline */
+	if ((rec->ccw.data_len != 1) || (data_ptr[0] != 0x40)) {
+		memcpy(*out_ptr, data_ptr, rec->ccw.data_len);
+		*out_ptr += rec->ccw.data_len;
+	}
+	**out_ptr = EBCDIC_LF;
+	*out_ptr += 1;
+}
+
 /*
  * Convert record for text mode: Do EBCDIC->ASCII translation
  */
@@ -1537,13 +1566,14 @@ static int convert_text(struct vmur *info, struct splink_record *rec,
 	size_t in_count = rec->ccw.data_len;
 	size_t out_count = rec->ccw.data_len;
 	char *data_ptr = (char *) &rec->data;
-	int rc;
+	size_t rc;
 
 	if ((rec->ccw.data_len == 1) && (data_ptr[0] == 0x40))
 		goto out; /* one blank -> just a newline */
 
-	rc = iconv(info->iconv, &data_ptr, &in_count, out_ptr, &out_count);
-	if ((rc == -1) || (in_count != 0)) {
+	rc = util_iconv_conv(info->iconv, &data_ptr, &in_count, out_ptr,
+			     &out_count);
+	if ((rc == (size_t) -1) || (in_count != 0)) {
 		ERR("Code page translation EBCDIC-ASCII failed\n");
 		return -1;
 	}
@@ -1613,6 +1643,7 @@ ssize_t convert_sfdata(struct vmur *info, struct splink_page *in, char *out)
 	struct splink_record *rec;
 	char *out_ptr = out;
 	unsigned int i, rc = 0;
+	int batch = text_batch(info);
 
 	rec = (struct splink_record *) &in->data;
 
@@ -1626,7 +1657,9 @@ ssize_t convert_sfdata(struct vmur *info, struct splink_page *in, char *out)
 				sizeof(rec->ccw));
 			continue; /* skip immediate CCWs */
 		}
-		if (info->text_specified) {
+		if (batch) {
+			copy_text(rec, &out_ptr);
+		} else if (info->text_specified) {
 			rc = convert_text(info, rec, &out_ptr);
 			if (rc)
 				return rc;
@@ -1641,37 +1674,52 @@ ssize_t convert_sfdata(struct vmur *info, struct splink_page *in, char *out)
 
 /*
  * Write normal spool file data.
+ *
+ * All blocks are converted into one output buffer, which is written with a
+ * single system call.
  */
 int write_normal(struct vmur *info, struct splink_page *sfdata, int count,
 		 int fho)
 {
-	char *outbuf;
-	int len, i;
+	size_t size = 0, in_count, out_count;
+	char *outbuf, *in_ptr, *out_ptr;
+	int len, i, rc = 0;
+	size_t pos = 0;
 
+	for (i = 0; i < count; i++)
+		size += (info->file_reclen + 1) * sfdata[i].data_recs;
+	outbuf = (char *) malloc(size + 1);
+	if (!outbuf) {
+		ERR("Out of memory\n");
+		return -ENOMEM;
+	}
 	for (i = 0; i < count; i++) {
-		struct splink_page *data;
-
-		data = &sfdata[i];
-		outbuf = (char *) malloc((info->file_reclen + 1) *
-					 data->data_recs);
-		if (!outbuf) {
-			ERR("Out of memory\n");
-			return -ENOMEM;
-		}
-		len = convert_sfdata(info, data, outbuf);
+		len = convert_sfdata(info, &sfdata[i], outbuf + pos);
 		if (len < 0) {
 			ERR("Data conversion failed\n");
-			return -EINVAL;
+			rc = -EINVAL;
+			goto out;
 		}
-		if (write(fho, outbuf, len) == -1) {
-			ERR("Write to file %s failed: %s\n", info->file_name,
-			    strerror(errno));
-			return -errno;
+		pos += len;
+	}
+	if (text_batch(info)) {
+		in_ptr = out_ptr = outbuf;
+		in_count = out_count = pos;
+		if (util_iconv_conv(info->iconv, &in_ptr, &in_count, &out_ptr,
+				    &out_count) == (size_t) -1 || in_count) {
+			ERR("Code page translation EBCDIC-ASCII failed\n");
+			rc = -EINVAL;
+			goto out;
 		}
-		free(outbuf);
 	}
-
-	return 0;
+	if (write(fho, outbuf, pos) == -1) {
+		ERR("Write to file %s failed: %s\n", info->file_name,
+		    strerror(errno));
+		rc = -errno;
+	}
+out:
+	free(outbuf);
+	return rc;
 }
 
 /*
@@ -1959,25 +2007,48 @@ static void ur_write_sig_handler(int UNUSED(sig), siginfo_t *UNUSED(sip),
 }
 
 /*
- * Read on line from fd not including newline
+ * Buffered input for punch/print
+ */
+static struct {
+	char	buf[INPUT_BUF_SIZE];
+	size_t	pos;
+	size_t	len;
+} input;
+
+/*
+ * Read one line from fd not including newline
+ *
+ * Input is read in blocks of INPUT_BUF_SIZE bytes and lines are copied from
+ * the input buffer to avoid one system call per byte.
  */
 static int read_line(int fd, char *buf, int len, int lf)
 {
-	int offs = 0;
+	size_t offs = 0, cnt;
+	ssize_t rc;
+	char *end;
 
-	memset(buf, 0, len);
 	do {
-		int rc;
-
-		rc = read(fd, buf + offs, 1);
-		if (rc < 0)
-			return -EIO;
-		if (rc == 0)
-			return -ENODATA;
-		if (*(buf + offs) == lf)
+		if (input.pos == input.len) {
+			rc = read(fd, input.buf, sizeof(input.buf));
+			if (rc < 0)
+				return -EIO;
+			if (rc == 0)
+				return -ENODATA;
+			input.pos = 0;
+			input.len = rc;
+		}
+		cnt = MIN(input.len - input.pos, len - offs);
+		end = (char *) memchr(input.buf + input.pos, lf, cnt);
+		if (end)
+			cnt = end - (input.buf + input.pos);
+		memcpy(buf + offs, input.buf + input.pos, cnt);
+		input.pos += cnt;
+		offs += cnt;
+		if (end) {
+			input.pos++; /* skip separator */
 			goto found;
-		offs++;
-	} while (offs < len);
+		}
+	} while (offs < (size_t) len);
 
 	return -EINVAL;
 
@@ -1988,28 +2059,35 @@ found:
 
 /*
  * Read text file for punch/print
+ *
+ * Lines are read directly into the output buffer. With a translation table
+ * all records are converted in place with a single call.
  */
 static int read_text_file(struct vmur *info, int fd, char *out_buf, size_t len)
 {
+	int batch = util_iconv_stateless(info->iconv);
 	unsigned int pos = 0;
 	static int line = 1;
+	char *buf = NULL;
 	char sep, pad;
-	char *buf;
-	int rc;
+	size_t rc;
 
 	sep = '\n';
 	pad = ' ';
 
-	buf = (char *) malloc(info->ur_reclen + 1);
-	if (!buf)
-		return -ENOMEM;
+	if (!batch) {
+		buf = (char *) malloc(info->ur_reclen);
+		if (!buf)
+			return -ENOMEM;
+	}
 
 	do {
 		int line_len;
 		size_t rec_len, out_len;
 		char *in_ptr, *out_ptr;
 
-		line_len = read_line(fd, buf, info->ur_reclen  + 1, sep);
+		line_len = read_line(fd, &out_buf[pos], info->ur_reclen + 1,
+				     sep);
 		if (line_len == -ENODATA) {
 			break;
 		} else if (line_len == -EINVAL) {
@@ -2021,17 +2099,34 @@ static int read_text_file(struct vmur *info, int fd, char *out_buf, size_t len)
 			goto fail;
 		}
 		line++;
-		memset(buf + line_len, pad, info->ur_reclen - line_len);
-		rec_len = out_len = info->ur_reclen;
-		in_ptr = buf;
-		out_ptr = &out_buf[pos];
-		rc = iconv(info->iconv, &in_ptr, &rec_len, &out_ptr, &out_len);
-		if ((rc == -1) || (out_len != 0)) {
-			ERR("Code page conversion failed at line %i\n", line);
-			goto fail;
+		memset(&out_buf[pos + line_len], pad,
+		       info->ur_reclen - line_len);
+		if (!batch) {
+			memcpy(buf, &out_buf[pos], info->ur_reclen);
+			rec_len = out_len = info->ur_reclen;
+			in_ptr = buf;
+			out_ptr = &out_buf[pos];
+			rc = util_iconv_conv(info->iconv, &in_ptr, &rec_len,
+					     &out_ptr, &out_len);
+			if ((rc == (size_t) -1) || (out_len != 0)) {
+				ERR("Code page conversion failed at line %i\n",
+				    line);
+				goto fail;
+			}
 		}
 		pos += info->ur_reclen;
 	} while (pos < len);
+	if (batch) {
+		size_t in_count = pos, out_count = pos;
+		char *in_ptr = out_buf, *out_ptr = out_buf;
+
+		rc = util_iconv_conv(info->iconv, &in_ptr, &in_count, &out_ptr,
+				     &out_count);
+		if ((rc == (size_t) -1) || (out_count != 0)) {
+			ERR("Code page conversion failed\n");
+			goto fail;
+		}
+	}
 	free(buf);
 	return pos;
 fail:
@@ -2049,37 +2144,29 @@ static int read_blocked_file(struct vmur *info, int fd, char *out_buf,
 	static int line = 1;
 	char sep, pad;
 	int line_len;
-	char *buf;
 
 	sep = info->blocked_separator;
 	pad = info->blocked_padding;
 
-	buf = (char *) malloc(info->ur_reclen + 1);
-	if (!buf)
-		return -ENOMEM;
-
 	do {
-		line_len = read_line(fd, buf, info->ur_reclen  + 1, sep);
+		line_len = read_line(fd, &out_buf[pos], info->ur_reclen + 1,
+				     sep);
 		if (line_len == -ENODATA) {
 			break;
 		} else if (line_len == -EINVAL) {
 			ERR("Input line %i too long. Unit record length"
 			    " must not exceed %i\n", line, info->ur_reclen);
-			goto fail;
+			return -1;
 		} else if (line_len < 0) {
 			ERR("Read failed: %s", strerror(errno));
-			goto fail;
+			return -1;
 		}
 		line++;
-		memset(buf + line_len, pad, info->ur_reclen - line_len);
-		memcpy(&out_buf[pos], buf, info->ur_reclen);
+		memset(&out_buf[pos + line_len], pad,
+		       info->ur_reclen - line_len);
 		pos += info->ur_reclen;
 	} while (pos < len);
-	free(buf);
 	return pos;
-fail:
-	free(buf);
-	return -1;
 }
 
 /*
@@ -2121,7 +2208,8 @@ static void ur_write(struct vmur *info)
 		ERR_EXIT("Virtual punch device %X is spooled CONT.\n",
 			 info->devno);
 
-	sfdata = (char *) malloc(info->ur_reclen * VMUR_REC_COUNT);
+	/* One more byte for the string end of the last line read */
+	sfdata = (char *) malloc(info->ur_reclen * VMUR_REC_COUNT + 1);
 	if (!sfdata)
 		ERR_EXIT("Could allocate memory for buffer (%i)\n",
 			    info->ur_reclen);
@@ -2287,8 +2375,8 @@ static int ur_list(struct vmur *info)
  */
 static void setup_iconv(struct vmur *info, const char *from, const char *to)
 {
-	info->iconv = iconv_open(to, from);
-	if (info->iconv == ((iconv_t) -1))
+	info->iconv = util_iconv_open(to, from);
+	if (info->iconv == NULL)
 		ERR_EXIT("Could not initialize conversion table %s->%s.\n",
 			 from, to);
 }
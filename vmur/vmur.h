@@ -61,6 +61,7 @@ do { \
 #define ASCII_CODE_PAGE  "ISO-8859-1"
 
 #define READ_BLOCKS 80
+#define INPUT_BUF_SIZE (64 * 1024)
 
 enum spoolfile_fmt {
 	TYPE_NORMAL,
@@ -18,6 +18,7 @@
 #include <malloc.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -43,23 +44,42 @@ struct zdsfs_info {
 	int keepRDW;
 	int host_count;
 	unsigned int tracks_per_frame;
+	unsigned int readahead;
 	unsigned long long seek_buffer_size;
+	char *seek_cache_dir; /* directory for persistent seek indexes */
 	struct zdsroot *zdsroot;
 
+	/* The mutex serializes VTOC updates, reading of PDS directories
+	 * and the generation of meta data */
+	pthread_mutex_t vtoc_mutex;
+
+	/* The content of metadata.txt is generated while it is read, or
+	 * completely when its size is queried */
 	char *metadata;  /* buffer that contains the content of metadata.txt */
 	size_t metasize; /* total size of meta data buffer */
 	size_t metaused; /* how many bytes of buffer are already filled */
 	time_t metatime; /* when did we create this meta data */
+	struct dsiterator *metadsit;	/* next data set, NULL when done */
+	struct memberiterator *metamit; /* next member of metapds */
+	struct dataset *metapds;	/* PDS whose members are generated */
 };
 
 static struct zdsfs_info zdsfsinfo;
-static int zdsfs_create_meta_data_buffer(struct zdsfs_info *);
+static int zdsfs_meta_data_reset(void);
+static int zdsfs_meta_data_fill(size_t size);
 static int zdsfs_verify_datasets(void);
 
 struct zdsfs_file_info {
+	/* Concurrent read requests share the data set handle, see
+	 * lzds_dshandle_pread. The mutex protects the metadata read
+	 * position. */
 	struct dshandle *dsh;
 	pthread_mutex_t mutex;
 
+	struct dataset *ds;
+	char member[MAXDSNAMELENGTH]; /* member name for a PDS */
+	int ispds;
+
 	int is_metadata_file;
 	size_t metaread; /* how many bytes have already been read */
 };
@@ -99,6 +119,27 @@ static void path_to_member_name(const char *path, char *normds, size_t size)
 
 
 
+/*
+ * Read the directory of a PDS when its members are accessed for the first
+ * time. Requests for different files may access the same PDS concurrently.
+ */
+static int zdsfs_read_members(struct dataset *ds)
+{
+	struct errorlog *log;
+	int rc;
+
+	pthread_mutex_lock(&zdsfsinfo.vtoc_mutex);
+	rc = lzds_dataset_read_members(ds);
+	pthread_mutex_unlock(&zdsfsinfo.vtoc_mutex);
+	if (rc) {
+		fprintf(stderr,	"Error when reading members of data set:\n");
+		lzds_dataset_get_errorlog(ds, &log);
+		lzds_errorlog_fprint(log, stderr);
+		return -rc;
+	}
+	return 0;
+}
+
 static int zdsfs_getattr(const char *path, struct stat *stbuf)
 {
 	char normds[MAXDSNAMELENGTH];
@@ -123,9 +164,15 @@ static int zdsfs_getattr(const char *path, struct stat *stbuf)
 	}
 
 	if (strcmp(path, "/"METADATAFILE) == 0) {
+		/* the size is only known when all meta data is generated */
+		pthread_mutex_lock(&zdsfsinfo.vtoc_mutex);
+		rc = zdsfs_meta_data_fill(SIZE_MAX);
+		stbuf->st_size = zdsfsinfo.metaused;
+		pthread_mutex_unlock(&zdsfsinfo.vtoc_mutex);
+		if (rc)
+			return rc;
 		stbuf->st_mode = S_IFREG | DEF_FILE_PERM;
 		stbuf->st_nlink = 1;
-		stbuf->st_size = zdsfsinfo.metaused;
 		stbuf->st_atime = zdsfsinfo.metatime;
 		stbuf->st_mtime = zdsfsinfo.metatime;
 		stbuf->st_ctime = zdsfsinfo.metatime;
@@ -175,6 +222,9 @@ static int zdsfs_getattr(const char *path, struct stat *stbuf)
 			stbuf->st_size = dssize;
 			return 0;
 		}
+		rc = zdsfs_read_members(ds);
+		if (rc)
+			return rc;
 		rc = lzds_dataset_get_member_by_name(ds, normds, &member);
 		if (rc)
 			return -ENOENT;
@@ -195,45 +245,166 @@ static int zdsfs_getattr(const char *path, struct stat *stbuf)
 	return 0;
 }
 
-static void zdsfs_read_device(struct dasd *newdasd, const char *device)
+/* Upper limit for the number of threads that read VTOCs in parallel */
+#define SCAN_THREADS_MAX 32
+
+enum scan_step {
+	SCAN_RESERVE,
+	SCAN_VTOC,
+	SCAN_EXTRACT,
+	SCAN_RELEASE,
+	SCAN_DONE,
+};
+
+/* Result of reading the VTOC of a single device */
+struct scan_job {
+	struct dasd *dasd;
+	enum scan_step step;	/* Step that failed or SCAN_DONE */
+	int rc;
+};
+
+/* Work queue shared by the scan threads */
+static struct {
+	struct scan_job *jobs;
+	int count;
+	int next;		/* Index of next job that is not yet started */
+	pthread_mutex_t mutex;
+} scan;
+
+/*
+ * Read the VTOC of a device and extract its data sets. This only accesses
+ * the given dasd, so it is safe to do this for several devices in parallel.
+ */
+static void zdsfs_scan_device(struct scan_job *job)
+{
+	const char *device = job->dasd->device;
+
+	job->step = SCAN_RESERVE;
+	job->rc = dasd_disk_reserve(device);
+	if (job->rc)
+		return;
+	job->step = SCAN_VTOC;
+	job->rc = lzds_dasd_alloc_rawvtoc(job->dasd);
+	if (job->rc)
+		return;
+	job->step = SCAN_EXTRACT;
+	job->rc = lzds_dasd_extract_datasets(job->dasd);
+	if (job->rc)
+		return;
+	job->step = SCAN_RELEASE;
+	job->rc = dasd_disk_release(device);
+	if (job->rc)
+		return;
+	job->step = SCAN_DONE;
+}
+
+static void *zdsfs_scan_thread(void *UNUSED(data))
+{
+	int i;
+
+	while (1) {
+		pthread_mutex_lock(&scan.mutex);
+		i = scan.next < scan.count ? scan.next++ : -1;
+		pthread_mutex_unlock(&scan.mutex);
+		if (i < 0)
+			break;
+		zdsfs_scan_device(&scan.jobs[i]);
+	}
+	return NULL;
+}
+
+static void zdsfs_scan_error(struct scan_job *job)
 {
+	const char *device = job->dasd->device;
 	struct errorlog *log;
-	int rc;
 
-	rc = dasd_disk_reserve(device);
-	if (rc) {
+	switch (job->step) {
+	case SCAN_RESERVE:
 		fprintf(stderr, "error when reserving device %s: %s\n",
-			device, strerror(rc));
-		lzds_dasd_get_errorlog(newdasd, &log);
-		lzds_errorlog_fprint(log, stderr);
-		exit(1);
-	}
-	rc = lzds_dasd_alloc_rawvtoc(newdasd);
-	if (rc) {
+			device, strerror(job->rc));
+		break;
+	case SCAN_VTOC:
 		fprintf(stderr, "error when reading VTOC from device %s: %s\n",
-			device, strerror(rc));
-		lzds_dasd_get_errorlog(newdasd, &log);
-		lzds_errorlog_fprint(log, stderr);
-		exit(1);
-	}
-	rc = lzds_zdsroot_extract_datasets_from_dasd(zdsfsinfo.zdsroot,
-						     newdasd);
-	if (rc) {
+			device, strerror(job->rc));
+		break;
+	case SCAN_EXTRACT:
 		fprintf(stderr,
 			"error when extracting data sets from dasd %s: %s\n",
-			device, strerror(rc));
-		lzds_zdsroot_get_errorlog(zdsfsinfo.zdsroot, &log);
-		lzds_errorlog_fprint(log, stderr);
-		exit(1);
-	}
-	rc = dasd_disk_release(device);
-	if (rc) {
+			device, strerror(job->rc));
+		break;
+	default:
 		fprintf(stderr, "error when releasing device %s: %s\n",
-			device, strerror(rc));
-		lzds_dasd_get_errorlog(newdasd, &log);
-		lzds_errorlog_fprint(log, stderr);
+			device, strerror(job->rc));
+		break;
+	}
+	lzds_dasd_get_errorlog(job->dasd, &log);
+	lzds_errorlog_fprint(log, stderr);
+}
+
+/*
+ * Read the VTOCs of all devices with a pool of threads, so that the time
+ * needed for many devices is about the time needed for the slowest one.
+ * The data sets are then merged in the order in which the devices have
+ * been specified, so that the result does not depend on thread timing.
+ */
+static void zdsfs_read_devices(void)
+{
+	struct dasditerator *dasdit;
+	struct errorlog *log;
+	pthread_t *threads;
+	struct dasd *dasd;
+	int i, nthreads, rc;
+
+	scan.count = zdsfsinfo.devcount;
+	scan.jobs = calloc(scan.count, sizeof(*scan.jobs));
+	threads = calloc(MIN(scan.count, SCAN_THREADS_MAX), sizeof(*threads));
+	rc = lzds_zdsroot_alloc_dasditerator(zdsfsinfo.zdsroot, &dasdit);
+	if (!scan.jobs || !threads || rc) {
+		fprintf(stderr, "Could not allocate internal structures\n");
 		exit(1);
 	}
+	for (i = 0; !lzds_dasditerator_get_next_dasd(dasdit, &dasd) &&
+		     i < scan.count; i++)
+		scan.jobs[i].dasd = dasd;
+	lzds_dasditerator_free(dasdit);
+
+	scan.next = 0;
+	pthread_mutex_init(&scan.mutex, NULL);
+	for (nthreads = 0; nthreads < MIN(scan.count, SCAN_THREADS_MAX);
+	     nthreads++) {
+		if (pthread_create(&threads[nthreads], NULL,
+				   zdsfs_scan_thread, NULL))
+			break;
+	}
+	/* scan remaining devices in this thread if no thread could start */
+	if (!nthreads)
+		zdsfs_scan_thread(NULL);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&scan.mutex);
+
+	for (i = 0; i < scan.count; i++) {
+		if (scan.jobs[i].step != SCAN_DONE) {
+			zdsfs_scan_error(&scan.jobs[i]);
+			exit(1);
+		}
+	}
+	for (i = 0; i < scan.count; i++) {
+		dasd = scan.jobs[i].dasd;
+		rc = lzds_zdsroot_merge_datasets_from_dasd(zdsfsinfo.zdsroot,
+							   dasd);
+		if (rc) {
+			fprintf(stderr,
+				"error when extracting data sets from dasd %s: %s\n",
+				dasd->device, strerror(rc));
+			lzds_zdsroot_get_errorlog(zdsfsinfo.zdsroot, &log);
+			lzds_errorlog_fprint(log, stderr);
+			exit(1);
+		}
+	}
+	free(threads);
+	free(scan.jobs);
+	scan.jobs = NULL;
 }
 
 
@@ -286,28 +457,16 @@ static int zdsfs_statfs(const char *UNUSED(path), struct statvfs *statvfs)
 
 static int zdsfs_update_vtoc(void)
 {
-	struct dasditerator *dasdit;
-	struct dasd *dasd;
 	int rc;
 
+	pthread_mutex_lock(&zdsfsinfo.vtoc_mutex);
 	lzds_dslist_free(zdsfsinfo.zdsroot);
-	rc = lzds_zdsroot_alloc_dasditerator(zdsfsinfo.zdsroot, &dasdit);
-	if (rc)
-		return -ENOMEM;
-
-	while (!lzds_dasditerator_get_next_dasd(dasdit, &dasd))
-		zdsfs_read_device(dasd, dasd->device);
-
-	lzds_dasditerator_free(dasdit);
+	zdsfs_read_devices();
 	rc = zdsfs_verify_datasets();
-	if (rc)
-		return rc;
-
-	rc = zdsfs_create_meta_data_buffer(&zdsfsinfo);
-	if (rc)
-		return rc;
-
-	return 0;
+	if (!rc)
+		rc = zdsfs_meta_data_reset();
+	pthread_mutex_unlock(&zdsfsinfo.vtoc_mutex);
+	return rc;
 }
 
 static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
@@ -359,6 +518,9 @@ static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 		return -ENOENT;
 	lzds_dataset_get_is_PDS(ds, &ispds);
 	if (ispds) {
+		rc = zdsfs_read_members(ds);
+		if (rc)
+			return rc;
 		filler(buf, ".", NULL, 0);
 		filler(buf, "..", NULL, 0);
 		rc = lzds_dataset_alloc_memberiterator(ds, &it);
@@ -376,15 +538,101 @@ static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 }
 
 
+static int zdsfs_alloc_dshandle(struct zdsfs_file_info *zfi,
+				struct dshandle **dshp)
+{
+	struct dshandle *dsh;
+	struct errorlog *log;
+	int rc;
+
+	rc = lzds_dataset_alloc_dshandle(zfi->ds, zdsfsinfo.tracks_per_frame,
+					 &dsh);
+	if (rc)
+		return -rc;
+
+	rc = lzds_dshandle_set_seekbuffer(dsh, zdsfsinfo.seek_buffer_size);
+	if (rc) {
+		fprintf(stderr,	"Error when preparing seek buffer:\n");
+		lzds_dshandle_get_errorlog(dsh, &log);
+		lzds_errorlog_fprint(log, stderr);
+		goto error;
+	}
+	rc = lzds_dshandle_set_readahead(dsh, zdsfsinfo.readahead);
+	if (rc) {
+		fprintf(stderr,	"Error when preparing read-ahead buffers:\n");
+		lzds_dshandle_get_errorlog(dsh, &log);
+		lzds_errorlog_fprint(log, stderr);
+		goto error;
+	}
+	/* if the data set is a PDS, then the context must be set to the
+	 * member
+	 */
+	if (zfi->ispds) {
+		rc = lzds_dshandle_set_member(dsh, zfi->member);
+		if (rc) {
+			fprintf(stderr,	"Error when preparing member:\n");
+			lzds_dshandle_get_errorlog(dsh, &log);
+			lzds_errorlog_fprint(log, stderr);
+			goto error;
+		}
+	}
+	rc = lzds_dshandle_set_keepRDW(dsh, zdsfsinfo.keepRDW);
+	if (rc) {
+		fprintf(stderr,	"Error when preparing RDW setting:\n");
+		lzds_dshandle_get_errorlog(dsh, &log);
+		lzds_errorlog_fprint(log, stderr);
+		goto error;
+	}
+	rc = lzds_dshandle_open(dsh);
+	if (rc) {
+		fprintf(stderr,	"Error when opening data set:\n");
+		lzds_dshandle_get_errorlog(dsh, &log);
+		lzds_errorlog_fprint(log, stderr);
+		goto error;
+	}
+	/* a missing or unusable seek index only makes seeks slower */
+	if (zdsfsinfo.seek_cache_dir &&
+	    lzds_dshandle_load_seekbuffer(dsh, zdsfsinfo.seek_cache_dir)) {
+		fprintf(stderr,	"Warning: Could not load seek index:\n");
+		lzds_dshandle_get_errorlog(dsh, &log);
+		lzds_errorlog_fprint(log, stderr);
+	}
+	*dshp = dsh;
+	return 0;
+
+error:
+	lzds_dshandle_free(dsh);
+	return -rc;
+}
+
+static void zdsfs_free_file_info(struct zdsfs_file_info *zfi)
+{
+	struct errorlog *log;
+	int rc;
+
+	if (zfi->dsh) {
+		if (zdsfsinfo.seek_cache_dir &&
+		    lzds_dshandle_save_seekbuffer(zfi->dsh,
+						  zdsfsinfo.seek_cache_dir)) {
+			fprintf(stderr,	"Warning: Could not save seek index:\n");
+			lzds_dshandle_get_errorlog(zfi->dsh, &log);
+			lzds_errorlog_fprint(log, stderr);
+		}
+		lzds_dshandle_close(zfi->dsh);
+		lzds_dshandle_free(zfi->dsh);
+	}
+	rc = pthread_mutex_destroy(&zfi->mutex);
+	if (rc)
+		fprintf(stderr,	"Error: could not destroy mutex, rc=%d\n", rc);
+	free(zfi);
+}
+
 static int zdsfs_open(const char *path, struct fuse_file_info *fi)
 {
 	char normds[45];
-	struct dshandle *dsh;
-	struct dataset *ds;
 	struct zdsfs_file_info *zfi;
 	int rc;
-	int ispds, issupported;
-	struct errorlog *log;
+	int issupported;
 
 	if ((fi->flags & 3) != O_RDONLY)
 		return -EACCES;
@@ -395,7 +643,7 @@ static int zdsfs_open(const char *path, struct fuse_file_info *fi)
 	 */
 	fi->direct_io = 1;
 
-	zfi = malloc(sizeof(*zfi));
+	zfi = calloc(1, sizeof(*zfi));
 	if (!zfi)
 		return -ENOMEM;
 	rc = pthread_mutex_init(&zfi->mutex, NULL);
@@ -405,8 +653,7 @@ static int zdsfs_open(const char *path, struct fuse_file_info *fi)
 	if (strcmp(path, "/"METADATAFILE) == 0) {
 		rc = zdsfs_update_vtoc();
 		if (rc)
-			return rc;
-		zfi->dsh = NULL;
+			goto error2;
 		zfi->is_metadata_file = 1;
 		zfi->metaread = 0;
 		fi->fh = (unsigned long)zfi;
@@ -414,94 +661,56 @@ static int zdsfs_open(const char *path, struct fuse_file_info *fi)
 	}
 
 	path_to_ds_name(path, normds, sizeof(normds));
-	rc = lzds_zdsroot_find_dataset(zdsfsinfo.zdsroot, normds, &ds);
-	if (rc)
-		goto error1;
+	rc = lzds_zdsroot_find_dataset(zdsfsinfo.zdsroot, normds, &zfi->ds);
+	if (rc) {
+		rc = -rc;
+		goto error2;
+	}
 
-	lzds_dataset_get_is_supported(ds, &issupported);
+	lzds_dataset_get_is_supported(zfi->ds, &issupported);
 	if (!issupported) {
 		/* we should never get this error, as unsupported data sets are
 		 * not listed. But just in case, print a message */
 		fprintf(stderr,	"Error: Data set %s is not supported\n", normds);
 		rc = -ENOENT;
-		goto error1;
-	}
-
-	rc = lzds_dataset_alloc_dshandle(ds, zdsfsinfo.tracks_per_frame, &dsh);
-	if (rc) {
-		rc = -rc;
-		goto error1;
-	}
-
-	rc = lzds_dshandle_set_seekbuffer(dsh, zdsfsinfo.seek_buffer_size);
-	if (rc) {
-		fprintf(stderr,	"Error when preparing seek buffer:\n");
-		lzds_dshandle_get_errorlog(dsh, &log);
-		lzds_errorlog_fprint(log, stderr);
-		rc = -rc;
 		goto error2;
 	}
+
 	/* if the data set is a PDS, then the path must contain a valid
-	 * member name, and the context must be set to this member
+	 * member name
 	 */
-	lzds_dataset_get_is_PDS(ds, &ispds);
-	if (ispds) {
-		path_to_member_name(path, normds, sizeof(normds));
-		rc = lzds_dshandle_set_member(dsh, normds);
-		if (rc) {
-			fprintf(stderr,	"Error when preparing member:\n");
-			lzds_dshandle_get_errorlog(dsh, &log);
-			lzds_errorlog_fprint(log, stderr);
-			rc = -rc;
+	lzds_dataset_get_is_PDS(zfi->ds, &zfi->ispds);
+	if (zfi->ispds) {
+		path_to_member_name(path, zfi->member, sizeof(zfi->member));
+		rc = zdsfs_read_members(zfi->ds);
+		if (rc)
 			goto error2;
-		}
 	}
-	rc = lzds_dshandle_set_keepRDW(dsh, zdsfsinfo.keepRDW);
-	if (rc) {
-		fprintf(stderr,	"Error when preparing RDW setting:\n");
-		lzds_dshandle_get_errorlog(dsh, &log);
-		lzds_errorlog_fprint(log, stderr);
-		rc = -rc;
-		goto error2;
-	}
-	rc = lzds_dshandle_open(dsh);
-	if (rc) {
-		fprintf(stderr,	"Error when opening data set:\n");
-		lzds_dshandle_get_errorlog(dsh, &log);
-		lzds_errorlog_fprint(log, stderr);
-		rc = -rc;
+
+	rc = zdsfs_alloc_dshandle(zfi, &zfi->dsh);
+	if (rc)
 		goto error2;
-	}
 	zfi->is_metadata_file = 0;
 	zfi->metaread = 0;
-	zfi->dsh = dsh;
 	fi->fh = (uint64_t)(unsigned long)zfi;
 	return 0;
 
 error2:
-	lzds_dshandle_free(dsh);
+	zdsfs_free_file_info(zfi);
+	return rc;
 error1:
 	free(zfi);
-	return rc;
-
+	return -rc;
 }
 
 static int zdsfs_release(const char *UNUSED(path), struct fuse_file_info *fi)
 {
 	struct zdsfs_file_info *zfi;
-	int rc;
 
 	if (!fi->fh)
 		return -EINVAL;
 	zfi = (struct zdsfs_file_info *)(unsigned long)fi->fh;
-	if (zfi->dsh) {
-		lzds_dshandle_close(zfi->dsh);
-		lzds_dshandle_free(zfi->dsh);
-	}
-	rc = pthread_mutex_destroy(&zfi->mutex);
-	if (rc)
-		fprintf(stderr,	"Error: could not destroy mutex, rc=%d\n", rc);
-	free(zfi);
+	zdsfs_free_file_info(zfi);
 	return 0;
 }
 
@@ -511,46 +720,43 @@ static int zdsfs_read(const char *UNUSED(path), char *buf, size_t size,
 	struct zdsfs_file_info *zfi;
 	ssize_t count;
 	int rc, rc2;
-	long long rcoffset;
 	struct errorlog *log;
 
 	if (!fi->fh)
 		return -ENOENT;
 	zfi = (struct zdsfs_file_info *)(unsigned long)fi->fh;
 
-	rc2 = pthread_mutex_lock(&zfi->mutex);
-	if (rc2) {
-		fprintf(stderr,	"Error: could not lock mutex, rc=%d\n", rc2);
-		return -EIO;
-	}
-	rc = 0;
 	if (zfi->is_metadata_file) {
-		if (zfi->metaread >= zdsfsinfo.metaused) {
+		rc2 = pthread_mutex_lock(&zfi->mutex);
+		if (rc2) {
+			fprintf(stderr,	"Error: could not lock mutex, rc=%d\n",
+				rc2);
+			return -EIO;
+		}
+		pthread_mutex_lock(&zdsfsinfo.vtoc_mutex);
+		rc = zdsfs_meta_data_fill(zfi->metaread + size);
+		if (rc || zfi->metaread >= zdsfsinfo.metaused) {
+			pthread_mutex_unlock(&zdsfsinfo.vtoc_mutex);
 			pthread_mutex_unlock(&zfi->mutex);
-			return 0;
+			return rc;
 		}
 		count = zdsfsinfo.metaused - zfi->metaread;
 		if (size < (size_t)count)
 			count = size;
 		memcpy(buf, &zdsfsinfo.metadata[zfi->metaread], count);
+		pthread_mutex_unlock(&zdsfsinfo.vtoc_mutex);
 		zfi->metaread += count;
-	} else {
-		lzds_dshandle_get_offset(zfi->dsh, &rcoffset);
-		if (rcoffset != offset)
-			rc = lzds_dshandle_lseek(zfi->dsh, offset, &rcoffset);
-		if (!rc)
-			rc = lzds_dshandle_read(zfi->dsh, buf, size, &count);
+		pthread_mutex_unlock(&zfi->mutex);
+		return count;
 	}
-	rc2 = pthread_mutex_unlock(&zfi->mutex);
-	if (rc2)
-		fprintf(stderr,	"Error: could not unlock mutex, rc=%d\n", rc2);
+	/* Concurrent reads of the file run in parallel */
+	rc = lzds_dshandle_pread(zfi->dsh, buf, size, offset, &count);
 	if (rc) {
 		fprintf(stderr,	"Error when reading from data set:\n");
 		lzds_dshandle_get_errorlog(zfi->dsh, &log);
 		lzds_errorlog_fprint(log, stderr);
-		return -rc;
 	}
-	return count;
+	return rc ? -rc : count;
 }
 
 
@@ -709,118 +915,136 @@ static int zdsfs_verify_datasets(void)
 }
 
 
-static int zdsfs_create_meta_data_buffer(struct zdsfs_info *info)
+/*
+ * Append a line to the meta data buffer. The buffer size is doubled when
+ * it is full, so that the number of reallocations stays small.
+ */
+static int zdsfs_meta_data_append(const char *line, size_t count)
 {
-	char *mbrname;
-	char *dsname;
-	struct dataset *ds;
-	struct dsiterator *dsit;
-	struct memberiterator *it;
-	struct pdsmember *member;
-	int rc;
-	int ispds, issupported;
+	size_t newsize;
+	char *temp;
+
+	if (zdsfsinfo.metaused + count + 1 > zdsfsinfo.metasize) {
+		newsize = MAX(zdsfsinfo.metasize * 2,
+			      zdsfsinfo.metaused + count + 1);
+		temp = realloc(zdsfsinfo.metadata, newsize);
+		if (!temp)
+			return -ENOMEM;
+		zdsfsinfo.metadata = temp;
+		zdsfsinfo.metasize = newsize;
+	}
+	memcpy(&zdsfsinfo.metadata[zdsfsinfo.metaused], line, count + 1);
+	zdsfsinfo.metaused += count;
+	return 0;
+}
 
+/*
+ * Start a new generation of the meta data for the current data set list.
+ * Must be called with vtoc_mutex held.
+ */
+static int zdsfs_meta_data_reset(void)
+{
+	lzds_memberiterator_free(zdsfsinfo.metamit);
+	zdsfsinfo.metamit = NULL;
+	zdsfsinfo.metapds = NULL;
+	lzds_dsiterator_free(zdsfsinfo.metadsit);
+	zdsfsinfo.metadsit = NULL;
+	zdsfsinfo.metaused = 0;
+	zdsfsinfo.metatime = time(NULL);
+	if (lzds_zdsroot_alloc_dsiterator(zdsfsinfo.zdsroot,
+					  &zdsfsinfo.metadsit))
+		return -ENOMEM;
+	return 0;
+}
+
+/*
+ * Generate the next line of meta data. This is either a member of the
+ * current PDS or the next supported data set. Must be called with
+ * vtoc_mutex held.
+ */
+static int zdsfs_meta_data_next_line(void)
+{
 	char buffer[200]; /* large enough for one line of meta data */
+	char *mbrname, *dsname;
+	struct pdsmember *member;
+	struct dataset *ds;
+	int ispds, issupported, rc;
 	char recfm[20];
-	char *temp;
-	char *metadata;
-	size_t metasize; /* total size of meta data buffer */
-	size_t metaused; /* how many bytes of buffer are already filled */
-	size_t count;
 	format1_label_t *f1;
+	size_t count;
 
-	metadata = malloc(4096);
-	if (!metadata)
-		return -ENOMEM;
-	metasize = 4096;
-	metaused = 0;
-	metadata[metaused] = 0;
-
-	rc = lzds_zdsroot_alloc_dsiterator(zdsfsinfo.zdsroot, &dsit);
-	if (rc) {
-		rc = -ENOMEM;
-		goto error;
-	}
-	while (!lzds_dsiterator_get_next_dataset(dsit, &ds)) {
-		lzds_dataset_get_is_supported(ds, &issupported);
-		if (!issupported)
-			continue;
+	if (zdsfsinfo.metamit) {
+		ds = zdsfsinfo.metapds;
 		lzds_dataset_get_name(ds, &dsname);
 		lzds_dataset_get_format1_dscb(ds, &f1);
 		lzds_DS1RECFM_to_recfm(f1->DS1RECFM, recfm);
-		lzds_dataset_get_is_PDS(ds, &ispds);
-		count = snprintf(buffer, sizeof(buffer),
-				 "dsn=%s,recfm=%s,lrecl=%u,"
-				 "dsorg=%s\n",
-				 dsname, recfm, f1->DS1LRECL,
-				 ispds ? "PO" : "PS");
-		if (count >= sizeof(buffer)) {	/* just a sanity check */
-			count = sizeof(buffer) - 1;
-			buffer[count] = 0;
-		}
-		if (metaused + count + 1 > metasize) {
-			temp = realloc(metadata,  metasize + 4096);
-			if (!temp) {
-				rc = -ENOMEM;
-				goto error;
-			}
-			metadata = temp;
-			metasize += 4096;
-		}
-		memcpy(&metadata[metaused], buffer, count + 1);
-		metaused += count;
-
-		/* if the dataset is a PDS then we need to process all members
-		 * of the PDS, otherwise continue with the next dataset */
-		if (!ispds)
-			continue;
-
-		rc = lzds_dataset_alloc_memberiterator(ds, &it);
-		if (rc) {
-			rc = -ENOMEM;
-			goto error;
-		}
-		while (!lzds_memberiterator_get_next_member(it, &member)) {
+		if (!lzds_memberiterator_get_next_member(zdsfsinfo.metamit,
+							 &member)) {
 			lzds_pdsmember_get_name(member, &mbrname);
 			count = snprintf(buffer, sizeof(buffer),
 					 "dsn=%s(%s),recfm=%s,lrecl=%u,"
 					 "dsorg=PS\n",
 					 dsname, mbrname, recfm, f1->DS1LRECL);
-			if (count >= sizeof(buffer)) {
-				count = sizeof(buffer) - 1;
-				buffer[count] = 0;
-			}
-			if (metaused + count + 1 > metasize) {
-				temp = realloc(metadata,  metasize + 4096);
-				if (!temp) {
-					rc = -ENOMEM;
-					goto error;
-				}
-				metadata = temp;
-				metasize += 4096;
-			}
-			memcpy(&metadata[metaused], buffer, count + 1);
-			metaused += count;
+			goto out;
 		}
-		lzds_memberiterator_free(it);
-		it = NULL;
+		lzds_memberiterator_free(zdsfsinfo.metamit);
+		zdsfsinfo.metamit = NULL;
+		zdsfsinfo.metapds = NULL;
 	}
-	lzds_dsiterator_free(dsit);
-	dsit = NULL;
-
-	if (info->metadata)
-		free(info->metadata);
-	info->metadata = metadata;
-	info->metasize = metasize;
-	info->metaused = metaused;
-	info->metatime = time(NULL);
-	return 0;
+	do {
+		if (lzds_dsiterator_get_next_dataset(zdsfsinfo.metadsit, &ds)) {
+			lzds_dsiterator_free(zdsfsinfo.metadsit);
+			zdsfsinfo.metadsit = NULL;
+			return 0;
+		}
+		lzds_dataset_get_is_supported(ds, &issupported);
+	} while (!issupported);
+	lzds_dataset_get_name(ds, &dsname);
+	lzds_dataset_get_format1_dscb(ds, &f1);
+	lzds_DS1RECFM_to_recfm(f1->DS1RECFM, recfm);
+	lzds_dataset_get_is_PDS(ds, &ispds);
+	count = snprintf(buffer, sizeof(buffer),
+			 "dsn=%s,recfm=%s,lrecl=%u,"
+			 "dsorg=%s\n",
+			 dsname, recfm, f1->DS1LRECL,
+			 ispds ? "PO" : "PS");
+	/* if the dataset is a PDS then its members follow, otherwise
+	 * continue with the next dataset */
+	if (ispds) {
+		rc = lzds_dataset_alloc_memberiterator(ds, &zdsfsinfo.metamit);
+		if (rc == ENOMEM)
+			return -ENOMEM;
+		if (rc) {
+			fprintf(stderr,	"Warning: Could not read members of "
+				"data set %s\n", dsname);
+			zdsfsinfo.metamit = NULL;
+		} else {
+			zdsfsinfo.metapds = ds;
+		}
+	}
+out:
+	if (count >= sizeof(buffer)) {	/* just a sanity check */
+		count = sizeof(buffer) - 1;
+		buffer[count] = 0;
+	}
+	return zdsfs_meta_data_append(buffer, count);
+}
 
-error:
-	free(metadata);
-	lzds_dsiterator_free(dsit);
-	lzds_memberiterator_free(it);
-	return rc;
+/*
+ * Generate meta data until the buffer contains at least size bytes or all
+ * data sets have been processed. PDS directories are only read when their
+ * members are reached. Must be called with vtoc_mutex held.
+ */
+static int zdsfs_meta_data_fill(size_t size)
+{
+	int rc;
+
+	while (zdsfsinfo.metaused < size && zdsfsinfo.metadsit) {
+		rc = zdsfs_meta_data_next_line();
+		if (rc)
+			return rc;
+	}
+	return 0;
 }
 
 
@@ -831,6 +1055,8 @@ enum {
 	KEY_DEVFILE,
 	KEY_TRACKS,
 	KEY_SEEKBUFFER,
+	KEY_READAHEAD,
+	KEY_SEEKCACHE,
 };
 
 #define ZDSFS_OPT(t, p, v) { t, offsetof(struct zdsfs_info, p), v }
@@ -843,6 +1069,8 @@ static const struct fuse_opt zdsfs_opts[] = {
 	FUSE_OPT_KEY("-l %s",		KEY_DEVFILE),
 	FUSE_OPT_KEY("tracks=",         KEY_TRACKS),
 	FUSE_OPT_KEY("seekbuffer=",     KEY_SEEKBUFFER),
+	FUSE_OPT_KEY("readahead=",      KEY_READAHEAD),
+	FUSE_OPT_KEY("seekcache=",      KEY_SEEKCACHE),
 	ZDSFS_OPT("rdw",                keepRDW, 1),
 	ZDSFS_OPT("ignore_incomplete",  allow_inclomplete_multi_volume, 1),
 	ZDSFS_OPT("check_host_count",   host_count, 1),
@@ -872,6 +1100,10 @@ static void usage(const char *progname)
 "    -o tracks=N            Size of the track buffer in tracks (default 128)\n"
 "    -o seekbuffer=S        Upper limit in bytes for the seek history buffer\n"
 "                           size (default 1048576)\n"
+"    -o readahead=N         Number of track buffers that are read ahead\n"
+"                           asynchronously (default 1, maximum 64)\n"
+"    -o seekcache=DIR       Keep seek history buffers in directory DIR across\n"
+"                           mounts\n"
 "    -o check_host_count    Stop processing if the device is used by another\n"
 "                           operating system instance\n"
 		, progname);
@@ -900,7 +1132,6 @@ static void zdsfs_process_device(const char *device)
 		lzds_errorlog_fprint(log, stderr);
 		exit(1);
 	}
-	zdsfs_read_device(newdasd, device);
 }
 
 static void zdsfs_process_device_file(const char *devfile)
@@ -977,7 +1208,7 @@ static int zdsfs_process_args(void *UNUSED(data), const char *arg, int key,
 			      struct fuse_args *outargs)
 {
 	struct stat sb;
-	unsigned long tracks_per_frame;
+	unsigned long tracks_per_frame, readahead;
 	unsigned long long seek_buffer_size;
 	const char *value;
 	char *endptr;
@@ -1036,6 +1267,40 @@ static int zdsfs_process_args(void *UNUSED(data), const char *arg, int key,
 		}
 		zdsfsinfo.seek_buffer_size = seek_buffer_size;
 		return 0;
+	case KEY_READAHEAD:
+		value = arg + strlen("readahead=");
+		/* strtoul does not complain about negative values  */
+		if (*value == '-') {
+			errno = EINVAL;
+		} else {
+			errno = 0;
+			readahead = strtoul(value, &endptr, 10);
+		}
+		if (!errno && readahead <= MAXREADAHEAD)
+			zdsfsinfo.readahead = readahead;
+		else
+			errno = ERANGE;
+		if (errno || (endptr && (*endptr != '\0'))) {
+			fprintf(stderr, "Invalid value '%s' for option "
+				"'readahead'\n", value);
+			exit(1);
+		}
+		return 0;
+	case KEY_SEEKCACHE:
+		value = arg + strlen("seekcache=");
+		/* fuse changes the working directory when it daemonizes */
+		free(zdsfsinfo.seek_cache_dir);
+		zdsfsinfo.seek_cache_dir = realpath(value, NULL);
+		if (!zdsfsinfo.seek_cache_dir ||
+		    stat(zdsfsinfo.seek_cache_dir, &sb) ||
+		    !S_ISDIR(sb.st_mode)) {
+			fprintf(stderr, "Invalid value '%s' for option "
+				"'seekcache': %s\n", value,
+				zdsfsinfo.seek_cache_dir ? strerror(ENOTDIR) :
+				strerror(errno));
+			exit(1);
+		}
+		return 0;
 	case KEY_HELP:
 		usage(outargs->argv[0]);
 
@@ -1070,10 +1335,12 @@ int main(int argc, char *argv[])
 	int rc;
 
 	bzero(&zdsfsinfo, sizeof(zdsfsinfo));
+	pthread_mutex_init(&zdsfsinfo.vtoc_mutex, NULL);
 	zdsfsinfo.keepRDW = 0;
 	zdsfsinfo.allow_inclomplete_multi_volume = 0;
 	zdsfsinfo.tracks_per_frame = 128;
 	zdsfsinfo.seek_buffer_size = 1048576;
+	zdsfsinfo.readahead = 1;
 
 	rc = lzds_zdsroot_alloc(&zdsfsinfo.zdsroot);
 	if (rc) {
@@ -1092,6 +1359,7 @@ int main(int argc, char *argv[])
 			argv[0]);
 		exit(1);
 	}
+	zdsfs_read_devices();
 
 	if (zdsfsinfo.host_count) {
 		/* check, print error and exit if multiple online */
@@ -1107,7 +1375,7 @@ int main(int argc, char *argv[])
 	if (rc)
 		goto cleanup;
 
-	rc = zdsfs_create_meta_data_buffer(&zdsfsinfo);
+	rc = zdsfs_meta_data_reset();
 	if (rc)
 		goto cleanup;
 
@@ -1115,6 +1383,7 @@ int main(int argc, char *argv[])
 
 cleanup:
 	lzds_zdsroot_free(zdsfsinfo.zdsroot);
+	free(zdsfsinfo.seek_cache_dir);
 
 	fuse_opt_free_args(&args);
 	return rc;
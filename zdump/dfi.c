@@ -47,6 +47,16 @@ struct cpus {
 	unsigned int		cnt;
 };
 
+/*
+ * Memory chunk index sorted by start address for binary search
+ */
+struct mem_index {
+	struct dfi_mem_chunk	**vec;
+	unsigned int		cnt;
+	int			valid;
+	int			overlap;
+};
+
 /*
  * Memory information
  */
@@ -56,6 +66,7 @@ struct mem {
 	u64			end_addr;
 	unsigned int		chunk_cnt;
 	struct util_list	chunk_list;
+	struct mem_index	index;
 };
 
 /*
@@ -117,6 +128,52 @@ static void mem_init(struct mem *mem)
 	mem->start_addr = U64_MAX;
 	mem->end_addr = 0;
 	util_list_init(&mem->chunk_list, struct dfi_mem_chunk, list);
+	mem->index.valid = 0;
+}
+
+/*
+ * Memory chunk compare function for index sorting
+ */
+static int mem_index_cmp_fn(const void *a, const void *b)
+{
+	struct dfi_mem_chunk *mem_chunk1 = *((struct dfi_mem_chunk **) a);
+	struct dfi_mem_chunk *mem_chunk2 = *((struct dfi_mem_chunk **) b);
+
+	if (mem_chunk1->start == mem_chunk2->start)
+		return 0;
+	return mem_chunk1->start < mem_chunk2->start ? -1 : 1;
+}
+
+/*
+ * Build memory chunk index
+ */
+static void mem_index_build(struct mem *mem)
+{
+	struct mem_index *index = &mem->index;
+	struct dfi_mem_chunk *mem_chunk;
+	unsigned int i = 0;
+
+	zg_free(index->vec);
+	index->vec = zg_alloc(MAX(mem->chunk_cnt, 1U) * sizeof(*index->vec));
+	util_list_iterate(&mem->chunk_list, mem_chunk)
+		index->vec[i++] = mem_chunk;
+	index->cnt = i;
+	qsort(index->vec, index->cnt, sizeof(*index->vec), mem_index_cmp_fn);
+	/* Binary search requires that chunks do not overlap */
+	index->overlap = 0;
+	for (i = 1; i < index->cnt; i++) {
+		if (index->vec[i]->start <= index->vec[i - 1]->end)
+			index->overlap = 1;
+	}
+	index->valid = 1;
+}
+
+/*
+ * Invalidate memory chunk index after memory chunks have been changed
+ */
+static void mem_index_invalidate(struct mem *mem)
+{
+	mem->index.valid = 0;
 }
 
 /*
@@ -144,6 +201,7 @@ static void mem_update(struct mem *mem)
 		mem->start_addr = MIN(mem->start_addr, mem_chunk->start);
 		mem->end_addr = MAX(mem->end_addr, mem_chunk->end);
 	}
+	mem_index_build(mem);
 }
 
 /*
@@ -296,6 +354,7 @@ static void mem_chunk_create(struct mem *mem, u64 start, u64 size, void *data,
 	mem->end_addr = MAX(mem->end_addr, mem_chunk->end);
 	mem->chunk_cache = mem_chunk;
 	mem->chunk_cnt++;
+	mem_index_invalidate(mem);
 }
 
 /*
@@ -312,16 +371,38 @@ static int mem_chunk_has_addr(struct dfi_mem_chunk *mem_chunk, u64 addr)
 static struct dfi_mem_chunk *mem_chunk_find(struct mem *mem, u64 addr)
 {
 	struct dfi_mem_chunk *mem_chunk;
+	unsigned int lo, hi, mid;
 
-	if (mem_chunk_has_addr(mem->chunk_cache, addr))
+	if (mem->chunk_cache && mem_chunk_has_addr(mem->chunk_cache, addr))
 		return mem->chunk_cache;
-	util_list_iterate(&mem->chunk_list, mem_chunk) {
-		if (mem_chunk_has_addr(mem_chunk, addr)) {
-			mem->chunk_cache = mem_chunk;
-			return mem_chunk;
+	if (!mem->index.valid)
+		mem_index_build(mem);
+	if (mem->index.overlap) {
+		util_list_iterate(&mem->chunk_list, mem_chunk) {
+			if (mem_chunk_has_addr(mem_chunk, addr)) {
+				mem->chunk_cache = mem_chunk;
+				return mem_chunk;
+			}
 		}
+		return NULL;
 	}
-	return NULL;
+	/* Search last memory chunk that starts at or before addr */
+	lo = 0;
+	hi = mem->index.cnt;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (mem->index.vec[mid]->start <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return NULL;
+	mem_chunk = mem->index.vec[lo - 1];
+	if (!mem_chunk_has_addr(mem_chunk, addr))
+		return NULL;
+	mem->chunk_cache = mem_chunk;
+	return mem_chunk;
 }
 
 /*
@@ -1046,6 +1127,9 @@ static void mem_unmap(u64 start, u64 size)
 free:
 		util_list_remove(&l.mem_virt.chunk_list, mem_chunk);
 		l.mem_virt.chunk_cnt--;
+		mem_index_invalidate(&l.mem_virt);
+		if (l.mem_virt.chunk_cache == mem_chunk)
+			l.mem_virt.chunk_cache = NULL;
 		if (mem_chunk->data && mem_chunk->free_fn)
 			mem_chunk->free_fn(mem_chunk->data);
 		zg_free(mem_chunk);
@@ -0,0 +1,171 @@
+/*
+ * zgetdump - Tool for copying and converting System z dumps
+ *
+ * Benchmark for memory chunk lookup
+ *
+ * Create an ELF core dump with many PT_LOAD segments in random order and
+ * replay random memory reads. The memory chunk index is compared with a
+ * walk over the memory chunk list as done before the index was introduced.
+ *
+ * Build with "make dfi_mem_bench". The program is not installed.
+ *
+ * Copyright IBM Corp. 2017
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/util_bench.h"
+
+#include "zgetdump.h"
+
+#define CHUNK_SIZE	4096UL
+#define CHUNKS_DEFAULT	20000
+#define READS_DEFAULT	10000
+
+/*
+ * Globals
+ */
+struct zgetdump_globals g;
+
+/*
+ * Write ELF core dump with "cnt" zero memory chunks in random order
+ *
+ * Chunk "i" starts at address i * 2 * CHUNK_SIZE, so there is a memory
+ * hole between each two chunks.
+ */
+static void elf_dump_create(int fd, unsigned int cnt)
+{
+	unsigned int i, j, tmp, *order;
+	Elf64_Ehdr ehdr;
+	Elf64_Phdr phdr;
+
+	order = zg_alloc(cnt * sizeof(*order));
+	for (i = 0; i < cnt; i++)
+		order[i] = i;
+	for (i = cnt - 1; i > 0; i--) {
+		j = random() % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	memset(&ehdr, 0, sizeof(ehdr));
+	memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+	ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+	ehdr.e_ident[EI_DATA] = ELFDATA2MSB;
+	ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+	ehdr.e_type = ET_CORE;
+	ehdr.e_machine = EM_S390;
+	ehdr.e_version = EV_CURRENT;
+	ehdr.e_phoff = sizeof(ehdr);
+	ehdr.e_ehsize = sizeof(ehdr);
+	ehdr.e_phentsize = sizeof(phdr);
+	ehdr.e_phnum = cnt;
+	if (write(fd, &ehdr, sizeof(ehdr)) != sizeof(ehdr))
+		ERR_EXIT_ERRNO("Could not write dump");
+	for (i = 0; i < cnt; i++) {
+		memset(&phdr, 0, sizeof(phdr));
+		phdr.p_type = PT_LOAD;
+		phdr.p_paddr = phdr.p_vaddr = order[i] * 2 * CHUNK_SIZE;
+		phdr.p_memsz = CHUNK_SIZE;
+		if (write(fd, &phdr, sizeof(phdr)) != sizeof(phdr))
+			ERR_EXIT_ERRNO("Could not write dump");
+	}
+	zg_free(order);
+}
+
+/*
+ * Find memory chunk by walking the memory chunk list
+ */
+static struct dfi_mem_chunk *mem_chunk_find_walk(u64 addr)
+{
+	struct dfi_mem_chunk *mem_chunk;
+
+	util_list_iterate(dfi_mem_chunk_list(), mem_chunk) {
+		if (addr >= mem_chunk->start && addr <= mem_chunk->end)
+			return mem_chunk;
+	}
+	return NULL;
+}
+
+/*
+ * Replay "cnt" random reads and compare index lookup with list walk
+ */
+static void benchmark(unsigned int chunk_cnt, unsigned int cnt)
+{
+	struct dfi_mem_chunk *mem_chunk;
+	double start, t_index, t_walk;
+	unsigned int i;
+	u64 *addr_vec;
+	char buf[8];
+
+	addr_vec = zg_alloc(cnt * sizeof(*addr_vec));
+	for (i = 0; i < cnt; i++) {
+		addr_vec[i] = (random() % chunk_cnt) * 2 * CHUNK_SIZE +
+			random() % (CHUNK_SIZE - sizeof(buf));
+	}
+
+	start = util_bench_time();
+	for (i = 0; i < cnt; i++)
+		dfi_mem_read(addr_vec[i], buf, sizeof(buf));
+	t_index = util_bench_time() - start;
+
+	start = util_bench_time();
+	for (i = 0; i < cnt; i++) {
+		mem_chunk = mem_chunk_find_walk(addr_vec[i]);
+		mem_chunk->read_fn(mem_chunk, addr_vec[i] - mem_chunk->start,
+				   buf, sizeof(buf));
+	}
+	t_walk = util_bench_time() - start;
+
+	for (i = 0; i < cnt; i++) {
+		if (dfi_mem_chunk_find(addr_vec[i]) !=
+		    mem_chunk_find_walk(addr_vec[i]))
+			ERR_EXIT("Lookup for address 0x%llx failed",
+				 (unsigned long long) addr_vec[i]);
+	}
+
+	printf("%u memory chunks, %u random reads:\n", chunk_cnt, cnt);
+	printf("  Index:     %8.3f s\n", t_index);
+	printf("  List walk: %8.3f s\n", t_walk);
+	zg_free(addr_vec);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int chunk_cnt = CHUNKS_DEFAULT, cnt = READS_DEFAULT;
+	char path[] = "/tmp/dfi_mem_bench.XXXXXX";
+	int fd, rc;
+
+	g.prog_name = "dfi_mem_bench";
+	if (argc > 1)
+		chunk_cnt = atoi(argv[1]);
+	if (argc > 2)
+		cnt = atoi(argv[2]);
+	if (chunk_cnt == 0 || chunk_cnt > PN_XNUM - 1 || cnt == 0)
+		ERR_EXIT("Usage: %s [CHUNKS [READS]] (CHUNKS < %u)",
+			 g.prog_name, PN_XNUM);
+
+	fd = mkstemp(path);
+	if (fd == -1)
+		ERR_EXIT_ERRNO("Could not create dump");
+	elf_dump_create(fd, chunk_cnt);
+	close(fd);
+
+	g.opts.device = path;
+	rc = dfi_init();
+	unlink(path);
+	if (rc)
+		ERR_EXIT("Could not open dump");
+	if (dfi_mem_chunk_cnt() != chunk_cnt)
+		ERR_EXIT("Dump has %u instead of %u memory chunks",
+			 dfi_mem_chunk_cnt(), chunk_cnt);
+	benchmark(chunk_cnt, cnt);
+	return EXIT_SUCCESS;
+}
@@ -9,12 +9,16 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <limits.h>
 #include <time.h>
 #include "zgetdump.h"
 
 #define dfo_chunk_iterate(dfo_chunk) \
 	util_list_iterate(&l.dump.chunk_list, dfo_chunk)
 
+#define DFO_CACHE_BLOCK_SIZE	(64 * KIB)
+#define DFO_CACHE_RA_MAX	16U	/* Maximum read-ahead in blocks */
+
 /*
  * DFO vector
  */
@@ -34,12 +38,39 @@ struct dump {
 	struct util_list	chunk_list;	/* DFO chunk list */
 };
 
+/*
+ * Cached block of output dump
+ */
+struct cache_block {
+	struct util_list_node	list;		/* LRU list */
+	struct cache_block	*hash_next;	/* Next block in hash bucket */
+	u64			nr;		/* Block number */
+	u64			cnt;		/* Number of valid bytes */
+	char			*data;		/* Block data */
+};
+
+/*
+ * Block cache for output dump
+ */
+struct cache {
+	struct cache_block	*block_vec;	/* All cache blocks */
+	struct cache_block	**hash_vec;	/* Hash buckets */
+	unsigned int		hash_size;	/* Number of buckets (power of 2) */
+	unsigned int		used;		/* Number of used blocks */
+	struct util_list	lru_list;	/* Most recently used first */
+	u64			last_nr;	/* Last accessed block */
+	unsigned int		ra_max;		/* Maximum read-ahead in blocks */
+	unsigned int		ra_cnt;		/* Current read-ahead in blocks */
+	struct dfo_cache_stats	stats;		/* Cache statistics */
+};
+
 /*
  * File local static data
  */
 static struct {
 	struct dump	dump;
 	struct dfo	*dfo;
+	struct cache	*cache;
 } l;
 
 /*
@@ -88,6 +119,68 @@ void dfo_chunk_mem_fn(struct dfo_chunk *dfo_chunk, u64 off, void *buf, u64 cnt)
 	mem_chunk->read_fn(mem_chunk, off, buf, cnt);
 }
 
+/*
+ * Check if dump chunk contains only zeroes
+ */
+static int dfo_chunk_is_zero(struct dfo_chunk *dfo_chunk)
+{
+	struct dfi_mem_chunk *mem_chunk = dfo_chunk->data;
+
+	if (dfo_chunk->read_fn == dfo_chunk_zero_fn)
+		return 1;
+	if (dfo_chunk->read_fn == dfo_chunk_mem_fn &&
+	    mem_chunk->read_fn == dfi_mem_chunk_read_zero)
+		return 1;
+	return 0;
+}
+
+/*
+ * Dump chunk compare function for sorting by start offset
+ */
+static int dfo_chunk_cmp_fn(const void *a, const void *b)
+{
+	struct dfo_chunk *dfo_chunk1 = *((struct dfo_chunk **) a);
+	struct dfo_chunk *dfo_chunk2 = *((struct dfo_chunk **) b);
+
+	if (dfo_chunk1->start == dfo_chunk2->start)
+		return 0;
+	return dfo_chunk1->start < dfo_chunk2->start ? -1 : 1;
+}
+
+/*
+ * Return number of output dump bytes that are not known to be zero
+ *
+ * This is the size of the union of all dump chunks that do not consist of
+ * zero memory. Zero chunks can be represented as holes in sparse files.
+ */
+u64 dfo_alloc_size(void)
+{
+	struct dfo_chunk **vec, *dfo_chunk;
+	u64 alloc_size = 0, start = 0, end = 0;
+	unsigned int i, cnt = 0;
+
+	vec = zg_alloc(MAX(l.dump.chunk_cnt, 1U) * sizeof(*vec));
+	dfo_chunk_iterate(dfo_chunk) {
+		if (!dfo_chunk_is_zero(dfo_chunk))
+			vec[cnt++] = dfo_chunk;
+	}
+	qsort(vec, cnt, sizeof(*vec), dfo_chunk_cmp_fn);
+	for (i = 0; i < cnt; i++) {
+		if (i > 0 && vec[i]->start <= end) {
+			end = MAX(end, vec[i]->end);
+			continue;
+		}
+		if (i > 0)
+			alloc_size += end - start + 1;
+		start = vec[i]->start;
+		end = vec[i]->end;
+	}
+	if (cnt > 0)
+		alloc_size += end - start + 1;
+	zg_free(vec);
+	return alloc_size;
+}
+
 /*
  * Get DFO name
  */
@@ -173,26 +266,212 @@ void dfo_seek(u64 off)
 }
 
 /*
- * Read "cnt" bytes of output dump at current offest
+ * Read "cnt" bytes of output dump at offset "off" from the dump chunks
  */
-u64 dfo_read(void *buf, u64 cnt)
+static u64 dump_read(void *buf, u64 off, u64 cnt)
 {
 	struct dfo_chunk *dfo_chunk;
 	u64 copied = 0, end, size;
-	u64 off = l.dump.off;
 
 	while (copied != cnt) {
 		dfo_chunk = dfo_chunk_find(off, &end);
 		if (!dfo_chunk)
-			goto out;
+			break;
 		size = MIN(cnt - copied, end - off + 1);
 		dfo_chunk->read_fn(dfo_chunk, off - dfo_chunk->start,
 				    buf + copied, size);
 		copied += size;
 		off += size;
 	}
-out:
-	l.dump.off = off;
+	return copied;
+}
+
+/*
+ * Return hash bucket for block number
+ */
+static struct cache_block **cache_bucket(u64 nr)
+{
+	return &l.cache->hash_vec[nr & (l.cache->hash_size - 1)];
+}
+
+/*
+ * Find cached block
+ */
+static struct cache_block *cache_lookup(u64 nr)
+{
+	struct cache_block *block;
+
+	for (block = *cache_bucket(nr); block; block = block->hash_next) {
+		if (block->nr == nr)
+			return block;
+	}
+	return NULL;
+}
+
+/*
+ * Remove block from hash bucket
+ */
+static void cache_hash_remove(struct cache_block *block)
+{
+	struct cache_block **ptr = cache_bucket(block->nr);
+
+	while (*ptr != block)
+		ptr = &(*ptr)->hash_next;
+	*ptr = block->hash_next;
+}
+
+/*
+ * Read block into cache and evict least recently used block if necessary
+ */
+static struct cache_block *cache_fill(u64 nr)
+{
+	struct cache *cache = l.cache;
+	struct cache_block *block;
+	u64 off = nr * DFO_CACHE_BLOCK_SIZE;
+
+	if (cache->used < cache->stats.block_cnt) {
+		block = &cache->block_vec[cache->used++];
+		block->data = zg_alloc(DFO_CACHE_BLOCK_SIZE);
+	} else {
+		block = util_list_end(&cache->lru_list);
+		util_list_remove(&cache->lru_list, block);
+		cache_hash_remove(block);
+		cache->stats.evictions++;
+	}
+	block->nr = nr;
+	block->cnt = dump_read(block->data, off,
+			       MIN((u64) DFO_CACHE_BLOCK_SIZE,
+				   l.dump.size - off));
+	block->hash_next = *cache_bucket(nr);
+	*cache_bucket(nr) = block;
+	util_list_add_head(&cache->lru_list, block);
+	return block;
+}
+
+/*
+ * Read ahead blocks following block "nr" that are not cached yet
+ */
+static void cache_read_ahead(u64 nr)
+{
+	struct cache *cache = l.cache;
+	u64 nr_max = (l.dump.size - 1) / DFO_CACHE_BLOCK_SIZE;
+	unsigned int i;
+
+	for (i = 1; i <= cache->ra_cnt && nr + i <= nr_max; i++) {
+		if (cache_lookup(nr + i))
+			continue;
+		cache_fill(nr + i);
+		cache->stats.read_ahead++;
+	}
+}
+
+/*
+ * Get block from cache and read it if necessary
+ *
+ * If a block is missed directly after its predecessor has been accessed,
+ * the access pattern is assumed to be sequential. In that case the
+ * read-ahead window is doubled and the following blocks are read as well.
+ */
+static struct cache_block *cache_get(u64 nr)
+{
+	struct cache *cache = l.cache;
+	struct cache_block *block;
+
+	block = cache_lookup(nr);
+	if (block) {
+		cache->stats.hits++;
+		util_list_remove(&cache->lru_list, block);
+		util_list_add_head(&cache->lru_list, block);
+	} else {
+		cache->stats.misses++;
+		if (cache->last_nr + 1 == nr)
+			cache->ra_cnt = MIN(MAX(cache->ra_cnt * 2, 1U),
+					    cache->ra_max);
+		else
+			cache->ra_cnt = 0;
+		cache_read_ahead(nr);
+		/* Fill block last to keep it at the head of the LRU list */
+		block = cache_fill(nr);
+	}
+	cache->last_nr = nr;
+	return block;
+}
+
+/*
+ * Read "cnt" bytes of output dump at offset "off" through the cache
+ */
+static u64 cache_read(void *buf, u64 off, u64 cnt)
+{
+	struct cache_block *block;
+	u64 copied = 0, blk_off, size;
+
+	if (off >= l.dump.size)
+		return 0;
+	cnt = MIN(cnt, l.dump.size - off);
+	while (copied != cnt) {
+		block = cache_get(off / DFO_CACHE_BLOCK_SIZE);
+		blk_off = off % DFO_CACHE_BLOCK_SIZE;
+		if (block->cnt <= blk_off)
+			break;
+		size = MIN(cnt - copied, block->cnt - blk_off);
+		memcpy(buf + copied, block->data + blk_off, size);
+		copied += size;
+		off += size;
+	}
+	return copied;
+}
+
+/*
+ * Initialize block cache with "size" bytes for reading the output dump
+ */
+void dfo_cache_init(u64 size)
+{
+	u64 blocks = size / DFO_CACHE_BLOCK_SIZE;
+	unsigned int block_cnt;
+	struct cache *cache;
+
+	if (blocks == 0)
+		return;
+	if (blocks > UINT_MAX / 2)
+		ERR_EXIT("Cache size of %llu bytes is too large",
+			 (unsigned long long) size);
+	block_cnt = blocks;
+	cache = zg_alloc(sizeof(*cache));
+	cache->block_vec = zg_alloc(block_cnt * sizeof(*cache->block_vec));
+	cache->hash_size = 1;
+	while (cache->hash_size < block_cnt)
+		cache->hash_size <<= 1;
+	cache->hash_vec = zg_alloc(cache->hash_size *
+				   sizeof(*cache->hash_vec));
+	util_list_init(&cache->lru_list, struct cache_block, list);
+	cache->last_nr = U64_MAX - 1;	/* No block accessed yet */
+	/* Do not let read-ahead evict the block that has been requested */
+	cache->ra_max = MIN(DFO_CACHE_RA_MAX, block_cnt / 2);
+	cache->stats.block_cnt = block_cnt;
+	cache->stats.block_size = DFO_CACHE_BLOCK_SIZE;
+	l.cache = cache;
+}
+
+/*
+ * Return block cache statistics or NULL if the cache is not enabled
+ */
+struct dfo_cache_stats *dfo_cache_stats(void)
+{
+	return l.cache ? &l.cache->stats : NULL;
+}
+
+/*
+ * Read "cnt" bytes of output dump at current offest
+ */
+u64 dfo_read(void *buf, u64 cnt)
+{
+	u64 copied;
+
+	if (l.cache)
+		copied = cache_read(buf, l.dump.off, cnt);
+	else
+		copied = dump_read(buf, l.dump.off, cnt);
+	l.dump.off += copied;
 	return copied;
 }
 
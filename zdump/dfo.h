@@ -37,9 +37,25 @@ extern void dfo_chunk_mem_fn(struct dfo_chunk *chunk, u64 off, void *buf,
 extern void dfo_chunk_add(u64 start, u64 size, void *data,
 			  dfo_chunk_read_fn read_fn);
 
+/*
+ * DFO block cache statistics
+ */
+struct dfo_cache_stats {
+	unsigned int	block_cnt;	/* Number of cache blocks */
+	unsigned int	block_size;	/* Size of cache block in bytes */
+	u64		hits;		/* Blocks found in cache */
+	u64		misses;		/* Blocks not found in cache */
+	u64		read_ahead;	/* Blocks read ahead */
+	u64		evictions;	/* Blocks evicted from cache */
+};
+
+extern void dfo_cache_init(u64 size);
+extern struct dfo_cache_stats *dfo_cache_stats(void);
+
 extern u64 dfo_read(void *buf, u64 cnt);
 extern void dfo_seek(u64 addr);
 extern u64 dfo_size(void);
+extern u64 dfo_alloc_size(void);
 extern const char *dfo_name(void);
 extern void dfo_init(void);
 extern int dfo_set(const char *dfo_name);
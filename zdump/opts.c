@@ -22,7 +22,7 @@
  */
 static char help_text[] =
 "Usage: zgetdump    DUMP [-s SYS] [-f FMT] > DUMP_FILE\n"
-"                -m DUMP [-s SYS] [-f FMT] DIR\n"
+"                -m DUMP [-s SYS] [-f FMT] [-c SIZE] DIR\n"
 "                -i DUMP [-s SYS]\n"
 "                -d DUMPDEV\n"
 "                -u DIR\n"
@@ -45,12 +45,19 @@ static char help_text[] =
 "-f, --fmt      Specify target dump format FMT (\"elf\" or \"s390\")\n"
 "-s, --select   Select system data SYS (\"kdump\", \"prod\", or \"all\")\n"
 "-d, --device   Print DUMPDEV (dump device) information\n"
+"-c, --cache    Use SIZE MB of memory to cache the mounted dump (default 64)\n"
 "-v, --version  Print version information, then exit\n"
 "-V, --verbose  Show detailed layout of memory map on printing DUMP information\n"
 "-h, --help     Print this help, then exit\n";
 
 static const char copyright_str[] = "Copyright IBM Corp. 2001, 2018";
 
+/*
+ * Default and maximum size of block cache for mounted dumps in MB
+ */
+#define CACHE_SIZE_DEFAULT	64
+#define CACHE_SIZE_MAX		(1024 * 1024)
+
 /*
  * Select option strings
  */
@@ -65,6 +72,7 @@ static void init_defaults(void)
 {
 	g.prog_name = "zgetdump";
 	g.opts.action = ZG_ACTION_STDOUT;
+	g.opts.cache_size = CACHE_SIZE_DEFAULT;
 #ifdef __s390x__
 	g.opts.fmt = "elf";
 #else
@@ -129,6 +137,23 @@ static void select_set(const char *select)
 	g.opts.select_specified = 1;
 }
 
+/*
+ * Set "--cache" option
+ */
+static void cache_size_set(const char *size_str)
+{
+	char *endptr;
+
+	errno = 0;
+	g.opts.cache_size = strtoull(size_str, &endptr, 10);
+	if (errno || *size_str == '\0' || *endptr != '\0' || *size_str == '-')
+		ERR_EXIT("Invalid cache size \"%s\" specified", size_str);
+	if (g.opts.cache_size > CACHE_SIZE_MAX)
+		ERR_EXIT("Cache size \"%s\" exceeds maximum of %u MB", size_str,
+			 CACHE_SIZE_MAX);
+	g.opts.cache_size_specified = 1;
+}
+
 /*
  * Set mount point
  */
@@ -185,6 +210,9 @@ static void verify_opts(void)
 			ERR_EXIT("The \"--select\" option can only be "
 				 "specified for info, mount, or copy");
 	}
+	if (g.opts.cache_size_specified && g.opts.action != ZG_ACTION_MOUNT)
+		ERR_EXIT("The \"--cache\" option can only be specified "
+			 "together with \"--mount\"");
 	if (!g.opts.fmt_specified)
 		return;
 
@@ -253,9 +281,10 @@ void opts_parse(int argc, char *argv[])
 		{"select",  required_argument, NULL, 's'},
 		{"debug",   no_argument,       NULL, 'X'},
 		{"verbose", no_argument,       NULL, 'V'},
+		{"cache",   required_argument, NULL, 'c'},
 		{NULL,      0,                 NULL,  0 }
 	};
-	static const char optstr[] = "hvVidmus:f:X";
+	static const char optstr[] = "hvVidmus:f:c:X";
 
 	init_defaults();
 	while ((opt = getopt_long(argc, argv, optstr, long_opts, &idx)) != -1) {
@@ -285,6 +314,9 @@ void opts_parse(int argc, char *argv[])
 		case 's':
 			select_set(optarg);
 			break;
+		case 'c':
+			cache_size_set(optarg);
+			break;
 		case 'X':
 			g.opts.debug_specified = 1;
 			break;
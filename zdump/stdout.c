@@ -3,37 +3,264 @@
  *
  * Write dump to standard output (stdout)
  *
+ * The dump is copied with a two stage pipeline: A reader thread converts
+ * the input dump into the output format by filling a ring of buffers via
+ * dfo_read() while the main thread writes completed buffers in order to
+ * stdout. This allows input I/O and decoding to overlap with output I/O.
+ *
+ * If stdout is a regular file, pages that contain only zeroes are not
+ * written. Instead, the file offset is moved forward to create holes.
+ *
  * Copyright IBM Corp. 2001, 2017
  *
  * s390-tools is free software; you can redistribute it and/or modify
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
 #include "zgetdump.h"
 
-int stdout_write_dump(void)
+#define PIPE_BUF_SIZE	(1 * MIB)
+#define PIPE_BUF_CNT	8
+
+/*
+ * Buffer in copy pipeline
+ */
+struct pipe_buf {
+	char	*data;
+	u64	cnt;
+	int	full;
+};
+
+/*
+ * File local static data
+ */
+static struct {
+	struct pipe_buf	buf_vec[PIPE_BUF_CNT];
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	u64		read_stall_usecs;
+	u64		write_stall_usecs;
+	int		sparse;
+	u64		hole_bytes;
+} l;
+
+/*
+ * Return time in microseconds
+ */
+static u64 time_usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (u64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/*
+ * Wait until buffer has reached the requested state and account wait time
+ */
+static void pipe_buf_wait(struct pipe_buf *buf, int full, u64 *stall_usecs)
+{
+	u64 start;
+
+	pthread_mutex_lock(&l.mutex);
+	if (buf->full != full) {
+		start = time_usecs();
+		while (buf->full != full)
+			pthread_cond_wait(&l.cond, &l.mutex);
+		*stall_usecs += time_usecs() - start;
+	}
+	pthread_mutex_unlock(&l.mutex);
+}
+
+/*
+ * Set buffer state and notify other pipeline stage
+ */
+static void pipe_buf_set(struct pipe_buf *buf, int full)
+{
+	pthread_mutex_lock(&l.mutex);
+	buf->full = full;
+	pthread_cond_broadcast(&l.cond);
+	pthread_mutex_unlock(&l.mutex);
+}
+
+/*
+ * Check if buffer contains only zeroes
+ */
+static int buf_is_zero(const char *buf, u64 cnt)
+{
+	/* Compare the buffer with itself shifted by one byte */
+	return buf[0] == 0 && memcmp(buf, buf + 1, cnt - 1) == 0;
+}
+
+/*
+ * Check if holes can be created in the output file
+ *
+ * This is the case for regular files that are not opened in append mode
+ * and where no data exists behind the current file offset.
+ */
+static int sparse_possible(void)
+{
+	struct stat sb;
+	off_t off;
+	int flags;
+
+	if (fstat(STDOUT_FILENO, &sb) != 0 || !S_ISREG(sb.st_mode))
+		return 0;
+	flags = fcntl(STDOUT_FILENO, F_GETFL);
+	if (flags == -1 || (flags & O_APPEND))
+		return 0;
+	off = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+	if (off == -1 || off != sb.st_size)
+		return 0;
+	return 1;
+}
+
+/*
+ * Write buffer to stdout
+ */
+static void write_full(const char *buf, u64 cnt)
 {
-	u64 cnt, written = 0;
-	char buf[32768];
 	ssize_t rc;
 
+	rc = write(STDOUT_FILENO, buf, cnt);
+	if (rc == -1)
+		ERR_EXIT_ERRNO("Error: Write failed");
+	if (rc != (ssize_t) cnt)
+		ERR_EXIT("Error: Could not write full block");
+}
+
+/*
+ * Write buffer to stdout and skip zero pages if possible
+ */
+static void write_buf(const char *buf, u64 cnt)
+{
+	u64 off = 0, data_start = 0, size;
+
+	if (!l.sparse) {
+		write_full(buf, cnt);
+		return;
+	}
+	while (off < cnt) {
+		size = MIN(PAGE_SIZE, cnt - off);
+		if (!buf_is_zero(buf + off, size)) {
+			off += size;
+			continue;
+		}
+		if (off > data_start)
+			write_full(buf + data_start, off - data_start);
+		if (lseek(STDOUT_FILENO, size, SEEK_CUR) == -1)
+			ERR_EXIT_ERRNO("Error: Seek failed");
+		l.hole_bytes += size;
+		off += size;
+		data_start = off;
+	}
+	if (off > data_start)
+		write_full(buf + data_start, off - data_start);
+}
+
+/*
+ * Set size of output file in case it ends with a hole
+ */
+static void sparse_finish(void)
+{
+	off_t off;
+
+	if (!l.sparse)
+		return;
+	off = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+	if (off == -1)
+		ERR_EXIT_ERRNO("Error: Seek failed");
+	if (ftruncate(STDOUT_FILENO, off) != 0)
+		ERR_EXIT_ERRNO("Error: Could not set size of output file");
+}
+
+/*
+ * Reader thread: Fill buffers with converted dump data
+ */
+static void *read_thread(void *UNUSED(data))
+{
+	u64 size = dfo_size(), read = 0, cnt;
+	struct pipe_buf *buf;
+	unsigned int i = 0;
+
+	while (read != size) {
+		buf = &l.buf_vec[i];
+		pipe_buf_wait(buf, 0, &l.read_stall_usecs);
+		cnt = MIN((u64) PIPE_BUF_SIZE, size - read);
+		buf->cnt = dfo_read(buf->data, cnt);
+		read += buf->cnt;
+		pipe_buf_set(buf, 1);
+		i = (i + 1) % PIPE_BUF_CNT;
+	}
+	return NULL;
+}
+
+/*
+ * Print copy statistics
+ */
+static void stats_print(u64 written, u64 usecs)
+{
+	double secs = (double) usecs / 1000000;
+
+	STDERR("  Copied %llu MB in %.1f seconds (%.1f MB/s)\n",
+	       TO_MIB(written), secs,
+	       secs > 0 ? (double) written / MIB / secs : 0.0);
+	if (l.sparse)
+		STDERR("  Skipped %llu MB of zero pages\n",
+		       TO_MIB(l.hole_bytes));
+	if (!g.opts.verbose_specified)
+		return;
+	STDERR("  Reader waited %.1f seconds for writer\n",
+	       (double) l.read_stall_usecs / 1000000);
+	STDERR("  Writer waited %.1f seconds for reader\n",
+	       (double) l.write_stall_usecs / 1000000);
+}
+
+int stdout_write_dump(void)
+{
+	u64 written = 0, start;
+	struct pipe_buf *buf;
+	unsigned int i;
+	pthread_t tid;
+
 	if (!dfi_feat_copy())
 		ERR_EXIT("Copying not possible for %s dumps", dfi_name());
 	STDERR("Format Info:\n");
 	STDERR("  Source: %s\n", dfi_name());
 	STDERR("  Target: %s\n", dfo_name());
 	STDERR("\n");
+
+	for (i = 0; i < PIPE_BUF_CNT; i++)
+		l.buf_vec[i].data = zg_alloc(PIPE_BUF_SIZE);
+	pthread_mutex_init(&l.mutex, NULL);
+	pthread_cond_init(&l.cond, NULL);
+
+	l.sparse = sparse_possible();
 	zg_progress_init("Copying dump", dfo_size());
-	do {
-		cnt = dfo_read(buf, sizeof(buf));
-		rc = write(STDOUT_FILENO, buf, cnt);
-		if (rc == -1)
-			ERR_EXIT_ERRNO("Error: Write failed");
-		if (rc != (ssize_t) cnt)
-			ERR_EXIT("Error: Could not write full block");
-		written += cnt;
+	start = time_usecs();
+	errno = pthread_create(&tid, NULL, read_thread, NULL);
+	if (errno)
+		ERR_EXIT_ERRNO("Could not start reader thread");
+	for (i = 0; written != dfo_size(); i = (i + 1) % PIPE_BUF_CNT) {
+		buf = &l.buf_vec[i];
+		pipe_buf_wait(buf, 1, &l.write_stall_usecs);
+		write_buf(buf->data, buf->cnt);
+		written += buf->cnt;
+		pipe_buf_set(buf, 0);
 		zg_progress(written);
-	} while (written != dfo_size());
+	}
+	pthread_join(tid, NULL);
+	sparse_finish();
+	stats_print(written, time_usecs() - start);
+
+	pthread_cond_destroy(&l.cond);
+	pthread_mutex_destroy(&l.mutex);
+	for (i = 0; i < PIPE_BUF_CNT; i++)
+		zg_free(l.buf_vec[i].data);
 	STDERR("\n");
 	STDERR("Success: Dump has been copied\n");
 	return 0;
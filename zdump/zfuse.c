@@ -25,6 +25,8 @@
 #include "zgetdump.h"
 
 #define DUMP_PATH_MAX	100
+#define STATS_PATH	"/cache_stats"
+#define STATS_SIZE_MAX	512
 
 /*
  * File local static data
@@ -33,6 +35,8 @@ static struct {
 	char		path[DUMP_PATH_MAX];
 	struct stat	stat_root;
 	struct stat	stat_dump;
+	struct stat	stat_stats;
+	u64		alloc_size;
 } l;
 
 /*
@@ -73,7 +77,45 @@ static void stat_dump_init(void)
 	l.stat_dump.st_nlink = 1;
 	l.stat_dump.st_size = dfo_size();
 	l.stat_dump.st_blksize = 4096;
-	l.stat_dump.st_blocks = l.stat_dump.st_size / 4096;
+	/* Zero memory is not backed by the source dump, report it as holes */
+	l.stat_dump.st_blocks = ROUNDUP(l.alloc_size, 512) / 512;
+}
+
+/*
+ * Initialize stat buffer for cache statistics
+ */
+static void stat_stats_init(void)
+{
+	stat_default_init(&l.stat_stats);
+	l.stat_stats.st_mode = S_IFREG | 0400;
+	l.stat_stats.st_nlink = 1;
+}
+
+/*
+ * Check if path is the cache statistics file
+ */
+static int is_stats_path(const char *path)
+{
+	return dfo_cache_stats() && strcmp(path, STATS_PATH) == 0;
+}
+
+/*
+ * Format cache statistics and return length of text
+ */
+static int stats_text(char *buf, size_t size)
+{
+	struct dfo_cache_stats *stats = dfo_cache_stats();
+
+	return snprintf(buf, size,
+			"Cache size.....: %llu MB (%u blocks of %u KB)\n"
+			"Hits...........: %llu\n"
+			"Misses.........: %llu\n"
+			"Read-ahead.....: %llu\n"
+			"Evictions......: %llu\n",
+			TO_MIB((u64) stats->block_cnt * stats->block_size),
+			stats->block_cnt, stats->block_size / KIB,
+			stats->hits, stats->misses, stats->read_ahead,
+			stats->evictions);
 }
 
 /*
@@ -81,6 +123,8 @@ static void stat_dump_init(void)
  */
 static int zfuse_getattr(const char *path, struct stat *stat)
 {
+	char buf[STATS_SIZE_MAX];
+
 	if (strcmp(path, "/") == 0) {
 		*stat = l.stat_root;
 		return 0;
@@ -89,6 +133,11 @@ static int zfuse_getattr(const char *path, struct stat *stat)
 		*stat = l.stat_dump;
 		return 0;
 	}
+	if (is_stats_path(path)) {
+		*stat = l.stat_stats;
+		stat->st_size = stats_text(buf, sizeof(buf));
+		return 0;
+	}
 	return -ENOENT;
 }
 
@@ -107,6 +156,8 @@ static int zfuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 	filler(buf, ".", NULL, 0);
 	filler(buf, "..", NULL, 0);
 	filler(buf, &l.path[1], NULL, 0);
+	if (dfo_cache_stats())
+		filler(buf, &STATS_PATH[1], NULL, 0);
 	return 0;
 }
 
@@ -115,6 +166,11 @@ static int zfuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
  */
 static int zfuse_open(const char *path, struct fuse_file_info *fi)
 {
+	if (is_stats_path(path)) {
+		/* Statistics change, do not let the kernel cache them */
+		fi->direct_io = 1;
+		return (fi->flags & 3) != O_RDONLY ? -EACCES : 0;
+	}
 	if (strcmp(path, l.path) != 0)
 		return -ENOENT;
 	if ((fi->flags & 3) != O_RDONLY)
@@ -129,8 +185,19 @@ static int zfuse_open(const char *path, struct fuse_file_info *fi)
 static int zfuse_read(const char *path, char *buf, size_t size, off_t offset,
 		      struct fuse_file_info *fi)
 {
+	char stats_buf[STATS_SIZE_MAX];
+	int len;
+
 	(void) fi;
 
+	if (is_stats_path(path)) {
+		len = stats_text(stats_buf, sizeof(stats_buf));
+		if (offset >= len)
+			return 0;
+		size = MIN(size, (size_t) (len - offset));
+		memcpy(buf, stats_buf + offset, size);
+		return size;
+	}
 	if (strcmp(path, l.path) != 0)
 		return -ENOENT;
 	dfo_seek(offset);
@@ -146,9 +213,9 @@ static int zfuse_statfs(const char *path, struct statvfs *buf)
 	(void) path;
 
 	buf->f_bsize = buf->f_frsize = 4096;
-	buf->f_blocks = dfo_size() / 4096;
+	buf->f_blocks = ROUNDUP(l.alloc_size, 4096) / 4096;
 	buf->f_bfree = buf->f_bavail = 0;
-	buf->f_files = 1;
+	buf->f_files = dfo_cache_stats() ? 2 : 1;
 	buf->f_ffree = 0;
 	buf->f_namemax = strlen(l.path) + 1;
 	return 0;
@@ -206,8 +273,11 @@ int zfuse_mount_dump(void)
 	fuse_opt_add_arg(&args, tmp_str);
 	fuse_opt_add_arg(&args, g.opts.mount_point);
 	add_argv_fuse(&args);
+	l.alloc_size = dfo_alloc_size();
+	dfo_cache_init(g.opts.cache_size * MIB);
 	stat_root_init();
 	stat_dump_init();
+	stat_stats_init();
 	snprintf(l.path, sizeof(l.path), "/dump.%s", dfo_name());
 	return fuse_main(args.argc, args.argv, &zfuse_ops);
 }
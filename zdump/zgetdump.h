@@ -36,6 +36,8 @@ struct options {
 	const char	*select;
 	int		select_specified;
 	int		verbose_specified;
+	u64		cache_size;
+	int		cache_size_specified;
 };
 
 extern const char *OPTS_SELECT_KDUMP;